@@ -51,6 +51,11 @@ namespace apt {
 //    Entity::Destroy(player);
 //    Entity::Destroy(enemy);
 //
+// Create() takes a StringHash, use APT_STRING_HASH() to avoid hashing the name
+// at runtime:
+//
+//    Entity* enemy   = Entity::Create(APT_STRING_HASH("Enemy"));
+//
 //
 // It is also possible to iterate over the registered subclasses (useful for
 // generating drop down lists for a UI):
@@ -1,17 +1,43 @@
 #include <apt/File.h>
 
+#include <apt/hash.h>
 #include <apt/memory.h>
 
+#include <utility> // swap
+
 using namespace apt;
 
 // PUBLIC
 
+File::File(File&& _rhs_)
+	: File()
+{
+	swap(*this, _rhs_);
+}
+
+File& File::operator=(File&& _rhs_)
+{
+	if (&_rhs_ != this) {
+		swap(*this, _rhs_);
+	}
+	return *this;
+}
+
+void apt::swap(File& _a_, File& _b_)
+{
+	using std::swap;
+	swap((StringBase&)_a_.m_path, (StringBase&)_b_.m_path);
+	swap(_a_.m_data,     _b_.m_data);
+	swap(_a_.m_dataSize, _b_.m_dataSize);
+	swap(_a_.m_impl,     _b_.m_impl);
+	swap(_a_.m_mapped,   _b_.m_mapped);
+}
+
 void File::setData(const char* _data, uint64 _size)
 {
 	if (m_data) {
-		if (_size > m_dataSize || _size == 0) {
-			free(m_data);
-			m_data = 0;
+		if (_size > m_dataSize || _size == 0 || m_mapped) {
+			freeData();
 		}
 	}
 
@@ -27,13 +53,55 @@ void File::setData(const char* _data, uint64 _size)
 
 void File::appendData(const char* _data, uint64 _size)
 {
-	m_data = (char*)realloc(m_data, m_dataSize + _size);
+	if (m_mapped) {
+		char* data = (char*)APT_MALLOC(m_dataSize + _size);
+		APT_ASSERT(data);
+		memcpy(data, m_data, m_dataSize);
+		freeData();
+		m_data = data;
+	} else {
+		m_data = (char*)realloc(m_data, m_dataSize + _size);
+	}
 	if (_data) {
 		memcpy(m_data + m_dataSize, _data, _size);
 	}
 	m_dataSize += _size;
 }
 
+uint32 File::getChecksum() const
+{
+	return Crc32c(m_data, (uint)m_dataSize); // m_dataSize fits in uint, the data is in memory
+}
+
+void File::compress(CompressionFlags _flags)
+{
+	if (m_dataSize == 0) {
+		return;
+	}
+	void* data = nullptr;
+	uint64 dataSize = 0;
+	CompressBlocks(m_data, m_dataSize, data, dataSize, _flags);
+	freeData();
+	m_data = (char*)data;
+	m_dataSize = dataSize;
+}
+
+bool File::decompress()
+{
+	if (m_dataSize == 0) {
+		return true;
+	}
+	void* data = nullptr;
+	uint64 dataSize = 0;
+	if (!DecompressBlocks(m_data, m_dataSize, data, dataSize)) {
+		return false;
+	}
+	freeData();
+	m_data = (char*)data;
+	m_dataSize = dataSize;
+	return true;
+}
+
 
 // PRIVATE
 
@@ -42,12 +110,10 @@ void File::ctorCommon()
 	m_data = nullptr;
 	m_dataSize = 0;
 	m_impl = nullptr;
+	m_mapped = false;
 }
 
 void File::dtorCommon()
 {
-	if (m_data) {
-		APT_FREE(m_data);
-		m_data = nullptr;
-	}
+	freeData();
 }
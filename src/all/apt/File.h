@@ -2,6 +2,7 @@
 
 #include <apt/apt.h>
 #include <apt/String.h>
+#include <apt/compress.h>
 
 namespace apt {
 
@@ -14,7 +15,6 @@ namespace apt {
 // \todo API should include some interface for either writing to the internal 
 //   buffer directly, or setting the buffer ptr without copying all the data
 //   (prefer the former, buffer ownership issues in the latter case).
-// \todo Checksum/hash util.
 ////////////////////////////////////////////////////////////////////////////////
 class File: private non_copyable<File>
 {
@@ -23,6 +23,9 @@ public:
 
 	File();
 	~File();
+	File(File&& _rhs_);
+	File& operator=(File&& _rhs_);
+	friend void swap(File& _a_, File& _b_);
 
 	// Return true if _path exists.
 	static bool Exists(const char* _path);
@@ -34,10 +37,37 @@ public:
 	//   interpreted directly as a C string.
 	static bool Read(File& file_, const char* _path = 0);
 
+	// Map file into memory from _path, or file_.getPath() if _path is 0. Use getData() to access
+	// the mapped memory directly (pages are loaded on demand, no copy is made). Return false 
+	// if an error occurred, in which case file_ remains unchanged.
+	// \note Mapped data is read-only and isn't null terminated. Functions which modify the 
+	//   data (setData(), appendData(), compress(), decompress()) release the mapping.
+	static bool Map(File& file_, const char* _path = 0);
+
 	// Write file to _path, or _file.getPath() if _path is 0. Return false if an error occurred, 
 	// in which case any existing file at _path may or may not have been overwritten.
 	static bool Write(const File& _file, const char* _path = 0);
 
+	// Open _path, or file_.getPath() if _path is 0, for streaming writes via write(). Any existing file at _path is
+	// overwritten. The file remains open until close() is called or file_ is destroyed. Return false if an error occurred.
+	static bool OpenWrite(File& file_, const char* _path = 0);
+
+	// Write _size bytes from _data to the end of a file opened via OpenWrite() (the internal buffer is unused). Return false
+	// if an error occurred.
+	bool        write(const char* _data, uint64 _size);
+
+	// Open _path, or file_.getPath() if _path is 0, for streaming reads via read(). The file remains open until close() is
+	// called or file_ is destroyed. Return false if an error occurred.
+	static bool OpenRead(File& file_, const char* _path = 0);
+
+	// Read up to _size bytes into data_ from a file opened via OpenRead() (the internal buffer is unused). Return the number
+	// of bytes read, which is less than _size at the end of the file or if an error occurred.
+	uint64      read(char* data_, uint64 _size);
+
+	// Close a file opened via OpenWrite() or OpenRead().
+	void        close();
+	bool        isOpen() const;
+
 	// Allocate _size bytes for the internal buffer and optionally copy from _data. If _data 
 	// is 0 the buffer is allocated.
 	void        setData(const char* _data, uint64 _size);
@@ -51,6 +81,15 @@ public:
 	char*       getData()                                       { return m_data; }
 	uint64      getDataSize() const                             { return m_dataSize; }
 	void        setDataSize(uint64 _size)                       { setData(0, _size); }
+	bool        isMapped() const                                { return m_mapped; }
+
+	// Return a CRC-32C checksum of the internal buffer (see Crc32c()).
+	uint32      getChecksum() const;
+
+	// Compress/decompress the internal buffer in place using the block format (see CompressBlocks()). Blocks are compressed/
+	// decompressed in parallel. decompress() returns false if the internal buffer is invalid, in which case it remains unchanged.
+	void        compress(CompressionFlags _flags = CompressionFlags_Default);
+	bool        decompress();
 
 
 private:
@@ -58,10 +97,16 @@ private:
 	char*   m_data;
 	uint64  m_dataSize;
 	void*   m_impl;
+	bool    m_mapped;
 
 	void ctorCommon();
 	void dtorCommon();
 
+	// Release m_data (unmap if m_mapped).
+	void freeData();
+
 };
 
+void swap(File& _a_, File& _b_);
+
 } // namespace apt
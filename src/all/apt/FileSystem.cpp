@@ -51,6 +51,23 @@ bool FileSystem::Write(const File& _file, const char* _path, int _root)
 	return File::Write(_file, (const char*)fullPath);
 }
 
+bool FileSystem::OpenWrite(File& file_, const char* _path, int _root)
+{
+	PathStr fullPath = MakePath(_path ? _path : file_.getPath(), _root);
+	return File::OpenWrite(file_, (const char*)fullPath);
+}
+
+bool FileSystem::OpenRead(File& file_, const char* _path, int _root)
+{
+	PathStr fullPath;
+	_path = _path ? _path : file_.getPath();
+	if (!FindExisting(fullPath, _path, _root)) {
+		APT_LOG_ERR("Error opening '%s':\n\tFile not found", (const char*)MakePath(_path, _root));
+		return false;
+	}
+	return File::OpenRead(file_, (const char*)fullPath);
+}
+
 bool FileSystem::Exists(const char* _path, int _root)
 {
 	PathStr buf;
@@ -49,6 +49,12 @@ public:
 	// any existing file at _path may or may not have been overwritten. _root is ignored if _path is absolute.
 	static bool        Write(const File& _file, const char* _path = nullptr, int _root = GetDefaultRoot());
 
+	// Open _path for streaming writes (see File::OpenWrite()). _root is ignored if _path is absolute.
+	static bool        OpenWrite(File& file_, const char* _path = nullptr, int _root = GetDefaultRoot());
+
+	// Open _path for streaming reads (see File::OpenRead()). Roots are searched as per Read().
+	static bool        OpenRead(File& file_, const char* _path = nullptr, int _root = GetDefaultRoot());
+
 	// Return true if _path exists. Each root is searched, beginning at _root.
 	static bool        Exists(const char* _path, int _root = GetDefaultRoot());
 
@@ -1,14 +1,27 @@
 #include <apt/Json.h>
 
+#include <apt/hash.h>
 #include <apt/log.h>
 #include <apt/math.h>
 #include <apt/memory.h>
 #include <apt/FileSystem.h>
 #include <apt/String.h>
+#include <apt/StringHash.h>
 #include <apt/Time.h>
 
+#include <EASTL/hash_map.h>
 #include <EASTL/vector.h>
 
+#include <cerrno>
+#include <climits>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+#include <immintrin.h>
+
 #define RAPIDJSON_ASSERT(x) APT_ASSERT(x)
 #define RAPIDJSON_PARSE_DEFAULT_FLAGS (rapidjson::kParseFullPrecisionFlag | rapidjson::kParseCommentsFlag | rapidjson::kParseTrailingCommasFlag)
 #include <rapidjson/error/en.h>
@@ -33,720 +46,3457 @@
 
 using namespace apt;
 
-static Json::ValueType GetValueType(rapidjson::Type _type)
+namespace apt { namespace internal {
+
+// rapidjson base allocator (for the MemoryPoolAllocator and the parser stack). Blocks are prefixed with a Header, Free()
+// is static hence the header stores the owning pool (or nullptr if allocated directly).
+struct JsonPoolAllocator
 {
-	switch (_type) {
-		case rapidjson::kNullType:   return Json::ValueType_Null;
-		case rapidjson::kObjectType: return Json::ValueType_Object;
-		case rapidjson::kArrayType:  return Json::ValueType_Array;
-		case rapidjson::kFalseType:
-		case rapidjson::kTrueType:   return Json::ValueType_Bool;
-		case rapidjson::kNumberType: return Json::ValueType_Number;
-		case rapidjson::kStringType: return Json::ValueType_String;
-		default: APT_ASSERT(false); break;
+	struct Header
+	{
+		Json::Pool* m_pool;
+		size_t      m_capacity;
 	};
+	static const bool kNeedFree = true;
 
-	return Json::ValueType_Count;
-}
+	Json::Pool* m_pool;
 
-static const char* GetValueTypeString(Json::ValueType _type)
-{
-	switch (_type) {
-		case Json::ValueType_Null:    return "Null";
-		case Json::ValueType_Object:  return "Object";
-		case Json::ValueType_Array:   return "Array";
-		case Json::ValueType_Bool:    return "Bool";
-		case Json::ValueType_Number:  return "Number";
-		case Json::ValueType_String:  return "String";
-		default:                      return "Unknown";
-	};
-}
+	JsonPoolAllocator(Json::Pool* _pool = nullptr)
+		: m_pool(_pool)
+	{
+	}
 
-/*******************************************************************************
+	static Header* GetHeader(void* _ptr) { return (Header*)_ptr - 1; }
 
-                                   Json
+	void* Malloc(size_t _size)
+	{
+		if (_size == 0) {
+			return nullptr;
+		}
+		Header* header;
+		if (m_pool) {
+			header = (Header*)m_pool->acquire((uint)_size);
+		} else {
+			header = (Header*)APT_MALLOC(sizeof(Header) + _size);
+			header->m_pool = nullptr;
+			header->m_capacity = _size;
+		}
+		return header + 1;
+	}
 
-*******************************************************************************/
+	void* Realloc(void* _ptr, size_t _originalSize, size_t _newSize)
+	{
+		if (!_ptr) {
+			return Malloc(_newSize);
+		}
+		if (_newSize == 0) {
+			Free(_ptr);
+			return nullptr;
+		}
+		if (_newSize <= GetHeader(_ptr)->m_capacity) {
+			return _ptr;
+		}
+		void* ret = Malloc(_newSize);
+		memcpy(ret, _ptr, APT_MIN(_originalSize, _newSize));
+		Free(_ptr);
+		return ret;
+	}
 
-/*	Traversal of the dom:
-		- Stack is for container objects only, maintain a separate Value instance for the
-		  position *within* the current container. Need to support json whose root isn't an
-		  object?
-		- find() moves within the current container - takes either a name or an index. ONLY
-		  after calling find() can you call enter/leave, get/set etc.
+	static void Free(void* _ptr)
+	{
+		if (!_ptr) {
+			return;
+		}
+		Header* header = GetHeader(_ptr);
+		if (header->m_pool) {
+			header->m_pool->release(header);
+		} else {
+			APT_FREE(header);
+		}
+	}
+};
 
-	\todo		
-	- "call stack" for errors
-	- Matrices should be row major
-*/
-struct Json::Impl
+} } // namespace apt::internal
+
+typedef rapidjson::MemoryPoolAllocator<internal::JsonPoolAllocator>                               JsonAllocator;
+typedef rapidjson::GenericValue<rapidjson::UTF8<>, JsonAllocator>                                 JsonValue;
+typedef rapidjson::GenericDocument<rapidjson::UTF8<>, JsonAllocator, internal::JsonPoolAllocator> JsonDocument;
+
+// rapidjson output stream, buffers output in blocks of kBufferSize bytes which are written to m_file if it was opened via
+// File::OpenWrite(), else appended to its data.
+struct JsonOutputStream
 {
-	rapidjson::Document m_dom;
+	typedef char Ch;
+	static const uint kBufferSize = 64 * 1024;
 
-	struct Value
-	{
-		rapidjson::Value* m_value  = nullptr;
-		const char*       m_name   = "";       // value name
-		int               m_index  = -1;       // value index in the parent container
+	File* m_file  = nullptr;
+	uint  m_size  = 0;
+	bool  m_error = false;
+	char  m_buffer[kBufferSize];
 
-		ValueType getType()
-		{
-			return GetValueType(m_value->GetType()); 
+	void Put(char _c)
+	{
+		if (m_size == kBufferSize) {
+			Flush();
 		}
+		m_buffer[m_size++] = _c;
+	}
 
-		int getSize() 
-		{ 
-			auto type = getType();
-			if (type == ValueType_Array) {
-				return (int)m_value->Size();
-			} else if (type == ValueType_Object) {
-				return (int)m_value->MemberCount();
+	void Write(const char* _data, uint _size)
+	{
+		while (_size > 0) {
+			if (m_size == kBufferSize) {
+				Flush();
 			}
-			return -1;
+			uint n = APT_MIN(_size, kBufferSize - m_size);
+			memcpy(m_buffer + m_size, _data, n);
+			m_size += n;
+			_data  += n;
+			_size  -= n;
 		}
-	};
-	eastl::vector<Value> m_containerStack; // for traversal of containers (arrays, objects)
-	Value                m_currentValue;   // current element, index may be -1 if the previous operation was enter() or begin()
+	}
 
-	void reset()
+	void Flush()
 	{
-		m_containerStack.clear();
-		m_containerStack.push_back({ &m_dom, "", -1 });
-		m_currentValue = Value();
+		if (m_size == 0) {
+			return;
+		}
+		if (m_file->isOpen()) {
+			m_error |= !m_file->write(m_buffer, m_size);
+		} else {
+			m_file->appendData(m_buffer, m_size);
+		}
+		m_size = 0;
 	}
+};
 
-	bool find(int _i)
-	{
-		auto& container = m_containerStack.back();
-		JSON_ERR_ARRAY_SIZE("find()", container.m_name, _i, container.getSize(), return false);
-		auto containerType = container.getType();
-		if (containerType == ValueType_Array) {
-			m_currentValue.m_value = container.m_value->Begin() + _i;
-			m_currentValue.m_name  = "";
-			m_currentValue.m_index = _i;
-			return true;
+static inline void StreamWrite(JsonOutputStream& out_, const char* _data, uint _size)
+{
+	out_.Write(_data, _size);
+}
 
-		} else if (containerType == ValueType_Object) {
-			auto it = container.m_value->MemberBegin() + _i;
-			m_currentValue.m_value = &it->value;
-			m_currentValue.m_name  = it->name.GetString();
-			m_currentValue.m_index = _i;
-			return true;
+static inline void StreamWrite(rapidjson::StringBuffer& out_, const char* _data, uint _size)
+{
+	memcpy(out_.Push(_size), _data, _size);
+}
 
-		}
-		return false;
+/*	Binary data (see SerializerJson::binary()) is stored as a string with a prefix: '0' (uncompressed), '1' (compressed)
+	or '2' (compressed + 8 hex digits of the CRC-32C of the uncompressed data). The data follows the prefix either as
+	base64, or raw in which case the string begins with '\0' (see SerializerJson::setBinaryRaw()).
+
+	Strings beginning with '\0' are therefore reserved: reading text or MessagePack which contains such a string (e.g.
+	"\u0000...") fails, rather than the string being written back as base64 (see JsonDomHandler).
+*/
+static const uint kBinaryChecksumSize = 8;
+
+static uint BinaryPrefixSize(char _prefix)
+{
+	return _prefix == '2' ? 1 + kBinaryChecksumSize : 1;
+}
+
+static bool IsRawBinary(const char* _str, uint _length)
+{
+	return _length > 0 && _str[0] == '\0';
+}
+
+static uint Base64EncSizeBytes(uint _sizeBytes);
+static void Base64Encode(const char* _in, uint _inSizeBytes, char* out_, uint _outSizeBytes);
+
+static const char* kReservedStringError = "String begins with '\\0' (reserved for raw binary)";
+
+// Forward SAX events from a parser to a DOM, rejecting strings which would be mistaken for raw binary.
+struct JsonDomHandler
+{
+	JsonDocument& m_dom;
+	bool          m_reservedString = false;
+
+	JsonDomHandler(JsonDocument& _dom_)
+		: m_dom(_dom_)
+	{
 	}
 
-	bool find(const char* _name)
+	bool Null()                                                         { return m_dom.Null(); }
+	bool Bool(bool _value)                                              { return m_dom.Bool(_value); }
+	bool Int(int _value)                                                { return m_dom.Int(_value); }
+	bool Uint(unsigned _value)                                          { return m_dom.Uint(_value); }
+	bool Int64(int64_t _value)                                          { return m_dom.Int64(_value); }
+	bool Uint64(uint64_t _value)                                        { return m_dom.Uint64(_value); }
+	bool Double(double _value)                                          { return m_dom.Double(_value); }
+	bool RawNumber(const char* _str, rapidjson::SizeType _len, bool _copy) { return m_dom.RawNumber(_str, _len, _copy); }
+	bool StartObject()                                                  { return m_dom.StartObject(); }
+	bool Key(const char* _str, rapidjson::SizeType _len, bool _copy)    { return m_dom.Key(_str, _len, _copy); }
+	bool EndObject(rapidjson::SizeType _count)                          { return m_dom.EndObject(_count); }
+	bool StartArray()                                                   { return m_dom.StartArray(); }
+	bool EndArray(rapidjson::SizeType _count)                           { return m_dom.EndArray(_count); }
+
+	bool String(const char* _str, rapidjson::SizeType _len, bool _copy)
 	{
-		auto& container = m_containerStack.back();
-		//JSON_ERR_TYPE("find()", container.m_name, ValueType_Object, container.getType(), return false);
-		auto it = container.m_value->FindMember(_name);
-		if (it == container.m_value->MemberEnd()) {
+		if (IsRawBinary(_str, _len)) {
+			m_reservedString = true;
 			return false;
 		}
-		m_currentValue.m_value = &it->value;
-		m_currentValue.m_name  = it->name.GetString();
-		m_currentValue.m_index = (int)(it - container.m_value->MemberBegin());
-		return true;
+		return m_dom.String(_str, _len, _copy);
 	}
+};
 
-	void enter()
-	{
-		auto& container = m_containerStack.back();
-		auto containerType = container.getType();
-		APT_ASSERT(containerType == ValueType_Object || containerType == ValueType_Array);
-		m_containerStack.push_back(m_currentValue);
-		m_currentValue = Value();
-
-	 // In some cases we enter an object/array *before* we can get the name, for example when using `while (beginObject)` from the serializer class.
-	 // To work around this we copy the container name into the dummy current value.
-		m_currentValue.m_name = m_containerStack.back().m_name;
+// Parse text from _in_ to dom_, the parser stack is allocated from _allocator_. Return the error string on failure, else 0.
+template <unsigned kParseFlags, typename tStream>
+static const char* JsonParse(JsonDocument& dom_, tStream& _in_, internal::JsonPoolAllocator& _allocator_)
+{
+	JsonDomHandler handler(dom_);
+	rapidjson::ParseResult result;
+	auto generator = [&](JsonDocument&) {
+		rapidjson::GenericReader<rapidjson::UTF8<>, rapidjson::UTF8<>, internal::JsonPoolAllocator> reader(&_allocator_);
+		result = reader.Parse<kParseFlags>(_in_, handler);
+		return !result.IsError();
+	};
+	dom_.Populate(generator);
+	if (result.IsError()) {
+		return handler.m_reservedString ? kReservedStringError : rapidjson::GetParseError_En(result.Code());
 	}
+	return nullptr;
+}
 
-	void leave()
+// Forward SAX events to a text writer, converting raw binary strings to base64.
+template <typename tWriter>
+struct JsonTextHandler
+{
+	tWriter&            m_writer;
+	eastl::vector<char> m_base64;
+
+	JsonTextHandler(tWriter& _writer_)
+		: m_writer(_writer_)
 	{
-		m_currentValue = m_containerStack.back();
-		m_containerStack.pop_back();
 	}
-	
-	void addNew(const char* _name)
+
+	bool Null()                                                      { return m_writer.Null(); }
+	bool Bool(bool _value)                                           { return m_writer.Bool(_value); }
+	bool Int(int _value)                                             { return m_writer.Int(_value); }
+	bool Uint(unsigned _value)                                       { return m_writer.Uint(_value); }
+	bool Int64(int64_t _value)                                       { return m_writer.Int64(_value); }
+	bool Uint64(uint64_t _value)                                     { return m_writer.Uint64(_value); }
+	bool Double(double _value)                                       { return m_writer.Double(_value); }
+	bool StartObject()                                               { return m_writer.StartObject(); }
+	bool Key(const char* _str, rapidjson::SizeType _len, bool _copy) { return m_writer.Key(_str, _len, _copy); }
+	bool EndObject(rapidjson::SizeType _count)                       { return m_writer.EndObject(_count); }
+	bool StartArray()                                                { return m_writer.StartArray(); }
+	bool EndArray(rapidjson::SizeType _count)                        { return m_writer.EndArray(_count); }
+
+	bool String(const char* _str, rapidjson::SizeType _len, bool _copy)
 	{
-		auto& container = m_containerStack.back();
-		auto containerType = container.getType();
-		APT_ASSERT(containerType == ValueType_Object);
-		m_currentValue.m_index = (int)container.m_value->MemberCount();
-		container.m_value->AddMember(
-			rapidjson::StringRef(_name),
-			rapidjson::Value().Move(), 
-			m_dom.GetAllocator()
-		);
-		auto it = container.m_value->MemberEnd() - 1;
-		m_currentValue.m_name  = it->name.GetString();
-		m_currentValue.m_value = &it->value;
+		if (!IsRawBinary(_str, _len) || _len < 2 || _len - 1 < BinaryPrefixSize(_str[1])) {
+			return m_writer.String(_str, _len, _copy);
+		}
+		const char* prefix = _str + 1;
+		uint prefixSize = BinaryPrefixSize(*prefix);
+		const char* data = prefix + prefixSize;
+		uint dataSize = _len - 1 - prefixSize;
+		uint base64Size = Base64EncSizeBytes(dataSize);
+		m_base64.resize(prefixSize + base64Size + 1); // Base64Encode() writes a null terminator
+		memcpy(m_base64.data(), prefix, prefixSize);
+		Base64Encode(data, dataSize, m_base64.data() + prefixSize, base64Size);
+		return m_writer.String(m_base64.data(), (rapidjson::SizeType)(prefixSize + base64Size), true);
 	}
+};
 
-	void pushNew()
+/*	MessagePack encoding (https://msgpack.org/). Integers use the smallest encoding, doubles are written as float32 if
+	the conversion is exact. Raw binary strings are written as bin (without the leading '\0').
+*/
+template <typename tStream>
+static void MsgPackPut(tStream& out_, uint8 _type, uint64 _value, int _sizeBytes) // type byte + _sizeBytes big endian
+{
+	out_.Put((char)_type);
+	for (int i = _sizeBytes - 1; i >= 0; --i) {
+		out_.Put((char)(_value >> (i * 8)));
+	}
+}
+
+// _fixMax = 0 if there is no fix form, _type8 = 0 if there is no 8 bit form.
+template <typename tStream>
+static void MsgPackPutLength(tStream& out_, uint32 _length, uint8 _fix, uint32 _fixMax, uint8 _type8, uint8 _type16, uint8 _type32)
+{
+	if (_fixMax && _length <= _fixMax) {
+		out_.Put((char)(_fix | _length));
+	} else if (_type8 && _length <= 0xff) {
+		MsgPackPut(out_, _type8, _length, 1);
+	} else if (_length <= 0xffff) {
+		MsgPackPut(out_, _type16, _length, 2);
+	} else {
+		MsgPackPut(out_, _type32, _length, 4);
+	}
+}
+
+template <typename tStream>
+static void MsgPackWriteString(tStream& out_, const char* _str, uint32 _length)
+{
+	if (IsRawBinary(_str, _length)) {
+		MsgPackPutLength(out_, _length - 1, 0, 0, 0xc4, 0xc5, 0xc6);
+		StreamWrite(out_, _str + 1, _length - 1);
+	} else {
+		MsgPackPutLength(out_, _length, 0xa0, 31, 0xd9, 0xda, 0xdb);
+		StreamWrite(out_, _str, _length);
+	}
+}
+
+template <typename tStream>
+static void MsgPackWrite(const JsonValue& _value, tStream& out_)
+{
+	switch (_value.GetType()) {
+		case rapidjson::kNullType:
+			out_.Put((char)0xc0);
+			break;
+		case rapidjson::kFalseType:
+			out_.Put((char)0xc2);
+			break;
+		case rapidjson::kTrueType:
+			out_.Put((char)0xc3);
+			break;
+		case rapidjson::kNumberType:
+			if (_value.IsDouble()) {
+				double f64 = _value.GetDouble();
+				float  f32 = (float)f64;
+				if ((double)f32 == f64) {
+					uint32 bits;
+					memcpy(&bits, &f32, sizeof(bits));
+					MsgPackPut(out_, 0xca, bits, 4);
+				} else {
+					uint64 bits;
+					memcpy(&bits, &f64, sizeof(bits));
+					MsgPackPut(out_, 0xcb, bits, 8);
+				}
+			} else if (_value.IsUint64()) {
+				uint64 u = _value.GetUint64();
+				if (u <= 0x7f) {
+					out_.Put((char)u);
+				} else if (u <= 0xff) {
+					MsgPackPut(out_, 0xcc, u, 1);
+				} else if (u <= 0xffff) {
+					MsgPackPut(out_, 0xcd, u, 2);
+				} else if (u <= 0xffffffff) {
+					MsgPackPut(out_, 0xce, u, 4);
+				} else {
+					MsgPackPut(out_, 0xcf, u, 8);
+				}
+			} else {
+				sint64 i = _value.GetInt64(); // negative
+				if (i >= -32) {
+					out_.Put((char)i);
+				} else if (i >= INT8_MIN) {
+					MsgPackPut(out_, 0xd0, (uint64)i, 1);
+				} else if (i >= INT16_MIN) {
+					MsgPackPut(out_, 0xd1, (uint64)i, 2);
+				} else if (i >= INT32_MIN) {
+					MsgPackPut(out_, 0xd2, (uint64)i, 4);
+				} else {
+					MsgPackPut(out_, 0xd3, (uint64)i, 8);
+				}
+			}
+			break;
+		case rapidjson::kStringType:
+			MsgPackWriteString(out_, _value.GetString(), _value.GetStringLength());
+			break;
+		case rapidjson::kArrayType:
+			MsgPackPutLength(out_, _value.Size(), 0x90, 15, 0, 0xdc, 0xdd);
+			for (auto it = _value.Begin(); it != _value.End(); ++it) {
+				MsgPackWrite(*it, out_);
+			}
+			break;
+		case rapidjson::kObjectType:
+			MsgPackPutLength(out_, _value.MemberCount(), 0x80, 15, 0, 0xde, 0xdf);
+			for (auto it = _value.MemberBegin(); it != _value.MemberEnd(); ++it) {
+				MsgPackWriteString(out_, it->name.GetString(), it->name.GetStringLength());
+				MsgPackWrite(it->value, out_);
+			}
+			break;
+		default:
+			APT_ASSERT(false);
+			break;
+	};
+}
+
+// A MessagePack document begins with a map (the root object), text JSON can't begin with any of these bytes.
+static bool IsMessagePack(const char* _data, uint64 _sizeBytes)
+{
+	if (!_data || _sizeBytes == 0) {
+		return false;
+	}
+	uint8 c = (uint8)_data[0];
+	return (c & 0xf0) == 0x80 || c == 0xde || c == 0xdf;
+}
+
+// Send SAX events for a MessagePack document to a handler (e.g. a rapidjson document).
+struct MsgPackReader
+{
+	static const int kMaxDepth = 512;
+
+	const uint8*        m_cur;
+	const uint8*        m_end;
+	const char*         m_error = nullptr;
+	eastl::vector<char> m_bin;   // raw binary string, '\0' + data
+
+	MsgPackReader(const char* _data, uint64 _sizeBytes)
+		: m_cur((const uint8*)_data)
+		, m_end((const uint8*)_data + _sizeBytes)
 	{
-		auto& container = m_containerStack.back();
-		auto containerType = container.getType();
-		APT_ASSERT(containerType == ValueType_Array);
-		m_currentValue.m_index = (int)container.m_value->Size();
-		container.m_value->PushBack(rapidjson::Value().Move(), m_dom.GetAllocator());
-		m_currentValue.m_name  = "";
-		m_currentValue.m_value = container.m_value->End() - 1;
 	}
 
- // findGet*() optionally moves m_currentValue to the specified member/array element and returns the value
+	bool setError(const char* _error)
+	{
+		m_error = _error;
+		return false;
+	}
 
-	rapidjson::Value* findGet(const char* _name , int _i, ValueType _expectedType)
+	// Read a big endian value of _sizeBytes.
+	bool readUint(int _sizeBytes, uint64& out_)
 	{
-		if (_name) {
-			find(_name);
-		} else if (_i > -1) {
-			find(_i);
+		if (m_end - m_cur < _sizeBytes) {
+			return setError("Unexpected end of data");
 		}
-		APT_ASSERT(m_currentValue.m_value);
-		JSON_ERR_TYPE("get()", m_currentValue.m_name, m_currentValue.getType(), _expectedType, ;);
-		return m_currentValue.m_value;
+		out_ = 0;
+		for (int i = 0; i < _sizeBytes; ++i) {
+			out_ = (out_ << 8) | *m_cur++;
+		}
+		return true;
 	}
 
-	bool findGetBool(const char * _name, int _i)
+	// Read _length bytes, return nullptr if there isn't enough data.
+	const char* readBytes(uint64 _length)
 	{
-		return findGet(_name, _i, ValueType_Bool)->GetBool();
+		if ((uint64)(m_end - m_cur) < _length) {
+			setError("Unexpected end of data");
+			return nullptr;
+		}
+		const char* ret = (const char*)m_cur;
+		m_cur += _length;
+		return ret;
 	}
 
-	const char* findGetString(const char * _name, int _i)
+	// Read a string length for _type, return false if _type isn't a string.
+	bool readStringLength(uint8 _type, uint64& length_)
 	{
-		return findGet(_name, _i, ValueType_String)->GetString();
+		if ((_type & 0xe0) == 0xa0) {
+			length_ = _type & 0x1f;
+			return true;
+		}
+		switch (_type) {
+			case 0xd9: return readUint(1, length_);
+			case 0xda: return readUint(2, length_);
+			case 0xdb: return readUint(4, length_);
+			default:   return false;
+		};
 	}
 
-	template <typename T>
-	T findGetNumber(const char* _name, int _i)
+	template <typename tHandler>
+	bool readRoot(tHandler& handler_)
 	{
-		switch (APT_DATA_TYPE_TO_ENUM(T)) {
-			default:
-			case DataType_Uint8:
-			case DataType_Uint8N:
-			case DataType_Uint16:
-			case DataType_Uint16N:
-			case DataType_Uint32:
-			case DataType_Uint32N:
-				return (T)findGet(_name, _i, ValueType_Number)->GetUint();
-			case DataType_Uint64:
-			case DataType_Uint64N:
-				return (T)findGet(_name, _i, ValueType_Number)->GetUint64();
-			case DataType_Sint8:
-			case DataType_Sint8N:
-			case DataType_Sint16:
-			case DataType_Sint16N:
-			case DataType_Sint32:
-			case DataType_Sint32N:
-				return (T)findGet(_name, _i, ValueType_Number)->GetInt();
-			case DataType_Sint64:
-			case DataType_Sint64N:
-				return (T)findGet(_name, _i, ValueType_Number)->GetUint();
-			case DataType_Float16: 
-				return (T)PackFloat16(findGet(_name, _i, ValueType_Number)->GetFloat());
-			case DataType_Float32:
-				return (T)findGet(_name, _i, ValueType_Number)->GetFloat();
-			case DataType_Float64:
-				return (T)findGet(_name, _i, ValueType_Number)->GetDouble();
-		};
+		if (m_cur == m_end || !IsMessagePack((const char*)m_cur, 1)) {
+			return setError("Root must be a map");
+		}
+		return readValue(handler_, 0);
 	}
 
-	template <typename T>
-	T findGetVector(const char* _name, int _i)
+	template <typename tHandler>
+	bool readValue(tHandler& handler_, int _depth)
 	{
-	 // vectors are arrays of numbers
-		T ret = T(APT_TRAITS_BASE_TYPE(T)(0));
-		auto val = findGet(_name, _i, ValueType_Array);
-		auto arr = val->GetArray();
-		JSON_ERR_SIZE("getVector", m_currentValue.m_name, (int)arr.Size(), APT_TRAITS_COUNT(T), return ret);
-		JSON_ERR_TYPE("getVector", m_currentValue.m_name, GetValueType(arr[0].GetType()), ValueType_Number, return ret);
+		if (m_cur == m_end) {
+			return setError("Unexpected end of data");
+		}
+		uint8 type = *m_cur++;
+		if (type <= 0x7f) {
+			return handler_.Uint(type);
+		}
+		if (type >= 0xe0) {
+			return handler_.Int((sint8)type);
+		}
+		if ((type & 0xf0) == 0x80) {
+			return readMap(handler_, type & 0x0f, _depth);
+		}
+		if ((type & 0xf0) == 0x90) {
+			return readArray(handler_, type & 0x0f, _depth);
+		}
 
-		typedef APT_TRAITS_BASE_TYPE(T) BaseType;
-		if (DataTypeIsFloat(APT_DATA_TYPE_TO_ENUM(BaseType))) {
-			for (int i = 0; i < APT_TRAITS_COUNT(T); ++i) {
-				ret[i] = (BaseType)arr[i].GetFloat();
+		uint64 n;
+		if (readStringLength(type, n)) {
+			const char* str = readBytes(n);
+			if (str && IsRawBinary(str, (uint)n)) {
+				return setError(kReservedStringError);
 			}
-		} else {
-			if (DataTypeIsSigned(APT_DATA_TYPE_TO_ENUM(BaseType))) {
-				for (int i = 0; i < APT_TRAITS_COUNT(T); ++i) {
-					ret[i] = (BaseType)arr[i].GetInt();
+			return str && handler_.String(str, (rapidjson::SizeType)n, true);
+		}
+		if (m_error) {
+			return false;
+		}
+
+		switch (type) {
+			case 0xc0: return handler_.Null();
+			case 0xc2: return handler_.Bool(false);
+			case 0xc3: return handler_.Bool(true);
+			case 0xc4:
+			case 0xc5:
+			case 0xc6: {
+				if (!readUint(1 << (type - 0xc4), n)) {
+					return false;
 				}
-			} else {
-				for (int i = 0; i < APT_TRAITS_COUNT(T); ++i) {
-					ret[i] = (BaseType)arr[i].GetUint();
+				const char* bin = readBytes(n);
+				if (!bin) {
+					return false;
 				}
+				m_bin.resize(n + 1);
+				m_bin[0] = '\0';
+				memcpy(m_bin.data() + 1, bin, n);
+				return handler_.String(m_bin.data(), (rapidjson::SizeType)m_bin.size(), true);
 			}
-		}		
-		return ret;
+			case 0xca: {
+				if (!readUint(4, n)) {
+					return false;
+				}
+				uint32 bits = (uint32)n;
+				float f32;
+				memcpy(&f32, &bits, sizeof(f32));
+				return handler_.Double((double)f32);
+			}
+			case 0xcb: {
+				if (!readUint(8, n)) {
+					return false;
+				}
+				double f64;
+				memcpy(&f64, &n, sizeof(f64));
+				return handler_.Double(f64);
+			}
+			case 0xcc:
+			case 0xcd:
+			case 0xce:
+			case 0xcf:
+				return readUint(1 << (type - 0xcc), n) && handler_.Uint64(n);
+			case 0xd0:
+			case 0xd1:
+			case 0xd2:
+			case 0xd3: {
+				int sizeBytes = 1 << (type - 0xd0);
+				if (!readUint(sizeBytes, n)) {
+					return false;
+				}
+				int shift = 64 - sizeBytes * 8; // sign extend
+				return handler_.Int64((sint64)(n << shift) >> shift);
+			}
+			case 0xdc:
+			case 0xdd:
+				return readUint(type == 0xdc ? 2 : 4, n) && readArray(handler_, n, _depth);
+			case 0xde:
+			case 0xdf:
+				return readUint(type == 0xde ? 2 : 4, n) && readMap(handler_, n, _depth);
+			default:
+				return setError("Unsupported type (extension types aren't supported)");
+		};
 	}
 
-	template <typename T, int kCount> // \hack APT_TRAITS_COUNT(T) returns the # of floats in the matrix, hence kCount for the # of vectors
-	T findGetMatrix(const char* _name, int _i)
+	template <typename tHandler>
+	bool readArray(tHandler& handler_, uint64 _count, int _depth)
 	{
-	 // matrices are arrays of vectors
-		auto val = findGet(_name, _i, ValueType_Array);
-		auto rows = val->GetArray();
-		JSON_ERR_SIZE("getMatrix", m_currentValue.m_name, (int)rows.Size(), kCount, return identity);
-		JSON_ERR_TYPE("getMatrix", m_currentValue.m_name, GetValueType(rows[0].GetType()), ValueType_Array, return identity);
-
-		T ret;
-		for (int i = 0; i < kCount; ++i) {
-			for (int j = 0; j < kCount; ++j) { // only square matrices supported
-				auto& row = rows[i];
-				JSON_ERR_SIZE("getMatrix", m_currentValue.m_name, (int)row.Size(), kCount, return identity);
-				ret[i][j] = row[j].GetFloat();
+		if (_depth == kMaxDepth) {
+			return setError("Maximum depth exceeded");
+		}
+		if (_count > (uint64)(m_end - m_cur)) { // each element is at least 1 byte
+			return setError("Unexpected end of data");
+		}
+		if (!handler_.StartArray()) {
+			return false;
+		}
+		for (uint64 i = 0; i < _count; ++i) {
+			if (!readValue(handler_, _depth + 1)) {
+				return false;
 			}
-		}		
-		return ret;
+		}
+		return handler_.EndArray((rapidjson::SizeType)_count);
 	}
 
- // findAdd*() optionally moves m_currentValue to the specified member/array element and returns the value
-
-	rapidjson::Value* findAdd(const char* _name , int _i)
+	template <typename tHandler>
+	bool readMap(tHandler& handler_, uint64 _count, int _depth)
 	{
-		if (_name) {
-			if (!find(_name)) {
-				addNew(_name);
+		if (_depth == kMaxDepth) {
+			return setError("Maximum depth exceeded");
+		}
+		if (_count > (uint64)(m_end - m_cur) / 2) { // each member is at least 2 bytes
+			return setError("Unexpected end of data");
+		}
+		if (!handler_.StartObject()) {
+			return false;
+		}
+		for (uint64 i = 0; i < _count; ++i) {
+			uint64 n;
+			if (m_cur == m_end || !readStringLength(*m_cur++, n)) {
+				return m_error ? false : setError("Map keys must be strings");
 			}
-		} else if (_i > -1) {
-			if (!find(_i)) {
-				APT_ASSERT(false); // \todo what to do in this case?
+			const char* key = readBytes(n);
+			if (!key || !handler_.Key(key, (rapidjson::SizeType)n, true) || !readValue(handler_, _depth + 1)) {
+				return false;
 			}
 		}
-		APT_ASSERT(m_currentValue.m_value);
-		return m_currentValue.m_value;
+		return handler_.EndObject((rapidjson::SizeType)_count);
 	}
+};
 
-	void findAddBool(const char* _name, int _i, bool _value)
-	{
-		findAdd(_name, _i)->SetBool(_value);
+template <typename tStream>
+static bool WriteDom(const JsonDocument& _dom, tStream& out_, Json::WriteFlags _flags)
+{
+	if (_flags & Json::WriteFlags_MessagePack) {
+		MsgPackWrite(_dom, out_);
+		return true;
 	}
+	if (_flags & Json::WriteFlags_Pretty) {
+		rapidjson::PrettyWriter<tStream> writer(out_);
+		writer.SetIndent('\t', 1);
+		if (_flags & Json::WriteFlags_SingleLineArrays) {
+			writer.SetFormatOptions(rapidjson::kFormatSingleLineArray);
+		}
+		JsonTextHandler<rapidjson::PrettyWriter<tStream> > handler(writer);
+		return _dom.Accept(handler);
+	}
+	rapidjson::Writer<tStream> writer(out_);
+	JsonTextHandler<rapidjson::Writer<tStream> > handler(writer);
+	return _dom.Accept(handler);
+}
 
-	void findAddString(const char* _name, int _i, const char* _value)
+// Deep copy _src to dst_, all strings are copied (rapidjson's copy ctor keeps references to const strings).
+static void CopyValue(JsonValue& dst_, const JsonValue& _src, JsonAllocator& _allocator_)
+{
+	switch (_src.GetType()) {
+		case rapidjson::kStringType:
+			dst_.SetString(_src.GetString(), _src.GetStringLength(), _allocator_);
+			break;
+		case rapidjson::kArrayType:
+			dst_.SetArray();
+			dst_.Reserve(_src.Size(), _allocator_);
+			for (auto it = _src.Begin(); it != _src.End(); ++it) {
+				JsonValue v;
+				CopyValue(v, *it, _allocator_);
+				dst_.PushBack(v, _allocator_);
+			}
+			break;
+		case rapidjson::kObjectType:
+			dst_.SetObject();
+			for (auto it = _src.MemberBegin(); it != _src.MemberEnd(); ++it) {
+				JsonValue name(it->name.GetString(), it->name.GetStringLength(), _allocator_);
+				JsonValue v;
+				CopyValue(v, it->value, _allocator_);
+				dst_.AddMember(name, v, _allocator_);
+			}
+			break;
+		default:
+			dst_.CopyFrom(_src, _allocator_);
+			break;
+	};
+}
+
+/*	Json::Diff() implementation. Each container is fingerprinted with a hash of its subtree (member order is ignored for
+	objects), subtrees with matching fingerprints are then skipped without being traversed.
+*/
+struct JsonDiff
+{
+	struct Slot
 	{
-		findAdd(_name, _i)->SetString(_value, m_dom.GetAllocator());
+		const JsonValue* m_value;
+		uint64           m_fingerprint;
+	};
+	eastl::vector<Slot>  m_slots;            // container fingerprints (open addressing), scalars are hashed on demand
+	uint                 m_slotCount = 0;
+	eastl::vector<char>  m_path;             // JSON pointer to the current value
+	JsonValue*           m_ops;
+	JsonAllocator*       m_allocator;
+	int                  m_count = 0;
+
+	static uint64 Mix(uint64 _h, uint64 _x)
+	{
+		_h ^= _x + 0x9e3779b97f4a7c15ull + (_h << 6) + (_h >> 2);
+		return _h;
 	}
 
-	template <typename T>
-	void findAddNumber(const char* _name, int _i, T _value)
+	static uint64 HashScalar(const JsonValue& _value)
 	{
-		switch (APT_DATA_TYPE_TO_ENUM(T)) {
+		uint64 type = (uint64)_value.GetType() + 1;
+		switch (_value.GetType()) {
+			case rapidjson::kStringType:
+				return HashFast<uint64>(_value.GetString(), _value.GetStringLength(), type);
+			case rapidjson::kNumberType: {
+				uint64 bits;
+				if (_value.IsDouble()) {
+					double d = _value.GetDouble();
+					memcpy(&bits, &d, sizeof(bits));
+				} else if (_value.IsInt64()) {
+					bits = (uint64)_value.GetInt64();
+				} else {
+					bits = _value.GetUint64();
+				}
+				return Mix(type, bits);
+			}
 			default:
-			case DataType_Uint8:
-			case DataType_Uint8N:
-			case DataType_Uint16:
-			case DataType_Uint16N:
-			case DataType_Uint32:
-			case DataType_Uint32N:
-				findAdd(_name, _i)->SetUint((uint32)_value);
-				break;
-			case DataType_Uint64:
-			case DataType_Uint64N:
-				findAdd(_name, _i)->SetUint64((uint64)_value);
-				break;
-			case DataType_Sint8:
-			case DataType_Sint8N:
-			case DataType_Sint16:
-			case DataType_Sint16N:
-			case DataType_Sint32:
-			case DataType_Sint32N:
-				findAdd(_name, _i)->SetInt((sint32)_value);
-				break;
-			case DataType_Sint64:
-			case DataType_Sint64N:
-				findAdd(_name, _i)->SetInt64((sint64)_value);
-				break;
-			case DataType_Float16: 
-				findAdd(_name, _i)->SetFloat(UnpackFloat16((uint16)_value));
-				break;
-			case DataType_Float32:
-				findAdd(_name, _i)->SetFloat((float)_value);
-				break;
-			case DataType_Float64:
-				findAdd(_name, _i)->SetDouble((double)_value);
-				break;
+				return Mix(type, 0);
 		};
 	}
 
-	template <typename T>
-	void findAddVector(const char* _name, int _i, const T& _value)
+	uint64 fingerprint(const JsonValue& _value)
 	{
-		int n = APT_TRAITS_COUNT(T);
-		auto vec = findAdd(_name, _i);
-		vec->SetArray();
-		for (int i = 0; i < n; ++i) {
-			vec->PushBack(_value[i], m_dom.GetAllocator());
+		uint64 ret;
+		if (_value.IsArray()) {
+			ret = Mix(rapidjson::kArrayType, _value.Size());
+			for (auto it = _value.Begin(); it != _value.End(); ++it) {
+				ret = Mix(ret, fingerprint(*it));
+			}
+		} else if (_value.IsObject()) {
+			uint64 sum = 0;
+			for (auto it = _value.MemberBegin(); it != _value.MemberEnd(); ++it) {
+				uint64 name = HashFast<uint64>(it->name.GetString(), it->name.GetStringLength());
+				sum += Mix(name, fingerprint(it->value)); // order independent
+			}
+			ret = Mix(Mix(rapidjson::kObjectType, _value.MemberCount()), sum);
+		} else {
+			return HashScalar(_value);
 		}
+		insert(&_value, ret);
+		return ret;
 	}
 
-	template <typename T, int kCount> // \hack APT_TRAITS_COUNT(T) returns the # of floats in the matrix, hence kCount for the # of vectors
-	void findAddMatrix(const char* _name, int _i, const T& _value)
+	uint64 getFingerprint(const JsonValue& _value) const
 	{
-		auto mat = findAdd(_name, _i);
-		mat->SetArray();
-		for (int i = 0; i < kCount; ++i) {
-			mat->PushBack(rapidjson::Value().SetArray().Move(), m_dom.GetAllocator());
-			auto& row = *(mat->End() - 1);
-			for (int j = 0; j < kCount; ++j) {
-				row.PushBack(_value[i][j], m_dom.GetAllocator());
+		if (_value.IsArray() || _value.IsObject()) {
+			uint mask = (uint)m_slots.size() - 1;
+			for (uint i = HashPointer(&_value) & mask; m_slots[i].m_value; i = (i + 1) & mask) {
+				if (m_slots[i].m_value == &_value) {
+					return m_slots[i].m_fingerprint;
+				}
 			}
+			APT_ASSERT(false);
 		}
+		return HashScalar(_value);
 	}
-};
 
-
-bool Json::Read(Json& json_, const File& _file)
-{
-	json_.m_impl->m_dom.Parse(_file.getData());
-	if (json_.m_impl->m_dom.HasParseError()) {
-		APT_LOG_ERR("Json: %s\n\t'%s'", _file.getPath(), rapidjson::GetParseError_En(json_.m_impl->m_dom.GetParseError()));
-		return false;
+	static uint HashPointer(const JsonValue* _value)
+	{
+		uint64 x = (uint64)(uintptr_t)_value;
+		x ^= x >> 33;
+		x *= 0xff51afd7ed558ccdull;
+		x ^= x >> 33;
+		return (uint)x;
 	}
-	return true;
-}
 
-bool Json::Read(Json& json_, const char* _path, int _root)
-{
-	APT_AUTOTIMER("Json::Read(%s)", _path);
-	File f;
-	if (!FileSystem::ReadIfExists(f, _path, _root)) {
-		return false;
+	void insert(const JsonValue* _value, uint64 _fingerprint)
+	{
+		if ((m_slotCount + 1) * 2 > m_slots.size()) {
+			eastl::vector<Slot> slots(APT_MAX((uint)m_slots.size() * 2, (uint)1024), Slot{ nullptr, 0 });
+			m_slots.swap(slots);
+			m_slotCount = 0;
+			for (const Slot& slot : slots) {
+				if (slot.m_value) {
+					insert(slot.m_value, slot.m_fingerprint);
+				}
+			}
+		}
+		uint mask = (uint)m_slots.size() - 1;
+		uint i = HashPointer(_value) & mask;
+		while (m_slots[i].m_value) {
+			i = (i + 1) & mask;
+		}
+		m_slots[i] = Slot{ _value, _fingerprint };
+		++m_slotCount;
 	}
-	return Read(json_, f);
-}
-
-bool Json::Write(const Json& _json, File& file_)
-{
-	rapidjson::StringBuffer buf;
-	rapidjson::PrettyWriter<rapidjson::StringBuffer> wr(buf);
-	wr.SetIndent('\t', 1);
-	wr.SetFormatOptions(rapidjson::kFormatSingleLineArray);
-	_json.m_impl->m_dom.Accept(wr);
-	file_.setData(buf.GetString(), buf.GetSize());
-	return true;
-}
 
-bool Json::Write(const Json& _json, const char* _path, int _root)
-{
-	APT_AUTOTIMER("Json::Write(%s)", _path);
-	File f;
-	if (Write(_json, f)) {
-		return FileSystem::Write(f, _path, _root);
+	// Find member _name of _object, try _hint first (members are usually in the same order).
+	static const JsonValue* FindMember(const JsonValue& _object, const JsonValue& _name, uint _hint)
+	{
+		if (_hint < _object.MemberCount()) {
+			auto& member = _object.MemberBegin()[_hint];
+			if (member.name == _name) {
+				return &member.value;
+			}
+		}
+		auto it = _object.FindMember(_name);
+		return it == _object.MemberEnd() ? nullptr : &it->value;
 	}
-	return false;
-}
 
-Json::Json(const char* _path, int _root)
-	: m_impl(nullptr)
-{
-	m_impl = APT_NEW(Impl);
-	m_impl->m_dom.SetObject();	
-	m_impl->reset();
-	if (_path) {
-		Json::Read(*this, _path, _root);
+	uint pushPath(const char* _token, uint _length)
+	{
+		uint ret = (uint)m_path.size();
+		m_path.push_back('/');
+		for (uint i = 0; i < _length; ++i) {
+			switch (_token[i]) {
+				case '~': m_path.push_back('~'); m_path.push_back('0'); break;
+				case '/': m_path.push_back('~'); m_path.push_back('1'); break;
+				default:  m_path.push_back(_token[i]); break;
+			};
+		}
+		return ret;
 	}
-}
 
-Json::~Json()
-{
-	if (m_impl) {
-		APT_DELETE(m_impl);
+	uint pushPath(uint _index)
+	{
+		String<16> token("%u", _index);
+		return pushPath((const char*)token, token.getLength());
 	}
-}
-
-bool Json::find(const char* _name)
-{
-	return m_impl->find(_name);
-}
-	
-bool Json::next()
-{
-	auto& container = m_impl->m_containerStack.back();
-	auto& current   = m_impl->m_currentValue;
 
-	int i = current.m_index + 1;
-	if (i >= container.getSize()) {
-		return false;
+	void popPath(uint _size)
+	{
+		m_path.resize(_size);
 	}
-	current.m_index = i;
 
-	auto containerType = container.getType();
-	if (containerType == ValueType_Object) {
-		auto it = (container.m_value->MemberBegin() + i);
-		current.m_value = &it->value;
-		current.m_name  = it->name.GetString();
-	} else if (containerType == ValueType_Array) {
-		current.m_value = container.m_value->Begin() + i;
-	} else {
-		APT_ASSERT(false);
-		return false;
+	void addOp(const char* _op, const JsonValue* _value)
+	{
+		JsonValue op(rapidjson::kObjectType);
+		op.AddMember("op", rapidjson::StringRef(_op), *m_allocator);
+		op.AddMember("path", JsonValue(m_path.data(), (rapidjson::SizeType)m_path.size(), *m_allocator), *m_allocator);
+		if (_value) {
+			JsonValue value;
+			CopyValue(value, *_value, *m_allocator);
+			op.AddMember("value", value, *m_allocator);
+		}
+		m_ops->PushBack(op, *m_allocator);
+		++m_count;
 	}
-	return true;
-}
 
-bool Json::enterObject()
-{
-	JSON_ERR_TYPE("enterObject", getName(), getType(), ValueType_Object, return false);
-	m_impl->enter();
-	return true;
-}
+	void diff(const JsonValue& _from, const JsonValue& _to)
+	{
+		if (getFingerprint(_from) == getFingerprint(_to)) {
+			return;
+		}
+		if (_from.IsObject() && _to.IsObject()) {
+			uint i = 0;
+			for (auto it = _from.MemberBegin(); it != _from.MemberEnd(); ++it, ++i) {
+				if (!FindMember(_to, it->name, i)) {
+					uint path = pushPath(it->name.GetString(), it->name.GetStringLength());
+					addOp("remove", nullptr);
+					popPath(path);
+				}
+			}
+			i = 0;
+			for (auto it = _to.MemberBegin(); it != _to.MemberEnd(); ++it, ++i) {
+				uint path = pushPath(it->name.GetString(), it->name.GetStringLength());
+				const JsonValue* from = FindMember(_from, it->name, i);
+				if (from) {
+					diff(*from, it->value);
+				} else {
+					addOp("add", &it->value);
+				}
+				popPath(path);
+			}
 
-void Json::leaveObject()
-{
-	m_impl->leave();
-	APT_ASSERT(getType() == ValueType_Object);
-}
+		} else if (_from.IsArray() && _to.IsArray()) {
+		 // elements are compared by index, trailing elements are added/removed
+			uint fromSize = _from.Size();
+			uint toSize   = _to.Size();
+			for (uint i = 0; i < APT_MIN(fromSize, toSize); ++i) {
+				uint path = pushPath(i);
+				diff(_from[i], _to[i]);
+				popPath(path);
+			}
+			for (uint i = fromSize; i > toSize; --i) { // remove from the back so that indices stay valid
+				uint path = pushPath(i - 1);
+				addOp("remove", nullptr);
+				popPath(path);
+			}
+			for (uint i = fromSize; i < toSize; ++i) {
+				uint path = pushPath(i);
+				addOp("add", &_to[i]);
+				popPath(path);
+			}
 
-bool Json::enterArray()
-{
-	JSON_ERR_TYPE("enterArray", getName(), getType(), ValueType_Array, return false);
-	m_impl->enter();
-	return true;
-}
+		} else {
+			addOp("replace", &_to);
+		}
+	}
+};
 
-void Json::leaveArray()
+// Json::ApplyPatch() implementation.
+struct JsonPatch
 {
-	m_impl->leave();
-	APT_ASSERT(getType() == ValueType_Array);
-}
+	// Parse the next token from a JSON pointer into token_ (unescaped), return the next token or nullptr if at the end.
+	static const char* NextToken(const char* _path, eastl::vector<char>& token_)
+	{
+		token_.clear();
+		APT_ASSERT(*_path == '/');
+		++_path;
+		for (; *_path && *_path != '/'; ++_path) {
+			if (*_path == '~' && (_path[1] == '0' || _path[1] == '1')) {
+				token_.push_back(_path[1] == '0' ? '~' : '/');
+				++_path;
+			} else {
+				token_.push_back(*_path);
+			}
+		}
+		return *_path ? _path : nullptr;
+	}
 
-void Json::reset()
-{
-	m_impl->reset();
-}
+	// Return a ptr to the token chars, "" if the token is empty (rapidjson asserts on a null string).
+	static const char* TokenStr(const eastl::vector<char>& _token)
+	{
+		return _token.empty() ? "" : _token.data();
+	}
 
-Json::ValueType Json::getType() const
-{
-	return m_impl->m_currentValue.getType();
+	// Return -1 if _token isn't a valid index, or _size if _token is "-" (end of the array).
+	static int ParseIndex(const eastl::vector<char>& _token, uint _size)
+	{
+		if (_token.size() == 1 && _token[0] == '-') {
+			return (int)_size;
+		}
+		if (_token.empty() || _token.size() > 9 || (_token[0] == '0' && _token.size() > 1)) {
+			return -1;
+		}
+		int ret = 0;
+		for (char c : _token) {
+			if (c < '0' || c > '9') {
+				return -1;
+			}
+			ret = ret * 10 + (c - '0');
+		}
+		return ret;
+	}
+
+	// Apply a single operation, return an error string or nullptr on success.
+	static const char* Apply(JsonDocument& dom_, const char* _op, const char* _path, const JsonValue* _value)
+	{
+		bool add     = strcmp(_op, "add") == 0;
+		bool remove  = strcmp(_op, "remove") == 0;
+		bool replace = strcmp(_op, "replace") == 0;
+		if (!add && !remove && !replace) {
+			return "unsupported op";
+		}
+		if (!remove && !_value) {
+			return "missing value";
+		}
+		JsonAllocator& allocator = dom_.GetAllocator();
+
+		if (*_path == '\0') { // whole document
+			if (!replace && !add) {
+				return "can't remove the root";
+			}
+			if (!_value->IsObject()) {
+				return "root must be an object";
+			}
+			JsonValue root;
+			CopyValue(root, *_value, allocator);
+			static_cast<JsonValue&>(dom_).Swap(root);
+			return nullptr;
+		}
+		if (*_path != '/') {
+			return "invalid path";
+		}
+
+	 // find the parent container
+		eastl::vector<char> token;
+		JsonValue* parent = &dom_;
+		const char* next = NextToken(_path, token);
+		while (next) {
+			if (parent->IsObject()) {
+				auto it = parent->FindMember(JsonValue(rapidjson::StringRef(TokenStr(token), (rapidjson::SizeType)token.size())));
+				if (it == parent->MemberEnd()) {
+					return "path not found";
+				}
+				parent = &it->value;
+			} else if (parent->IsArray()) {
+				int i = ParseIndex(token, parent->Size());
+				if (i < 0 || i >= (int)parent->Size()) {
+					return "path not found";
+				}
+				parent = &(*parent)[i];
+			} else {
+				return "path not found";
+			}
+			next = NextToken(next, token);
+		}
+
+		if (parent->IsObject()) {
+			JsonValue name(rapidjson::StringRef(TokenStr(token), (rapidjson::SizeType)token.size()));
+			auto it = parent->FindMember(name);
+			if (remove || replace) {
+				if (it == parent->MemberEnd()) {
+					return "path not found";
+				}
+				if (remove) {
+					parent->EraseMember(it); // preserve member order
+					return nullptr;
+				}
+			}
+			JsonValue value;
+			CopyValue(value, *_value, allocator);
+			if (it != parent->MemberEnd()) {
+				it->value = value;
+			} else {
+				parent->AddMember(JsonValue(TokenStr(token), (rapidjson::SizeType)token.size(), allocator), value, allocator);
+			}
+
+		} else if (parent->IsArray()) {
+			uint size = parent->Size();
+			int i = ParseIndex(token, size);
+			if (i < 0 || i > (int)size || (i == (int)size && !add)) {
+				return "invalid array index";
+			}
+			if (remove) {
+				parent->Erase(parent->Begin() + i);
+				return nullptr;
+			}
+			JsonValue value;
+			CopyValue(value, *_value, allocator);
+			if (replace) {
+				(*parent)[i] = value;
+			} else {
+				parent->PushBack(value, allocator);
+				for (uint j = size; j > (uint)i; --j) { // insert
+					(*parent)[j].Swap((*parent)[j - 1]);
+				}
+			}
+
+		} else {
+			return "path not found";
+		}
+		return nullptr;
+	}
+};
+
+// Worker threads for Json::ReadAsync(). Threads are created on the first call and joined at exit.
+struct JsonReadAsync
+{
+	enum State
+	{
+		State_Pending,   // waiting for a worker
+		State_Reading,   // being read by a worker
+		State_Complete,  // waiting for DispatchReadAsync()
+	};
+
+	struct Request
+	{
+		Json::ReadAsyncId        m_id;
+		PathStr                  m_path;
+		int                      m_root;
+		Json::ReadAsyncCallback* m_callback;
+		void*                    m_userData;
+		bool                     m_defer;
+		bool                     m_cancelled;
+		State                    m_state;
+		Json*                    m_json;
+		String<256>              m_error;       // first error logged during the read, empty on success
+	};
+
+	std::mutex                  m_mutex;
+	std::condition_variable     m_cvPending;    // a request was added, or m_stop
+	std::condition_variable     m_cvComplete;   // m_busyCount was decremented
+	eastl::vector<Request*>     m_requests;     // in submission order
+	eastl::vector<std::thread>  m_threads;
+	Json::ReadAsyncId           m_nextId    = 1;
+	uint                        m_busyCount = 0; // requests not yet State_Complete, including callbacks executing on a worker
+	bool                        m_stop      = false;
+
+	static JsonReadAsync& Get()
+	{
+		static JsonReadAsync s_instance;
+		return s_instance;
+	}
+
+	// The log callback is per thread, hence errors logged on a worker wouldn't reach the application's callback. While a
+	// worker reads, errors are instead captured in the request and passed to the request's callback.
+	static thread_local Request* s_current;
+
+	static void CaptureError(const char* _msg, LogType _type)
+	{
+		if (_type == LogType_Error && s_current && s_current->m_error.isEmpty()) {
+			s_current->m_error.set(_msg);
+		}
+	}
+
+	static const char* GetError(const Request* _request)
+	{
+		return _request->m_error.isEmpty() ? nullptr : (const char*)_request->m_error;
+	}
+
+	~JsonReadAsync()
+	{
+		{	std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		m_cvPending.notify_all();
+		for (auto& thread : m_threads) {
+			thread.join();
+		}
+		for (Request* request : m_requests) {
+			APT_DELETE(request->m_json);
+			APT_DELETE(request);
+		}
+	}
+
+	Json::ReadAsyncId add(const char* _path, int _root, Json::ReadAsyncCallback* _callback, void* _userData, bool _defer)
+	{
+		Request* request     = APT_NEW(Request);
+		request->m_path      = _path;
+		request->m_root      = _root;
+		request->m_callback  = _callback;
+		request->m_userData  = _userData;
+		request->m_defer     = _defer;
+		request->m_cancelled = false;
+		request->m_state     = State_Pending;
+		request->m_json      = nullptr;
+		Json::ReadAsyncId id;
+		{	std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_threads.empty()) {
+				uint threadCount = APT_CLAMP(std::thread::hardware_concurrency(), 2u, 5u) - 1; // 1-4 workers
+				for (uint i = 0; i < threadCount; ++i) {
+					m_threads.push_back(std::thread([this]() { work(); }));
+				}
+			}
+			id = request->m_id = m_nextId++;
+			if (m_nextId == 0) {
+				m_nextId = 1;
+			}
+			m_requests.push_back(request);
+			++m_busyCount;
+		}
+		m_cvPending.notify_one();
+		return id; // request may already have been released by a worker
+	}
+
+	bool cancel(Json::ReadAsyncId _id)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (auto it = m_requests.begin(); it != m_requests.end(); ++it) {
+			Request* request = *it;
+			if (request->m_id != _id) {
+				continue;
+			}
+			switch (request->m_state) {
+				case State_Pending:
+					--m_busyCount;
+					m_cvComplete.notify_all();
+					break;
+				case State_Reading:
+					request->m_cancelled = true; // the worker releases the request
+					return true;
+				default:
+					break;
+			};
+			m_requests.erase(it);
+			APT_DELETE(request->m_json);
+			APT_DELETE(request);
+			return true;
+		}
+		return false;
+	}
+
+	int dispatch()
+	{
+		eastl::vector<Request*> complete;
+		{	std::lock_guard<std::mutex> lock(m_mutex);
+			for (auto it = m_requests.begin(); it != m_requests.end();) {
+				if ((*it)->m_state == State_Complete) {
+					complete.push_back(*it);
+					it = m_requests.erase(it);
+				} else {
+					++it;
+				}
+			}
+		}
+		for (Request* request : complete) {
+			request->m_callback(request->m_path.c_str(), request->m_json, GetError(request), request->m_userData);
+			APT_DELETE(request);
+		}
+		return (int)complete.size();
+	}
+
+	int wait()
+	{
+		{	std::unique_lock<std::mutex> lock(m_mutex);
+			m_cvComplete.wait(lock, [this]() { return m_busyCount == 0; });
+		}
+		return dispatch();
+	}
+
+	void work()
+	{
+		for (;;) {
+			Request* request = nullptr;
+			{	std::unique_lock<std::mutex> lock(m_mutex);
+				m_cvPending.wait(lock, [&]()
+					{
+						if (m_stop) {
+							return true;
+						}
+						for (Request* r : m_requests) {
+							if (r->m_state == State_Pending) {
+								request = r;
+								return true;
+							}
+						}
+						return false;
+					});
+				if (m_stop) {
+					return;
+				}
+				request->m_state = State_Reading;
+			}
+
+			Json* json = APT_NEW(Json);
+			LogCallback* logCallback = GetLogCallback();
+			s_current = request;
+			SetLogCallback(CaptureError);
+			File f;
+			if (!FileSystem::ReadIfExists(f, request->m_path.c_str(), request->m_root)) {
+				if (request->m_error.isEmpty()) {
+					request->m_error.setf("Json::ReadAsync: '%s' not found", request->m_path.c_str());
+				}
+				APT_DELETE(json);
+				json = nullptr;
+			} else if (!Json::Read(*json, f)) {
+				APT_DELETE(json);
+				json = nullptr;
+			}
+			SetLogCallback(logCallback);
+			s_current = nullptr;
+
+			bool callback = false;
+			{	std::lock_guard<std::mutex> lock(m_mutex);
+				if (request->m_cancelled) {
+					m_requests.erase(eastl::find(m_requests.begin(), m_requests.end(), request));
+					APT_DELETE(json);
+					APT_DELETE(request);
+					request = nullptr;
+				} else if (request->m_defer) {
+					request->m_json  = json;
+					request->m_state = State_Complete;
+				} else {
+					m_requests.erase(eastl::find(m_requests.begin(), m_requests.end(), request));
+					callback = true;
+				}
+			}
+			if (callback) {
+				request->m_callback(request->m_path.c_str(), json, GetError(request), request->m_userData);
+				APT_DELETE(request);
+			}
+			{	std::lock_guard<std::mutex> lock(m_mutex);
+				--m_busyCount;
+			}
+			m_cvComplete.notify_all();
+		}
+	}
+};
+
+thread_local JsonReadAsync::Request* JsonReadAsync::s_current;
+
+static Json::ValueType GetValueType(rapidjson::Type _type)
+{
+	switch (_type) {
+		case rapidjson::kNullType:   return Json::ValueType_Null;
+		case rapidjson::kObjectType: return Json::ValueType_Object;
+		case rapidjson::kArrayType:  return Json::ValueType_Array;
+		case rapidjson::kFalseType:
+		case rapidjson::kTrueType:   return Json::ValueType_Bool;
+		case rapidjson::kNumberType: return Json::ValueType_Number;
+		case rapidjson::kStringType: return Json::ValueType_String;
+		default: APT_ASSERT(false); break;
+	};
+
+	return Json::ValueType_Count;
+}
+
+static const char* GetValueTypeString(Json::ValueType _type)
+{
+	switch (_type) {
+		case Json::ValueType_Null:    return "Null";
+		case Json::ValueType_Object:  return "Object";
+		case Json::ValueType_Array:   return "Array";
+		case Json::ValueType_Bool:    return "Bool";
+		case Json::ValueType_Number:  return "Number";
+		case Json::ValueType_String:  return "String";
+		default:                      return "Unknown";
+	};
+}
+
+// Convert a number or bool to T. Integers are converted from their stored type, doubles are clamped to the range of integer
+// types (an out of range conversion is undefined).
+template <typename T>
+static T GetNumber(const JsonValue& _value)
+{
+	switch (APT_DATA_TYPE_TO_ENUM(T)) {
+		case DataType_Float16: 
+			return (T)PackFloat16(_value.IsBool() ? (float)_value.GetBool() : _value.GetFloat());
+		case DataType_Float32:
+		case DataType_Float64:
+			return _value.IsBool() ? (T)_value.GetBool() : (T)_value.GetDouble();
+		default:
+			break;
+	};
+	if (_value.IsInt64()) {
+		return (T)_value.GetInt64();
+	}
+	if (_value.IsUint64()) {
+		return (T)_value.GetUint64();
+	}
+	if (_value.IsBool()) {
+		return (T)_value.GetBool();
+	}
+	double d = _value.GetDouble();
+	if (d != d) {
+		return (T)0;
+	}
+	if (d <= (double)APT_DATA_TYPE_MIN(T)) {
+		return APT_DATA_TYPE_MIN(T);
+	}
+	if (d >= (double)APT_DATA_TYPE_MAX(T)) {
+		return APT_DATA_TYPE_MAX(T);
+	}
+	return (T)d;
+}
+template <>
+bool GetNumber<bool>(const JsonValue& _value)
+{
+	return _value.IsBool() ? _value.GetBool() : _value.GetDouble() != 0.0;
+}
+
+template <typename T>
+static void SetNumber(JsonValue& value_, T _value)
+{
+	switch (APT_DATA_TYPE_TO_ENUM(T)) {
+		default:
+		case DataType_Uint8:
+		case DataType_Uint8N:
+		case DataType_Uint16:
+		case DataType_Uint16N:
+		case DataType_Uint32:
+		case DataType_Uint32N:
+			value_.SetUint((uint32)_value);
+			break;
+		case DataType_Uint64:
+		case DataType_Uint64N:
+			value_.SetUint64((uint64)_value);
+			break;
+		case DataType_Sint8:
+		case DataType_Sint8N:
+		case DataType_Sint16:
+		case DataType_Sint16N:
+		case DataType_Sint32:
+		case DataType_Sint32N:
+			value_.SetInt((sint32)_value);
+			break;
+		case DataType_Sint64:
+		case DataType_Sint64N:
+			value_.SetInt64((sint64)_value);
+			break;
+		case DataType_Float16: 
+			value_.SetFloat(UnpackFloat16((uint16)_value));
+			break;
+		case DataType_Float32:
+			value_.SetFloat((float)_value);
+			break;
+		case DataType_Float64:
+			value_.SetDouble((double)_value);
+			break;
+	};
+}
+template <>
+void SetNumber<bool>(JsonValue& value_, bool _value)
+{
+	value_.SetBool(_value);
+}
+
+// Hash used by the member index and JsonPath.
+static uint32 HashMemberName(const char* _name)
+{
+	return (uint32)StringHash(_name).getHash();
+}
+
+/*******************************************************************************
+
+                                   Json
+
+*******************************************************************************/
+
+/*	Traversal of the dom:
+		- Stack is for container objects only, maintain a separate Value instance for the
+		  position *within* the current container. Need to support json whose root isn't an
+		  object?
+		- find() moves within the current container - takes either a name or an index. ONLY
+		  after calling find() can you call enter/leave, get/set etc.
+
+	\todo		
+	- "call stack" for errors
+	- Matrices should be row major
+*/
+struct Json::Impl
+{
+	Pool                        m_ownPool;       // used if no pool was passed to the ctor
+	Pool*                       m_pool;
+	internal::JsonPoolAllocator m_baseAllocator;
+	JsonAllocator               m_allocator;
+	JsonDocument                m_dom;
+	File                        m_insitu;        // buffer for ReadInsitu(), DOM strings may point into it
+
+	struct Value
+	{
+		JsonValue* m_value  = nullptr;
+		const char*       m_name   = "";       // value name
+		int               m_index  = -1;       // value index in the parent container
+
+		ValueType getType()
+		{
+			return GetValueType(m_value->GetType()); 
+		}
+
+		int getSize() 
+		{ 
+			auto type = getType();
+			if (type == ValueType_Array) {
+				return (int)m_value->Size();
+			} else if (type == ValueType_Object) {
+				return (int)m_value->MemberCount();
+			}
+			return -1;
+		}
+	};
+	eastl::vector<Value> m_containerStack; // for traversal of containers (arrays, objects)
+	Value                m_currentValue;   // current element, index may be -1 if the previous operation was enter() or begin()
+
+	// Open addressing hash table of member indices for a single object. The table is valid while the object's member
+	// array and count match those recorded when it was built; the pool allocator never reuses memory until clear(), so
+	// a moved or replaced object can't be mistaken for the indexed one.
+	struct MemberIndex
+	{
+		struct Slot
+		{
+			uint32 m_hash;
+			uint32 m_index; // member index + 1, 0 if the slot is empty
+		};
+		JsonValue::ConstMemberIterator m_members;
+		uint32                         m_count = 0;
+		eastl::vector<Slot>            m_slots;
+
+		bool isValid(const JsonValue* _object) const
+		{
+			return _object->IsObject() && _object->MemberBegin() == m_members && _object->MemberCount() == m_count;
+		}
+
+		void build(const JsonValue* _object)
+		{
+			m_members = _object->MemberBegin();
+			m_count   = _object->MemberCount();
+			uint capacity = 16;
+			while (capacity < m_count * 2) {
+				capacity *= 2;
+			}
+			m_slots.clear();
+			m_slots.resize(capacity, Slot({ 0, 0 }));
+			for (uint32 i = 0; i < m_count; ++i) {
+				insert(HashMemberName(m_members[i].name.GetString()), i);
+			}
+		}
+
+		void insert(uint32 _hash, uint32 _index)
+		{
+			uint mask = m_slots.size() - 1;
+			uint i = _hash & mask;
+			while (m_slots[i].m_index != 0) {
+				i = (i + 1) & mask;
+			}
+			m_slots[i] = { _hash, _index + 1 };
+		}
+
+		// Return the index of the first member called _name, or -1 if not found.
+		int find(const char* _name) const
+		{
+			return find(HashMemberName(_name), _name);
+		}
+
+		int find(uint32 _hash, const char* _name) const
+		{
+			uint32 hash = _hash;
+			uint mask = m_slots.size() - 1;
+			int ret = -1;
+			for (uint i = hash & mask; m_slots[i].m_index != 0; i = (i + 1) & mask) {
+				const Slot& slot = m_slots[i];
+				if (slot.m_hash == hash && strcmp(m_members[slot.m_index - 1].name.GetString(), _name) == 0) {
+				 // duplicate names are permitted, match FindMember() by returning the first
+					if (ret < 0 || (int)slot.m_index - 1 < ret) {
+						ret = (int)slot.m_index - 1;
+					}
+				}
+			}
+			return ret;
+		}
+	};
+	eastl::hash_map<const JsonValue*, MemberIndex> m_memberIndex;
+	uint                                           m_memberIndexThreshold = kDefaultMemberIndexThreshold;
+	const JsonValue*                               m_cachedObject = nullptr; // last result of getMemberIndex()
+	MemberIndex*                                   m_cachedIndex  = nullptr;
+
+	Impl(Pool* _pool)
+		: m_pool(_pool ? _pool : &m_ownPool)
+		, m_baseAllocator(m_pool)
+		, m_allocator(m_pool->getChunkSize(), &m_baseAllocator)
+		, m_dom(&m_allocator, 1024, &m_baseAllocator) // 1024 = rapidjson's default stack capacity
+	{
+		m_dom.SetObject();
+		reset();
+	}
+
+	void clear()
+	{
+	 // the DOM must be reset before the allocator releases its chunks
+		m_dom.SetObject();
+		m_allocator.Clear();
+		if (m_insitu.getData()) {
+			m_insitu = File();
+		}
+		clearMemberIndex();
+		reset();
+	}
+
+	void clearMemberIndex()
+	{
+		m_memberIndex.clear();
+		m_cachedObject = nullptr;
+		m_cachedIndex  = nullptr;
+	}
+
+	// Return the member index for _object, building it if required, or nullptr if _object isn't indexed.
+	const MemberIndex* getMemberIndex(const JsonValue* _object)
+	{
+		if (m_memberIndexThreshold == 0 || !_object->IsObject() || _object->MemberCount() < m_memberIndexThreshold) {
+			return nullptr;
+		}
+		if (_object != m_cachedObject) {
+			m_cachedObject = _object;
+			m_cachedIndex  = &m_memberIndex[_object]; // hash_map nodes are stable
+		}
+		if (!m_cachedIndex->isValid(_object)) {
+			m_cachedIndex->build(_object);
+		}
+		return m_cachedIndex;
+	}
+
+	void reset()
+	{
+		m_containerStack.clear();
+		m_containerStack.push_back({ &m_dom, "", -1 });
+		m_currentValue = Value();
+	}
+
+	bool find(int _i)
+	{
+		auto& container = m_containerStack.back();
+		JSON_ERR_ARRAY_SIZE("find()", container.m_name, _i, container.getSize(), return false);
+		auto containerType = container.getType();
+		if (containerType == ValueType_Array) {
+			m_currentValue.m_value = container.m_value->Begin() + _i;
+			m_currentValue.m_name  = "";
+			m_currentValue.m_index = _i;
+			return true;
+
+		} else if (containerType == ValueType_Object) {
+			auto it = container.m_value->MemberBegin() + _i;
+			m_currentValue.m_value = &it->value;
+			m_currentValue.m_name  = it->name.GetString();
+			m_currentValue.m_index = _i;
+			return true;
+
+		}
+		return false;
+	}
+
+	// Return the index of the first member of _object called _name, or -1 if not found. _hash = HashMemberName(_name).
+	int findMember(JsonValue* _object, uint32 _hash, const char* _name, uint _nameLength)
+	{
+		if (const MemberIndex* index = getMemberIndex(_object)) {
+			return index->find(_hash, _name);
+		}
+		JsonValue name(rapidjson::StringRef(_name, (rapidjson::SizeType)_nameLength)); // FindMember() without strlen
+		auto it = _object->FindMember(name);
+		return it == _object->MemberEnd() ? -1 : (int)(it - _object->MemberBegin());
+	}
+
+	// Return the _i-th member/element of _container.
+	static Value GetChild(const Value& _container, int _i)
+	{
+		JsonValue* container = _container.m_value;
+		if (container->IsObject()) {
+			auto it = container->MemberBegin() + _i;
+			return { &it->value, it->name.GetString(), _i };
+		}
+		return { container->Begin() + _i, "", _i };
+	}
+
+	// Return the index of the first child of _container matching _segment after _prev (-1 = from the start), or -1.
+	int nextPathMatch(const JsonPath& _path, const JsonPath::Segment& _segment, JsonValue* _container, int _prev)
+	{
+		switch (_segment.m_type) {
+			case JsonPath::SegmentType_Member:
+				return _prev < 0 && _container->IsObject() ? findMember(_container, _segment.m_hash, _path.getName(_segment), _segment.m_nameLength) : -1;
+			case JsonPath::SegmentType_Index:
+				return _prev < 0 && _container->IsArray() && _segment.m_index < (int)_container->Size() ? _segment.m_index : -1;
+			case JsonPath::SegmentType_AnyMember:
+				return _container->IsObject() && _prev + 1 < (int)_container->MemberCount() ? _prev + 1 : -1;
+			case JsonPath::SegmentType_AnyElement:
+				return _container->IsArray() && _prev + 1 < (int)_container->Size() ? _prev + 1 : -1;
+			default:
+				APT_ASSERT(false);
+				return -1;
+		};
+	}
+
+	// Node in the chain of values visited by evalPath(), allocated on the call stack.
+	struct PathNode
+	{
+		Value           m_value;
+		const PathNode* m_parent;
+	};
+
+	// Visit the values matching segments [_segment, end) of _path, relative to _node. _onMatch_(node) returns false to
+	// stop the traversal, in which case evalPath() also returns false.
+	template <typename tOnMatch>
+	bool evalPath(const JsonPath& _path, int _segment, const PathNode& _node, tOnMatch& _onMatch_)
+	{
+		if (_segment == (int)_path.m_segments.size()) {
+			return _onMatch_(_node);
+		}
+		const JsonPath::Segment& segment = _path.m_segments[_segment];
+		JsonValue* container = _node.m_value.m_value;
+		switch (segment.m_type) {
+			case JsonPath::SegmentType_Member: {
+				if (!container->IsObject()) {
+					return true;
+				}
+				int i = findMember(container, segment.m_hash, _path.getName(segment), segment.m_nameLength);
+				if (i < 0) {
+					return true;
+				}
+				auto it = container->MemberBegin() + i;
+				PathNode child = { { &it->value, it->name.GetString(), i }, &_node };
+				return evalPath(_path, _segment + 1, child, _onMatch_);
+			}
+			case JsonPath::SegmentType_Index: {
+				if (!container->IsArray() || segment.m_index >= (int)container->Size()) {
+					return true;
+				}
+				PathNode child = { { container->Begin() + segment.m_index, "", segment.m_index }, &_node };
+				return evalPath(_path, _segment + 1, child, _onMatch_);
+			}
+			case JsonPath::SegmentType_AnyMember: {
+				if (!container->IsObject()) {
+					return true;
+				}
+				int i = 0;
+				for (auto it = container->MemberBegin(); it != container->MemberEnd(); ++it, ++i) {
+					PathNode child = { { &it->value, it->name.GetString(), i }, &_node };
+					if (!evalPath(_path, _segment + 1, child, _onMatch_)) {
+						return false;
+					}
+				}
+				return true;
+			}
+			case JsonPath::SegmentType_AnyElement: {
+				if (!container->IsArray()) {
+					return true;
+				}
+				for (int i = 0, n = (int)container->Size(); i < n; ++i) {
+					PathNode child = { { container->Begin() + i, "", i }, &_node };
+					if (!evalPath(_path, _segment + 1, child, _onMatch_)) {
+						return false;
+					}
+				}
+				return true;
+			}
+			default:
+				APT_ASSERT(false);
+				return false;
+		};
+	}
+
+	// Copy values matching _path into out_ via _get, see Json::getValues().
+	template <typename tType, typename tGet>
+	int getValues(const JsonPath& _path, ValueType _expectedType, tGet _get, tType* out_, int _maxCount)
+	{
+		if (!_path.isValid()) {
+			return 0;
+		}
+		int count = 0;
+		auto onMatch = [&](const PathNode& _node) -> bool
+			{
+				const Value& value = _node.m_value;
+				JSON_ERR_TYPE("getValues()", value.m_name, GetValueType(value.m_value->GetType()), _expectedType, return true);
+				if (count < _maxCount) {
+					out_[count] = (tType)_get(*value.m_value);
+				}
+				++count;
+				return true;
+			};
+		PathNode root = { m_containerStack.back(), nullptr };
+		evalPath(_path, 0, root, onMatch);
+		return count;
+	}
+
+	// Copy up to _maxCount elements of the current array into out_ via _get, see Json::getArray(). The element types
+	// are validated per block before conversion so that the conversion loop doesn't branch on errors.
+	template <typename tType, typename tIs, typename tGet>
+	int getArray(ValueType _expectedType, tIs _is, tGet _get, tType* out_, int _maxCount)
+	{
+		APT_ASSERT(m_currentValue.m_value);
+		JSON_ERR_TYPE("getArray()", m_currentValue.m_name, m_currentValue.getType(), ValueType_Array, return -1);
+		const JsonValue& arr = *m_currentValue.m_value;
+		const JsonValue* src = arr.Begin();
+		int count = APT_MIN((int)arr.Size(), APT_MAX(_maxCount, 0));
+		const int kBlockSize = 256; // block is L1 resident for the conversion pass
+		for (int i = 0; i < count; i += kBlockSize) {
+			int n = APT_MIN(kBlockSize, count - i);
+			bool valid = true;
+			for (int j = 0; j < n; ++j) {
+				valid &= _is(src[i + j]);
+			}
+			if (!valid) {
+				APT_LOG_ERR("Json: (getArray()) %s has an element which isn't of type %s", m_currentValue.m_name, GetValueTypeString(_expectedType));
+				return -1;
+			}
+			for (int j = 0; j < n; ++j) {
+				out_[i + j] = (tType)_get(src[i + j]);
+			}
+		}
+		return count;
+	}
+
+	bool find(const char* _name)
+	{
+		auto& container = m_containerStack.back();
+		//JSON_ERR_TYPE("find()", container.m_name, ValueType_Object, container.getType(), return false);
+		JsonValue::MemberIterator it;
+		if (const MemberIndex* index = getMemberIndex(container.m_value)) {
+			int i = index->find(_name);
+			if (i < 0) {
+				return false;
+			}
+			it = container.m_value->MemberBegin() + i;
+		} else {
+			it = container.m_value->FindMember(_name);
+			if (it == container.m_value->MemberEnd()) {
+				return false;
+			}
+		}
+		m_currentValue.m_value = &it->value;
+		m_currentValue.m_name  = it->name.GetString();
+		m_currentValue.m_index = (int)(it - container.m_value->MemberBegin());
+		return true;
+	}
+
+	void enter()
+	{
+		auto& container = m_containerStack.back();
+		auto containerType = container.getType();
+		APT_ASSERT(containerType == ValueType_Object || containerType == ValueType_Array);
+		m_containerStack.push_back(m_currentValue);
+		m_currentValue = Value();
+
+	 // In some cases we enter an object/array *before* we can get the name, for example when using `while (beginObject)` from the serializer class.
+	 // To work around this we copy the container name into the dummy current value.
+		m_currentValue.m_name = m_containerStack.back().m_name;
+	}
+
+	void leave()
+	{
+		m_currentValue = m_containerStack.back();
+		m_containerStack.pop_back();
+	}
+	
+	void addNew(const char* _name)
+	{
+		auto& container = m_containerStack.back();
+		auto containerType = container.getType();
+		APT_ASSERT(containerType == ValueType_Object);
+		m_currentValue.m_index = (int)container.m_value->MemberCount();
+
+	 // update the member index if it was valid before adding the member, else it's rebuilt by the next find()
+		auto indexIt = m_memberIndex.find(container.m_value);
+		MemberIndex* index = nullptr;
+		if (indexIt != m_memberIndex.end() && indexIt->second.isValid(container.m_value)) {
+			index = &indexIt->second;
+		}
+
+		container.m_value->AddMember(
+			rapidjson::StringRef(_name),
+			JsonValue().Move(), 
+			m_dom.GetAllocator()
+		);
+		auto it = container.m_value->MemberEnd() - 1;
+
+		if (index) {
+			index->m_members = container.m_value->MemberBegin(); // may have been reallocated
+			index->m_count   = container.m_value->MemberCount();
+			if (index->m_count * 2 > index->m_slots.size()) {
+				index->build(container.m_value);
+			} else {
+				index->insert(HashMemberName(_name), index->m_count - 1);
+			}
+		}
+		m_currentValue.m_name  = it->name.GetString();
+		m_currentValue.m_value = &it->value;
+	}
+
+	void pushNew()
+	{
+		auto& container = m_containerStack.back();
+		auto containerType = container.getType();
+		APT_ASSERT(containerType == ValueType_Array);
+		m_currentValue.m_index = (int)container.m_value->Size();
+		container.m_value->PushBack(JsonValue().Move(), m_dom.GetAllocator());
+		m_currentValue.m_name  = "";
+		m_currentValue.m_value = container.m_value->End() - 1;
+	}
+
+ // findGet*() optionally moves m_currentValue to the specified member/array element and returns the value
+
+	JsonValue* findGet(const char* _name , int _i, ValueType _expectedType)
+	{
+		if (_name) {
+			find(_name);
+		} else if (_i > -1) {
+			find(_i);
+		}
+		APT_ASSERT(m_currentValue.m_value);
+		JSON_ERR_TYPE("get()", m_currentValue.m_name, m_currentValue.getType(), _expectedType, ;);
+		return m_currentValue.m_value;
+	}
+
+	bool findGetBool(const char * _name, int _i)
+	{
+		return findGet(_name, _i, ValueType_Bool)->GetBool();
+	}
+
+	const char* findGetString(const char * _name, int _i)
+	{
+		return findGet(_name, _i, ValueType_String)->GetString();
+	}
+
+	template <typename T>
+	T findGetNumber(const char* _name, int _i)
+	{
+		return GetNumber<T>(*findGet(_name, _i, ValueType_Number));
+	}
+
+	template <typename T>
+	T findGetVector(const char* _name, int _i)
+	{
+	 // vectors are arrays of numbers
+		T ret = T(APT_TRAITS_BASE_TYPE(T)(0));
+		auto val = findGet(_name, _i, ValueType_Array);
+		auto arr = val->GetArray();
+		JSON_ERR_SIZE("getVector", m_currentValue.m_name, (int)arr.Size(), APT_TRAITS_COUNT(T), return ret);
+		JSON_ERR_TYPE("getVector", m_currentValue.m_name, GetValueType(arr[0].GetType()), ValueType_Number, return ret);
+
+		typedef APT_TRAITS_BASE_TYPE(T) BaseType;
+		if (DataTypeIsFloat(APT_DATA_TYPE_TO_ENUM(BaseType))) {
+			for (int i = 0; i < APT_TRAITS_COUNT(T); ++i) {
+				ret[i] = (BaseType)arr[i].GetFloat();
+			}
+		} else {
+			if (DataTypeIsSigned(APT_DATA_TYPE_TO_ENUM(BaseType))) {
+				for (int i = 0; i < APT_TRAITS_COUNT(T); ++i) {
+					ret[i] = (BaseType)arr[i].GetInt();
+				}
+			} else {
+				for (int i = 0; i < APT_TRAITS_COUNT(T); ++i) {
+					ret[i] = (BaseType)arr[i].GetUint();
+				}
+			}
+		}		
+		return ret;
+	}
+
+	template <typename T, int kCount> // \hack APT_TRAITS_COUNT(T) returns the # of floats in the matrix, hence kCount for the # of vectors
+	T findGetMatrix(const char* _name, int _i)
+	{
+	 // matrices are arrays of vectors
+		auto val = findGet(_name, _i, ValueType_Array);
+		auto rows = val->GetArray();
+		JSON_ERR_SIZE("getMatrix", m_currentValue.m_name, (int)rows.Size(), kCount, return identity);
+		JSON_ERR_TYPE("getMatrix", m_currentValue.m_name, GetValueType(rows[0].GetType()), ValueType_Array, return identity);
+
+		T ret;
+		for (int i = 0; i < kCount; ++i) {
+			for (int j = 0; j < kCount; ++j) { // only square matrices supported
+				auto& row = rows[i];
+				JSON_ERR_SIZE("getMatrix", m_currentValue.m_name, (int)row.Size(), kCount, return identity);
+				ret[i][j] = row[j].GetFloat();
+			}
+		}		
+		return ret;
+	}
+
+ // findAdd*() optionally moves m_currentValue to the specified member/array element and returns the value
+
+	JsonValue* findAdd(const char* _name , int _i)
+	{
+		if (_name) {
+			if (!find(_name)) {
+				addNew(_name);
+			}
+		} else if (_i > -1) {
+			if (!find(_i)) {
+				APT_ASSERT(false); // \todo what to do in this case?
+			}
+		}
+		APT_ASSERT(m_currentValue.m_value);
+		return m_currentValue.m_value;
+	}
+
+	void findAddBool(const char* _name, int _i, bool _value)
+	{
+		findAdd(_name, _i)->SetBool(_value);
+	}
+
+	void findAddString(const char* _name, int _i, const char* _value)
+	{
+		findAdd(_name, _i)->SetString(_value, m_dom.GetAllocator());
+	}
+
+	template <typename T>
+	void findAddNumber(const char* _name, int _i, T _value)
+	{
+		SetNumber<T>(*findAdd(_name, _i), _value);
+	}
+
+	template <typename tType, typename tSet>
+	void findAddArray(const char* _name, int _i, tSet _set, const tType* _data, int _count)
+	{
+		APT_ASSERT(_data || _count == 0);
+		auto& allocator = m_dom.GetAllocator();
+		JsonValue* arr = findAdd(_name, _i);
+		arr->SetArray();
+		arr->Reserve((rapidjson::SizeType)_count, allocator);
+		for (int i = 0; i < _count; ++i) {
+			JsonValue v;
+			_set(v, _data[i]);
+			arr->PushBack(v, allocator);
+		}
+	}
+
+	template <typename T>
+	void findAddVector(const char* _name, int _i, const T& _value)
+	{
+		int n = APT_TRAITS_COUNT(T);
+		auto vec = findAdd(_name, _i);
+		vec->SetArray();
+		for (int i = 0; i < n; ++i) {
+			vec->PushBack(_value[i], m_dom.GetAllocator());
+		}
+	}
+
+	template <typename T, int kCount> // \hack APT_TRAITS_COUNT(T) returns the # of floats in the matrix, hence kCount for the # of vectors
+	void findAddMatrix(const char* _name, int _i, const T& _value)
+	{
+		auto mat = findAdd(_name, _i);
+		mat->SetArray();
+		for (int i = 0; i < kCount; ++i) {
+			mat->PushBack(JsonValue().SetArray().Move(), m_dom.GetAllocator());
+			auto& row = *(mat->End() - 1);
+			for (int j = 0; j < kCount; ++j) {
+				row.PushBack(_value[i][j], m_dom.GetAllocator());
+			}
+		}
+	}
+};
+
+
+bool Json::Read(Json& json_, const File& _file)
+{
+	json_.m_impl->clear(); // release the previous DOM (and any in-situ buffer)
+	if (!_file.getData() || _file.getDataSize() == 0) {
+		APT_LOG_ERR("Json: %s\n\tNo data", _file.getPath());
+		return false;
+	}
+	if (IsMessagePack(_file.getData(), _file.getDataSize())) {
+		MsgPackReader reader(_file.getData(), _file.getDataSize());
+		auto generator = [&reader](JsonDocument& _handler_) { return reader.readRoot(_handler_); };
+		json_.m_impl->m_dom.Populate(generator);
+		if (reader.m_error) {
+			APT_LOG_ERR("Json: %s\n\t'%s' (MessagePack offset %llu)", _file.getPath(), reader.m_error, (uint64)(reader.m_cur - (const uint8*)_file.getData()));
+			json_.m_impl->m_dom.SetObject();
+			return false;
+		}
+		return true;
+	}
+	 // mapped data isn't null terminated, hence the parse is bounded by the data size
+	rapidjson::MemoryStream in(_file.getData(), (size_t)_file.getDataSize());
+	rapidjson::EncodedInputStream<rapidjson::UTF8<>, rapidjson::MemoryStream> encodedIn(in);
+	const char* err = JsonParse<rapidjson::kParseDefaultFlags>(json_.m_impl->m_dom, encodedIn, json_.m_impl->m_baseAllocator);
+	if (err) {
+		APT_LOG_ERR("Json: %s\n\t'%s'", _file.getPath(), err);
+		return false;
+	}
+	return true;
+}
+
+bool Json::ReadInsitu(Json& json_, File& file_)
+{
+	if (IsMessagePack(file_.getData(), file_.getDataSize())) {
+	 // strings aren't null terminated in MessagePack, hence they're copied
+		bool ret = Read(json_, file_);
+		file_ = File();
+		return ret;
+	}
+	File buffer;
+	if (file_.isMapped()) {
+		uint64 size = file_.getDataSize();
+		buffer.setData(nullptr, size + 1);
+		memcpy(buffer.getData(), file_.getData(), size);
+		buffer.getData()[size] = '\0';
+		buffer.setPath(file_.getPath());
+		file_ = File();
+	} else {
+		swap(buffer, file_);
+	}
+	if (!buffer.getData()) {
+		APT_LOG_ERR("Json: %s\n\tNo data", buffer.getPath());
+		return false;
+	}
+
+	Impl& impl = *json_.m_impl;
+	impl.clear();
+	rapidjson::InsituStringStream in(buffer.getData());
+	const char* err = JsonParse<rapidjson::kParseInsituFlag>(impl.m_dom, in, impl.m_baseAllocator);
+	swap(impl.m_insitu, buffer);
+	if (err) {
+		APT_LOG_ERR("Json: %s\n\t'%s'", impl.m_insitu.getPath(), err);
+		return false;
+	}
+	return true;
+}
+
+bool Json::Read(Json& json_, const char* _path, int _root)
+{
+	APT_AUTOTIMER("Json::Read(%s)", _path);
+	File f;
+	if (!FileSystem::ReadIfExists(f, _path, _root)) {
+		return false;
+	}
+	return Read(json_, f);
+}
+
+bool Json::ReadInsitu(Json& json_, const char* _path, int _root)
+{
+	APT_AUTOTIMER("Json::ReadInsitu(%s)", _path);
+	File f;
+	if (!FileSystem::ReadIfExists(f, _path, _root)) {
+		return false;
+	}
+	return ReadInsitu(json_, f);
+}
+
+Json::ReadAsyncId Json::ReadAsync(const char* _path, ReadAsyncCallback* _callback, void* _userData, int _root, bool _defer)
+{
+	APT_ASSERT(_path && _callback);
+	return JsonReadAsync::Get().add(_path, _root, _callback, _userData, _defer);
+}
+
+bool Json::CancelReadAsync(ReadAsyncId _id)
+{
+	return JsonReadAsync::Get().cancel(_id);
+}
+
+int Json::DispatchReadAsync()
+{
+	return JsonReadAsync::Get().dispatch();
+}
+
+int Json::WaitReadAsync()
+{
+	return JsonReadAsync::Get().wait();
+}
+
+int Json::Diff(const Json& _from, const Json& _to, Json& patch_)
+{
+	patch_.clear();
+	Json::Impl& patchImpl = *patch_.m_impl;
+	JsonAllocator& allocator = patchImpl.m_dom.GetAllocator();
+	patchImpl.m_dom.AddMember("patch", JsonValue(rapidjson::kArrayType), allocator);
+
+	JsonDiff diff;
+	diff.m_ops = &patchImpl.m_dom.MemberBegin()->value;
+	diff.m_allocator = &allocator;
+	diff.fingerprint(_from.m_impl->m_dom);
+	diff.fingerprint(_to.m_impl->m_dom);
+	diff.diff(_from.m_impl->m_dom, _to.m_impl->m_dom);
+	return diff.m_count;
+}
+
+bool Json::ApplyPatch(Json& json_, const Json& _patch)
+{
+	const JsonValue& patchRoot = _patch.m_impl->m_dom;
+	auto ops = patchRoot.FindMember("patch");
+	if (ops == patchRoot.MemberEnd() || !ops->value.IsArray()) {
+		APT_LOG_ERR("Json: (ApplyPatch()) 'patch' array not found");
+		return false;
+	}
+
+	Json::Impl& impl = *json_.m_impl;
+	impl.clearMemberIndex(); // values may be moved
+	json_.reset();
+	int i = 0;
+	for (auto it = ops->value.Begin(); it != ops->value.End(); ++it, ++i) {
+		const char* err = "invalid operation";
+		if (it->IsObject()) {
+			auto op    = it->FindMember("op");
+			auto path  = it->FindMember("path");
+			auto value = it->FindMember("value");
+			if (op != it->MemberEnd() && op->value.IsString() && path != it->MemberEnd() && path->value.IsString()) {
+				err = JsonPatch::Apply(impl.m_dom, op->value.GetString(), path->value.GetString(), value == it->MemberEnd() ? nullptr : &value->value);
+			}
+		}
+		if (err) {
+			APT_LOG_ERR("Json: (ApplyPatch()) operation %d failed, %s", i, err);
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Json::Write(const Json& _json, File& file_, WriteFlags _flags)
+{
+	if (file_.isOpen()) {
+		JsonOutputStream* out = APT_NEW(JsonOutputStream);
+		out->m_file = &file_;
+		bool ret = WriteDom(_json.m_impl->m_dom, *out, _flags);
+		out->Flush();
+		ret &= !out->m_error;
+		APT_DELETE(out);
+		if (!ret) {
+			APT_LOG_ERR("Json: Error writing '%s'", file_.getPath());
+		}
+		return ret;
+	}
+
+ // File can't take ownership of the buffer, hence a single copy
+	rapidjson::StringBuffer buf;
+	if (!WriteDom(_json.m_impl->m_dom, buf, _flags)) {
+		APT_LOG_ERR("Json: Error writing '%s'", file_.getPath());
+		return false;
+	}
+	file_.setData(buf.GetString(), buf.GetSize());
+	return true;
+}
+
+bool Json::Write(const Json& _json, const char* _path, int _root, WriteFlags _flags)
+{
+	APT_AUTOTIMER("Json::Write(%s)", _path);
+	File f;
+	if (!FileSystem::OpenWrite(f, _path, _root)) {
+		return false;
+	}
+	bool ret = Write(_json, f, _flags);
+	f.close();
+	return ret;
+}
+
+Json::Json(const char* _path, int _root)
+	: m_impl(nullptr)
+{
+	m_impl = APT_NEW(Impl(nullptr));
+	if (_path) {
+		Json::Read(*this, _path, _root);
+	}
+}
+
+Json::Json(Pool& _pool_, const char* _path, int _root)
+	: m_impl(nullptr)
+{
+	m_impl = APT_NEW(Impl(&_pool_));
+	if (_path) {
+		Json::Read(*this, _path, _root);
+	}
+}
+
+Json::~Json()
+{
+	if (m_impl) {
+		APT_DELETE(m_impl);
+	}
+}
+
+void Json::clear()
+{
+	m_impl->clear();
+}
+
+void Json::setMemberIndexThreshold(uint _minMemberCount)
+{
+	m_impl->m_memberIndexThreshold = _minMemberCount;
+	if (_minMemberCount == 0) {
+		m_impl->clearMemberIndex();
+	}
+}
+
+Json::Pool::Pool(uint _chunkSizeBytes)
+	: m_chunkSize(_chunkSizeBytes)
+{
+}
+
+Json::Pool::~Pool()
+{
+	shrink();
+}
+
+uint Json::Pool::getRetainedSize() const
+{
+	uint ret = 0;
+	for (void* block : m_retained) {
+		ret += (uint)((internal::JsonPoolAllocator::Header*)block)->m_capacity;
+	}
+	return ret;
+}
+
+void Json::Pool::shrink()
+{
+	for (void* block : m_retained) {
+		APT_FREE(block);
+	}
+	m_retained.clear();
+}
+
+void* Json::Pool::acquire(uint _sizeBytes)
+{
+ // best fit from the retained blocks (typically all chunk-sized)
+	typedef internal::JsonPoolAllocator::Header Header;
+	int best = -1;
+	for (int i = 0; i < (int)m_retained.size(); ++i) {
+		Header* header = (Header*)m_retained[i];
+		if (header->m_capacity >= _sizeBytes && (best < 0 || header->m_capacity < ((Header*)m_retained[best])->m_capacity)) {
+			best = i;
+			if (header->m_capacity == _sizeBytes) {
+				break;
+			}
+		}
+	}
+	if (best >= 0) {
+		void* ret = m_retained[best];
+		m_retained[best] = m_retained.back();
+		m_retained.pop_back();
+		return ret;
+	}
+
+	Header* ret = (Header*)APT_MALLOC(sizeof(Header) + _sizeBytes);
+	APT_ASSERT(ret);
+	ret->m_pool = this;
+	ret->m_capacity = _sizeBytes;
+	return ret;
+}
+
+void Json::Pool::release(void* _block)
+{
+	m_retained.push_back(_block);
+}
+
+bool Json::find(const char* _name)
+{
+	return m_impl->find(_name);
+}
+
+bool Json::find(const JsonPath& _path, int _match)
+{
+	if (!_path.isValid() || _path.m_segments.empty()) {
+		return false;
+	}
+	auto onMatch = [this, &_match](const Impl::PathNode& _node) -> bool
+		{
+			if (_match-- > 0) {
+				return true;
+			}
+		 // enter the containers along the path, the root node is the current container
+			int depth = 0;
+			for (const Impl::PathNode* node = _node.m_parent; node->m_parent; node = node->m_parent) {
+				++depth;
+			}
+			auto& containerStack = m_impl->m_containerStack;
+			containerStack.resize(containerStack.size() + depth);
+			auto dst = containerStack.end();
+			for (const Impl::PathNode* node = _node.m_parent; node->m_parent; node = node->m_parent) {
+				*(--dst) = node->m_value;
+			}
+			m_impl->m_currentValue = _node.m_value;
+			return false;
+		};
+	Impl::PathNode root = { m_impl->m_containerStack.back(), nullptr };
+	return !m_impl->evalPath(_path, 0, root, onMatch);
+}
+
+bool Json::findNext(const JsonPath& _path, PathIterator& _it_)
+{
+	if (!_path.isValid() || _path.m_segments.empty()) {
+		return false;
+	}
+	auto& containerStack = m_impl->m_containerStack;
+	int segmentCount = (int)_path.m_segments.size();
+	int s = 0;
+	if (_it_.m_positions.empty()) {
+		_it_.m_depth = (int)containerStack.size();
+		_it_.m_positions.resize(segmentCount, -1);
+	} else {
+	 // re-enter the containers along the previous match, then advance the last segment
+		APT_ASSERT((int)containerStack.size() >= _it_.m_depth);
+		containerStack.resize(_it_.m_depth);
+		for (; s < segmentCount - 1; ++s) {
+			containerStack.push_back(Impl::GetChild(containerStack.back(), _it_.m_positions[s]));
+		}
+	}
+
+ // depth first, the container for segment s is at the top of the stack
+	while (s >= 0) {
+		const Impl::Value& container = containerStack.back();
+		int i = m_impl->nextPathMatch(_path, _path.m_segments[s], container.m_value, _it_.m_positions[s]);
+		_it_.m_positions[s] = i;
+		if (i < 0) {
+			if (--s >= 0) {
+				containerStack.pop_back();
+			}
+			continue;
+		}
+		Impl::Value child = Impl::GetChild(container, i);
+		if (s == segmentCount - 1) {
+			m_impl->m_currentValue = child;
+			return true;
+		}
+		containerStack.push_back(child);
+		_it_.m_positions[++s] = -1;
+	}
+
+	m_impl->m_currentValue = Impl::Value();
+	m_impl->m_currentValue.m_name = containerStack.back().m_name;
+	_it_.reset();
+	return false;
+}
+	
+bool Json::next()
+{
+	auto& container = m_impl->m_containerStack.back();
+	auto& current   = m_impl->m_currentValue;
+
+	int i = current.m_index + 1;
+	if (i >= container.getSize()) {
+		return false;
+	}
+	current.m_index = i;
+
+	auto containerType = container.getType();
+	if (containerType == ValueType_Object) {
+		auto it = (container.m_value->MemberBegin() + i);
+		current.m_value = &it->value;
+		current.m_name  = it->name.GetString();
+	} else if (containerType == ValueType_Array) {
+		current.m_value = container.m_value->Begin() + i;
+	} else {
+		APT_ASSERT(false);
+		return false;
+	}
+	return true;
+}
+
+bool Json::enterObject()
+{
+	JSON_ERR_TYPE("enterObject", getName(), getType(), ValueType_Object, return false);
+	m_impl->enter();
+	return true;
+}
+
+void Json::leaveObject()
+{
+	m_impl->leave();
+	APT_ASSERT(getType() == ValueType_Object);
+}
+
+bool Json::enterArray()
+{
+	JSON_ERR_TYPE("enterArray", getName(), getType(), ValueType_Array, return false);
+	m_impl->enter();
+	return true;
+}
+
+void Json::leaveArray()
+{
+	m_impl->leave();
+	APT_ASSERT(getType() == ValueType_Array);
+}
+
+void Json::reset()
+{
+	m_impl->reset();
+}
+
+Json::ValueType Json::getType() const
+{
+	return m_impl->m_currentValue.getType();
+}
+
+const char* Json::getName() const
+{
+	return m_impl->m_currentValue.m_name;
+}
+
+int Json::getIndex() const
+{
+	return m_impl->m_currentValue.m_index;
+}
+
+int Json::getArrayLength() const
+{
+	if (m_impl->m_containerStack.back().getType() == ValueType_Array) {
+		return m_impl->m_containerStack.back().getSize();
+	}
+	return -1;
+}
+
+template <> bool Json::getValue<bool>(int _i) const
+{
+	return m_impl->findGetBool(nullptr, _i);
+}
+
+template <> const char* Json::getValue<const char*>(int _i) const
+{
+	return m_impl->findGetString(nullptr, _i);
+}
+
+// use the APT_DataType_decl macro to instantiate get<>() for all the number types
+#define Json_getValue_Number(_type, _enum) \
+	template <> _type Json::getValue<_type>(int _i) const { \
+		return m_impl->findGetNumber<_type>(nullptr, _i); \
+	}
+APT_DataType_decl(Json_getValue_Number)
+
+// manually instantiate vector types
+#define Json_getValue_Vector(_type) \
+	template <> _type Json::getValue<_type>(int _i) const { \
+		 return m_impl->findGetVector<_type>(nullptr, _i); \
+	}
+Json_getValue_Vector(vec2)
+Json_getValue_Vector(vec3)
+Json_getValue_Vector(vec4)
+Json_getValue_Vector(ivec2)
+Json_getValue_Vector(ivec3)
+Json_getValue_Vector(ivec4)
+Json_getValue_Vector(uvec2)
+Json_getValue_Vector(uvec3)
+Json_getValue_Vector(uvec4)
+
+// manually instantiate matrix types
+#define Json_getValue_Matrix(_type, _count) \
+	template <> _type Json::getValue<_type>(int _i) const { \
+		 return m_impl->findGetMatrix<_type, _count>(nullptr, _i); \
+	}
+Json_getValue_Matrix(mat2, 2)
+Json_getValue_Matrix(mat3, 3)
+Json_getValue_Matrix(mat4, 4)
+
+
+template <> int Json::getValues<bool>(const JsonPath& _path, bool* out_, int _maxCount) const
+{
+	return m_impl->getValues(_path, ValueType_Bool, GetNumber<bool>, out_, _maxCount);
+}
+
+template <> int Json::getValues<const char*>(const JsonPath& _path, const char** out_, int _maxCount) const
+{
+	return m_impl->getValues(_path, ValueType_String, [](const JsonValue& _value) { return _value.GetString(); }, out_, _maxCount);
+}
+
+#define Json_getValues_Number(_type, _enum) \
+	template <> int Json::getValues<_type>(const JsonPath& _path, _type* out_, int _maxCount) const { \
+		return m_impl->getValues(_path, ValueType_Number, GetNumber<_type>, out_, _maxCount); \
+	}
+APT_DataType_decl(Json_getValues_Number)
+
+template <> int Json::getArray<bool>(bool* out_, int _maxCount) const
+{
+	return m_impl->getArray(ValueType_Bool, [](const JsonValue& _value) { return _value.IsBool(); }, GetNumber<bool>, out_, _maxCount);
+}
+
+#define Json_getArray_Number(_type, _enum) \
+	template <> int Json::getArray<_type>(_type* out_, int _maxCount) const { \
+		return m_impl->getArray(ValueType_Number, [](const JsonValue& _value) { return _value.IsNumber(); }, GetNumber<_type>, out_, _maxCount); \
+	}
+APT_DataType_decl(Json_getArray_Number)
+
+template <> void Json::setValue<bool>(bool _value, int _i)
+{
+	m_impl->findAddBool(nullptr, _i, _value);
+}
+template <> void Json::setValue<bool>(bool _value, const char* _name)
+{
+	m_impl->findAddBool(_name, -1, _value);
+}
+template <> void Json::setValue<const char*>(const char* _value, int _i)
+{
+	m_impl->findAddString(nullptr, _i, _value);
+}
+template <> void Json::setValue<const char*>(const char* _value, const char* _name)
+{
+	m_impl->findAddString(_name, -1, _value);
+}
+#define Json_setValue_Number(_type, _enum) \
+	template <> void Json::setValue<_type>(_type _value, int _i) { \
+		m_impl->findAddNumber<_type>(nullptr, _i, _value); \
+	} \
+	template <> void Json::setValue<_type>(_type _value, const char* _name) { \
+		m_impl->findAddNumber<_type>(_name, -1, _value); \
+	}
+APT_DataType_decl(Json_setValue_Number)
+
+#define Json_setValue_Vector(_type) \
+	template <> void Json::setValue<_type>(_type _value, int _i) { \
+		m_impl->findAddVector<_type>(nullptr, _i, _value); \
+	} \
+	template <> void Json::setValue<_type>(_type _value, const char* _name) { \
+		m_impl->findAddVector<_type>(_name, -1, _value); \
+	}
+Json_setValue_Vector(vec2)
+Json_setValue_Vector(vec3)
+Json_setValue_Vector(vec4)
+Json_setValue_Vector(ivec2)
+Json_setValue_Vector(ivec3)
+Json_setValue_Vector(ivec4)
+Json_setValue_Vector(uvec2)
+Json_setValue_Vector(uvec3)
+Json_setValue_Vector(uvec4)
+
+
+#define Json_setValue_Matrix(_type, _count) \
+	template <> void Json::setValue<_type>(_type _value, int _i) { \
+		m_impl->findAddMatrix<_type, _count>(nullptr, _i, _value); \
+	} \
+	template <> void Json::setValue<_type>(_type _value, const char* _name) { \
+		m_impl->findAddMatrix<_type, _count>(_name, -1, _value); \
+	}
+Json_setValue_Matrix(mat2, 2)
+Json_setValue_Matrix(mat3, 3)
+Json_setValue_Matrix(mat4, 4)
+
+template <> void Json::setArray<bool>(const bool* _data, int _count, int _i)
+{
+	m_impl->findAddArray(nullptr, _i, SetNumber<bool>, _data, _count);
+}
+template <> void Json::setArray<bool>(const bool* _data, int _count, const char* _name)
+{
+	m_impl->findAddArray(_name, -1, SetNumber<bool>, _data, _count);
+}
+#define Json_setArray_Number(_type, _enum) \
+	template <> void Json::setArray<_type>(const _type* _data, int _count, int _i) { \
+		m_impl->findAddArray(nullptr, _i, SetNumber<_type>, _data, _count); \
+	} \
+	template <> void Json::setArray<_type>(const _type* _data, int _count, const char* _name) { \
+		m_impl->findAddArray(_name, -1, SetNumber<_type>, _data, _count); \
+	}
+APT_DataType_decl(Json_setArray_Number)
+
+#define Json_pushValue(_type, _enum) \
+	template <> void Json::pushValue<_type>(_type _value) { \
+		m_impl->pushNew(); \
+		setValue(_value); \
+	}
+Json_pushValue(bool, 0)
+Json_pushValue(const char*, 0)
+APT_DataType_decl(Json_pushValue)
+Json_pushValue(vec2, 0)
+Json_pushValue(vec3, 0)
+Json_pushValue(vec4, 0)
+Json_pushValue(ivec2, 0)
+Json_pushValue(ivec3, 0)
+Json_pushValue(ivec4, 0)
+Json_pushValue(uvec2, 0)
+Json_pushValue(uvec3, 0)
+Json_pushValue(uvec4, 0)
+Json_pushValue(mat2, 0)
+Json_pushValue(mat3, 0)
+Json_pushValue(mat4, 0)
+
+void Json::beginObject(const char* _name)
+{
+	if (m_impl->m_containerStack.back().getType() == ValueType_Object) {
+		APT_ASSERT(_name);
+		if (!m_impl->find(_name)) {
+			m_impl->addNew(_name);
+			m_impl->m_currentValue.m_value->SetObject();
+		}
+			
+	} else {
+		if (_name) {
+			APT_LOG_ERR("Json: beginObject() called inside array, name '%s' will be ignored", _name);
+		}
+		m_impl->pushNew();
+		m_impl->m_currentValue.m_value->SetObject();
+	}
+	m_impl->enter();
+}
+
+void Json::beginArray(const char* _name)
+{
+	if (m_impl->m_containerStack.back().getType() == ValueType_Object) {
+		APT_ASSERT(_name);
+		if (!m_impl->find(_name)) {
+			m_impl->addNew(_name);
+			m_impl->m_currentValue.m_value->SetArray();
+		}
+
+	} else {
+		if (_name) {
+			APT_LOG_ERR("Json: beginArray() called inside array, name '%s' will be ignored", _name);
+		}
+		m_impl->pushNew();
+		m_impl->m_currentValue.m_value->SetArray();
+	}
+	m_impl->enter();
+}
+
+static bool VisitRecursive(Json* _json_, Json::OnVisit* _onVisit, int _depth = 0)
+{
+	bool ret = true;
+
+	while (ret && _json_->next()) {
+		auto type  = _json_->getType();
+		auto name  = _json_->getName();
+		auto index = _json_->getIndex();
+		ret = _onVisit(_json_, type, name, index, _depth);
+		if (ret) {
+			if (type == Json::ValueType_Array) {
+				_json_->enterArray();
+				ret = VisitRecursive(_json_, _onVisit, _depth + 1);
+				_json_->leaveArray();
+			} else if (type == Json::ValueType_Object) {
+				_json_->enterObject();
+				ret = VisitRecursive(_json_, _onVisit, _depth + 1);
+				_json_->leaveObject();
+			}
+		}
+	}
+
+	return ret;
+}
+void Json::visitAll(OnVisit* _onVisit)
+{
+	APT_STRICT_ASSERT(_onVisit);
+	VisitRecursive(this, _onVisit);
+}
+
+/*******************************************************************************
+
+                                 JsonPath
+
+*******************************************************************************/
+
+// PUBLIC
+
+JsonPath::JsonPath(const char* _path)
+	: m_isValid(true)
+{
+	APT_ASSERT(_path);
+	const char* err = nullptr;
+	const char* c = _path;
+	while (*c && !err) {
+		Segment segment = { SegmentType_Member, 0, 0, 0, -1 };
+		if (*c == '[') {
+			++c;
+			if (c[0] == '*' && c[1] == ']') {
+				segment.m_type = SegmentType_AnyElement;
+				++c;
+			} else {
+				segment.m_type = SegmentType_Index;
+				segment.m_index = 0;
+				const char* beg = c;
+				for (; *c >= '0' && *c <= '9'; ++c) {
+					int digit = *c - '0';
+					if (segment.m_index > (INT_MAX - digit) / 10) {
+						err = "array index out of range";
+						break;
+					}
+					segment.m_index = segment.m_index * 10 + digit;
+				}
+				if (err) {
+					break;
+				}
+				if (c == beg || *c != ']') {
+					err = "invalid array index";
+					break;
+				}
+			}
+			++c;
+		} else {
+			const char* beg = c;
+			while (*c && *c != '.' && *c != '[' && *c != ']') {
+				++c;
+			}
+			if (c == beg) {
+				err = "empty member name";
+				break;
+			}
+			if (c - beg == 1 && *beg == '*') {
+				segment.m_type = SegmentType_AnyMember;
+			} else {
+				segment.m_name = (uint32)m_names.size();
+				segment.m_nameLength = (uint32)(c - beg);
+				m_names.insert(m_names.end(), beg, c);
+				m_names.push_back('\0');
+				segment.m_hash = HashMemberName(m_names.data() + segment.m_name);
+			}
+		}
+		m_segments.push_back(segment);
+
+		if (*c == '.') {
+			++c;
+			if (*c == '\0') {
+				err = "trailing '.'";
+			}
+		} else if (*c != '\0' && *c != '[') {
+			err = "unexpected character";
+		}
+	}
+
+	if (err) {
+		APT_LOG_ERR("JsonPath: invalid path '%s', %s at %d", _path, err, (int)(c - _path));
+		m_isValid = false;
+		m_segments.clear();
+		m_names.clear();
+	}
+}
+
+/*******************************************************************************
+
+                              SerializerJson
+
+*******************************************************************************/
+
+// Streaming mode: values are written directly via a rapidjson writer, the output is buffered and written to the file in
+// blocks of kBufferSize bytes.
+struct SerializerJson::Stream
+{
+	struct Scope
+	{
+		uint32 m_count;   // # values written
+		bool   m_isArray;
+	};
+
+	SerializerJson&                           m_serializer;
+	JsonOutputStream                          m_out;
+	rapidjson::PrettyWriter<JsonOutputStream> m_writer;
+	eastl::vector<Scope>                      m_scopes;
+	String<32>                                m_name;           // name of the current value (copied, _name may be a temporary)
+	bool                                      m_flushed = false;
+	bool                                      m_invalid = false; // a value was rejected by the writer, the output is incomplete
+
+	Stream(SerializerJson& _serializer_, File& _file_)
+		: m_serializer(_serializer_)
+		, m_writer(m_out)
+	{
+	 // match Json::Write() with WriteFlags_Default
+		m_out.m_file = &_file_;
+		m_writer.SetIndent('\t', 1);
+		m_writer.SetFormatOptions(rapidjson::kFormatSingleLineArray);
+		m_writer.StartObject();
+		m_scopes.push_back({ 0, false });
+	}
+
+	// Write _name if the current scope is an object.
+	void key(const char* _name)
+	{
+		APT_ASSERT(!m_flushed);
+		Scope& scope = m_scopes.back();
+		if (scope.m_isArray) {
+			m_name.clear();
+		} else {
+			APT_ASSERT(_name); // object members must be named
+			m_writer.Key(_name);
+			m_name.set(_name);
+		}
+		++scope.m_count;
+	}
+
+	void begin(const char* _name, bool _isArray)
+	{
+		key(_name);
+		if (_isArray) {
+			m_writer.StartArray();
+		} else {
+			m_writer.StartObject();
+		}
+		m_scopes.push_back({ 0, _isArray });
+	}
+
+	void end()
+	{
+		APT_ASSERT(m_scopes.size() > 1); // unmatched end()
+		if (m_scopes.back().m_isArray) {
+			m_writer.EndArray();
+		} else {
+			m_writer.EndObject();
+		}
+		m_scopes.pop_back();
+		m_name.clear();
+	}
+
+	bool write(bool                 _value) { return m_writer.Bool(_value);                }
+	bool write(sint8                _value) { return m_writer.Int(_value);                 }
+	bool write(uint8                _value) { return m_writer.Uint(_value);                }
+	bool write(sint16               _value) { return m_writer.Int(_value);                 }
+	bool write(uint16               _value) { return m_writer.Uint(_value);                }
+	bool write(sint32               _value) { return m_writer.Int(_value);                 }
+	bool write(uint32               _value) { return m_writer.Uint(_value);                }
+	bool write(sint64               _value) { return m_writer.Int64(_value);               }
+	bool write(uint64               _value) { return m_writer.Uint64(_value);              }
+	bool write(float32              _value) { return m_writer.Double((double)_value);      } // as per JsonValue::SetFloat()
+	bool write(float64              _value) { return m_writer.Double(_value);              } // NaN/Inf are rejected
+	bool write(const StringBase&    _value) { return m_writer.String((const char*)_value, (rapidjson::SizeType)_value.getLength()); }
+
+	template <typename tType>
+	bool value(const tType& _value, const char* _name)
+	{
+		key(_name);
+		if (!write(_value)) {
+			m_invalid = true;
+			m_serializer.setError("Error serializing '%s': value not representable in JSON", (const char*)m_name);
+			return false;
+		}
+		return true;
+	}
+
+	template <typename tType>
+	bool valueArray(const tType* _data, uint _count, const char* _name)
+	{
+		key(_name);
+		m_writer.StartArray();
+		for (uint i = 0; i < _count; ++i) {
+			if (!write(_data[i])) {
+				m_invalid = true;
+				m_serializer.setError("Error serializing array '%s': element %u not representable in JSON", (const char*)m_name, i);
+				m_writer.EndArray();
+				return false;
+			}
+		}
+		m_writer.EndArray();
+		return true;
+	}
+
+	bool flush()
+	{
+		if (!m_flushed) {
+			APT_ASSERT(m_scopes.size() == 1); // unmatched begin()
+			while (m_scopes.size() > 1) {
+				end();
+			}
+			m_writer.EndObject();
+			m_out.Flush();
+			m_flushed = true;
+		}
+		return !m_out.m_error && !m_invalid;
+	}
+};
+
+// PUBLIC
+
+SerializerJson::SerializerJson(Json& _json_, Mode _mode)
+	: Serializer(_mode) 
+	, m_json(&_json_)
+	, m_stream(nullptr)
+	, m_binaryRaw(false)
+{
 }
 
-const char* Json::getName() const
+SerializerJson::SerializerJson(File& file_)
+	: Serializer(Mode_Write)
+	, m_json(nullptr)
+	, m_stream(nullptr)
+	, m_binaryRaw(false)
 {
-	return m_impl->m_currentValue.m_name;
+	m_stream = APT_NEW(Stream(*this, file_));
 }
 
-int Json::getIndex() const
+SerializerJson::~SerializerJson()
 {
-	return m_impl->m_currentValue.m_index;
+	if (m_stream) {
+		m_stream->flush();
+		APT_DELETE(m_stream);
+	}
 }
 
-int Json::getArrayLength() const
+bool SerializerJson::flush()
 {
-	if (m_impl->m_containerStack.back().getType() == ValueType_Array) {
-		return m_impl->m_containerStack.back().getSize();
+	APT_ASSERT(m_stream);
+	if (!m_stream->flush()) {
+		setError(m_stream->m_invalid ? "Error writing '%s', the output is incomplete" : "Error writing '%s'", m_stream->m_out.m_file->getPath());
+		return false;
 	}
-	return -1;
+	return true;
 }
 
-template <> bool Json::getValue<bool>(int _i) const
+bool SerializerJson::beginObject(const char* _name)
+{
+	if (m_stream) {
+		m_stream->begin(_name, false);
+		return true;
+	}
+	if (getMode() == SerializerJson::Mode_Read) {
+		if (_name) {
+			if (!m_json->find(_name)) {
+				setError("Error serializing object: '%s' not found", _name);
+				return false;
+			}
+		} else {
+			if (!m_json->next()) {
+				return false;
+			}
+		}
+		if (m_json->getType() != Json::ValueType_Object) {
+			setError("Error serializing object: '%s' not an object", m_json->getName());
+			return false;
+		}
+
+		m_json->enterObject();
+
+	} else {
+		m_json->beginObject(_name);
+	}
+	
+	return true;
+}
+void SerializerJson::endObject()
+{
+	if (m_stream) {
+		m_stream->end();
+	} else if (m_mode == Mode_Read) {
+		m_json->leaveObject();
+	} else {
+		m_json->endObject();
+	}
+}
+
+bool SerializerJson::beginArray(uint& _length_, const char* _name)
+{
+	if (m_stream) {
+		m_stream->begin(_name, true);
+		return true;
+	}
+	if (getMode() == SerializerJson::Mode_Read) {
+		if (_name) {
+			if (!m_json->find(_name)) {
+				setError("Error serializing array: '%s' not found", _name);
+				return false;
+			}
+		} else {
+			if (!m_json->next()) {
+				return false;
+			}
+		}
+		if (m_json->getType() != Json::ValueType_Array) {
+			setError("Error serializing array: '%s' not an array", m_json->getName());
+			return false;
+		}
+
+		m_json->enterArray();
+		_length_ = (uint)m_json->getArrayLength();
+
+	} else {
+		m_json->beginArray(_name);
+	}
+
+	return true;
+}
+void SerializerJson::endArray()
+{
+	if (m_stream) {
+		m_stream->end();
+	} else if (m_mode == Mode_Read) {
+		m_json->leaveArray();
+	} else {
+		m_json->endArray();
+	}
+}
+
+const char* SerializerJson::getName() const
+{
+	return m_stream ? (const char*)m_stream->m_name : m_json->getName();
+}
+
+uint32 SerializerJson::getIndex() const
+{
+	if (m_stream) {
+	 // 0 before the first value in the current scope
+		if (m_stream->m_scopes.empty() || m_stream->m_scopes.back().m_count == 0) {
+			return 0;
+		}
+		return m_stream->m_scopes.back().m_count - 1;
+	}
+	return (uint32)m_json->getIndex();
+}
+
+template <typename tType>
+static bool ValueImpl(SerializerJson& _serializer_, tType& _value_, const char* _name)
+{
+	Json* json = _serializer_.getJson();
+	//if (!_name && json->getArrayLength() < 0) {
+	//	_serializer_.setError("Error serializing %s: name must be specified if not in an array", Serializer::ValueTypeToStr<tType>());
+	//	return false;
+	//}
+
+	if (_serializer_.getMode() == SerializerJson::Mode_Read) {
+		if (_name) {
+			if (!json->find(_name)) {
+				_serializer_.setError("Error serializing %s: '%s' not found", Serializer::ValueTypeToStr<tType>(), _name);
+				return false;
+			}
+		} else {
+			if (!json->next()) {
+				return false;
+			}
+		}
+		_value_ = json->getValue<tType>();
+		return true;
+
+	} else {
+		if (_name) {
+			json->setValue<tType>(_value_, _name);
+		} else {
+			json->pushValue<tType>(_value_);
+		}
+		return true; 
+	}
+}
+
+bool SerializerJson::value(bool&    _value_, const char* _name) { return m_stream ? m_stream->value(_value_, _name) : ValueImpl<bool>   (*this, _value_, _name); }
+bool SerializerJson::value(sint8&   _value_, const char* _name) { return m_stream ? m_stream->value(_value_, _name) : ValueImpl<sint8>  (*this, _value_, _name); }
+bool SerializerJson::value(uint8&   _value_, const char* _name) { return m_stream ? m_stream->value(_value_, _name) : ValueImpl<uint8>  (*this, _value_, _name); }
+bool SerializerJson::value(sint16&  _value_, const char* _name) { return m_stream ? m_stream->value(_value_, _name) : ValueImpl<sint16> (*this, _value_, _name); }
+bool SerializerJson::value(uint16&  _value_, const char* _name) { return m_stream ? m_stream->value(_value_, _name) : ValueImpl<uint16> (*this, _value_, _name); }
+bool SerializerJson::value(sint32&  _value_, const char* _name) { return m_stream ? m_stream->value(_value_, _name) : ValueImpl<sint32> (*this, _value_, _name); }
+bool SerializerJson::value(uint32&  _value_, const char* _name) { return m_stream ? m_stream->value(_value_, _name) : ValueImpl<uint32> (*this, _value_, _name); }
+bool SerializerJson::value(sint64&  _value_, const char* _name) { return m_stream ? m_stream->value(_value_, _name) : ValueImpl<sint64> (*this, _value_, _name); }
+bool SerializerJson::value(uint64&  _value_, const char* _name) { return m_stream ? m_stream->value(_value_, _name) : ValueImpl<uint64> (*this, _value_, _name); }
+bool SerializerJson::value(float32& _value_, const char* _name) { return m_stream ? m_stream->value(_value_, _name) : ValueImpl<float32>(*this, _value_, _name); }
+bool SerializerJson::value(float64& _value_, const char* _name) { return m_stream ? m_stream->value(_value_, _name) : ValueImpl<float64>(*this, _value_, _name); }
+
+bool SerializerJson::value(StringBase& _value_, const char* _name) 
+{ 
+	if (m_stream) {
+		return m_stream->value(_value_, _name);
+	}
+	//if (!_name && m_json->getArrayLength() == -1) {
+	//	setError("Error serializing StringBase; name must be specified if not in an array");
+	//	return false;
+	//}
+	if (getMode() == SerializerJson::Mode_Read) {
+		if (_name) {
+			if (!m_json->find(_name)) {
+				setError("Error serializing StringBase; '%s' not found", _name);
+				return false;
+			}
+		} else {
+			if (!m_json->next()) {
+				return false;
+			}
+		}
+
+		if (m_json->getType() == Json::ValueType_String) {
+			_value_.set(m_json->getValue<const char*>());
+			return true;
+		} else {
+			setError("Error serializing StringBase; '%s' not a string", _name ? _name : "");
+			return false;
+		}
+
+	} else {
+		if (_name) {
+			m_json->setValue<const char*>((const char*)_value_, _name);
+		} else {
+			m_json->pushValue<const char*>((const char*)_value_);
+		}
+		return true; 
+	}
+}
+
+
+// Array elements are read/written directly via the rapidjson DOM, avoiding the per-element overhead of Json::getValue()/pushValue().
+template <typename tType>
+bool SerializerJson::valueArrayImpl(tType* _data_, uint _count, const char* _name)
+{
+	APT_ASSERT(_data_ || _count == 0);
+	auto& impl = *m_json->m_impl;
+
+	if (getMode() == SerializerJson::Mode_Read) {
+		if (_name) {
+			if (!m_json->find(_name)) {
+				setError("Error serializing %s array: '%s' not found", Serializer::ValueTypeToStr<tType>(), _name);
+				return false;
+			}
+		} else {
+			if (!m_json->next()) {
+				return false;
+			}
+		}
+		const JsonValue& arr = *impl.m_currentValue.m_value;
+		if (!arr.IsArray()) {
+			setError("Error serializing %s array: '%s' not an array", Serializer::ValueTypeToStr<tType>(), m_json->getName());
+			return false;
+		}
+		if ((uint)arr.Size() != _count) {
+			setError("Error serializing %s array '%s': array length was %u, expected %u", Serializer::ValueTypeToStr<tType>(), m_json->getName(), (uint)arr.Size(), _count);
+			return false;
+		}
+		const JsonValue* src = arr.Begin();
+		for (uint i = 0; i < _count; ++i) {
+			if (!src[i].IsNumber() && !src[i].IsBool()) {
+				setError("Error serializing %s array '%s': element %u not a number", Serializer::ValueTypeToStr<tType>(), m_json->getName(), i);
+				return false;
+			}
+			_data_[i] = GetNumber<tType>(src[i]);
+		}
+
+	} else {
+		JsonValue* arr;
+		if (_name) {
+			arr = impl.findAdd(_name, -1);
+		} else {
+			impl.pushNew();
+			arr = impl.m_currentValue.m_value;
+		}
+		auto& allocator = impl.m_dom.GetAllocator();
+		arr->SetArray();
+		arr->Reserve((rapidjson::SizeType)_count, allocator);
+		for (uint i = 0; i < _count; ++i) {
+			JsonValue v;
+			SetNumber<tType>(v, _data_[i]);
+			arr->PushBack(v, allocator);
+		}
+	}
+	return true;
+}
+
+bool SerializerJson::valueArray(bool*    _data_, uint _count, const char* _name) { return m_stream ? m_stream->valueArray(_data_, _count, _name) : valueArrayImpl<bool>   (_data_, _count, _name); }
+bool SerializerJson::valueArray(sint8*   _data_, uint _count, const char* _name) { return m_stream ? m_stream->valueArray(_data_, _count, _name) : valueArrayImpl<sint8>  (_data_, _count, _name); }
+bool SerializerJson::valueArray(uint8*   _data_, uint _count, const char* _name) { return m_stream ? m_stream->valueArray(_data_, _count, _name) : valueArrayImpl<uint8>  (_data_, _count, _name); }
+bool SerializerJson::valueArray(sint16*  _data_, uint _count, const char* _name) { return m_stream ? m_stream->valueArray(_data_, _count, _name) : valueArrayImpl<sint16> (_data_, _count, _name); }
+bool SerializerJson::valueArray(uint16*  _data_, uint _count, const char* _name) { return m_stream ? m_stream->valueArray(_data_, _count, _name) : valueArrayImpl<uint16> (_data_, _count, _name); }
+bool SerializerJson::valueArray(sint32*  _data_, uint _count, const char* _name) { return m_stream ? m_stream->valueArray(_data_, _count, _name) : valueArrayImpl<sint32> (_data_, _count, _name); }
+bool SerializerJson::valueArray(uint32*  _data_, uint _count, const char* _name) { return m_stream ? m_stream->valueArray(_data_, _count, _name) : valueArrayImpl<uint32> (_data_, _count, _name); }
+bool SerializerJson::valueArray(sint64*  _data_, uint _count, const char* _name) { return m_stream ? m_stream->valueArray(_data_, _count, _name) : valueArrayImpl<sint64> (_data_, _count, _name); }
+bool SerializerJson::valueArray(uint64*  _data_, uint _count, const char* _name) { return m_stream ? m_stream->valueArray(_data_, _count, _name) : valueArrayImpl<uint64> (_data_, _count, _name); }
+bool SerializerJson::valueArray(float32* _data_, uint _count, const char* _name) { return m_stream ? m_stream->valueArray(_data_, _count, _name) : valueArrayImpl<float32>(_data_, _count, _name); }
+bool SerializerJson::valueArray(float64* _data_, uint _count, const char* _name) { return m_stream ? m_stream->valueArray(_data_, _count, _name) : valueArrayImpl<float64>(_data_, _count, _name); }
+
+
+// Base64 encode/decode of binary data. SSE4.1/AVX2 paths (see http://0x80.pl/articles/index.html#base64-algorithm-new) process
+// 12/24 input bytes per iteration, with a scalar fallback for the tail or if the CPU doesn't support them. Decoding validates
+// the input.
+static const char kBase64Alphabet[] = 
+		"ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+		"abcdefghijklmnopqrstuvwxyz"
+		"0123456789+/"
+		;
+
+struct Base64Tables
+{
+	uint8 m_decode[256]; // 0xff = invalid
+	bool  m_hasSse41;
+	bool  m_hasAvx2;
+
+	Base64Tables()
+	{
+		memset(m_decode, 0xff, sizeof(m_decode));
+		for (uint8 i = 0; i < 64; ++i) {
+			m_decode[(uint8)kBase64Alphabet[i]] = i;
+		}
+
+		internal::CpuFeatures cpu = internal::GetCpuFeatures();
+		m_hasSse41 = (cpu & internal::CpuFeature_Sse41) != 0;
+		m_hasAvx2  = (cpu & internal::CpuFeature_Avx2) != 0;
+	}
+};
+
+static const Base64Tables& GetBase64Tables()
 {
-	return m_impl->findGetBool(nullptr, _i);
+	static Base64Tables s_tables;
+	return s_tables;
 }
 
-template <> const char* Json::getValue<const char*>(int _i) const
+static uint Base64EncSizeBytes(uint _sizeBytes) 
 {
-	return m_impl->findGetString(nullptr, _i);
+	return (_sizeBytes + 2) / 3 * 4;
 }
 
-// use the APT_DataType_decl macro to instantiate get<>() for all the number types
-#define Json_getValue_Number(_type, _enum) \
-	template <> _type Json::getValue<_type>(int _i) const { \
-		return m_impl->findGetNumber<_type>(nullptr, _i); \
-	}
-APT_DataType_decl(Json_getValue_Number)
-
-// manually instantiate vector types
-#define Json_getValue_Vector(_type) \
-	template <> _type Json::getValue<_type>(int _i) const { \
-		 return m_impl->findGetVector<_type>(nullptr, _i); \
+// Return the decoded size of _in, excluding padding. Return false if the length is invalid.
+static bool Base64DecSizeBytes(const char* _in, uint& _inSizeBytes_, uint& decSizeBytes_)
+{
+	uint n = _inSizeBytes_;
+	for (int i = 0; i < 2 && n > 0 && _in[n - 1] == '='; ++i) {
+		--n;
 	}
-Json_getValue_Vector(vec2)
-Json_getValue_Vector(vec3)
-Json_getValue_Vector(vec4)
-Json_getValue_Vector(ivec2)
-Json_getValue_Vector(ivec3)
-Json_getValue_Vector(ivec4)
-Json_getValue_Vector(uvec2)
-Json_getValue_Vector(uvec3)
-Json_getValue_Vector(uvec4)
-
-// manually instantiate matrix types
-#define Json_getValue_Matrix(_type, _count) \
-	template <> _type Json::getValue<_type>(int _i) const { \
-		 return m_impl->findGetMatrix<_type, _count>(nullptr, _i); \
+	if (n % 4 == 1) {
+		return false;
 	}
-Json_getValue_Matrix(mat2, 2)
-Json_getValue_Matrix(mat3, 3)
-Json_getValue_Matrix(mat4, 4)
-
+	_inSizeBytes_ = n;
+	decSizeBytes_ = n / 4 * 3 + (n % 4 ? n % 4 - 1 : 0);
+	return true;
+}
 
-template <> void Json::setValue<bool>(bool _value, int _i)
+// Scalar encode/decode, process complete groups of 3 bytes/4 chars. Return the # of bytes processed.
+static uint Base64EncodeSw(const uint8* _in, uint _inSizeBytes, char* out_)
 {
-	m_impl->findAddBool(nullptr, _i, _value);
+	uint i = 0;
+	for (; i + 3 <= _inSizeBytes; i += 3, out_ += 4) {
+		uint32 v = ((uint32)_in[i] << 16) | ((uint32)_in[i + 1] << 8) | _in[i + 2];
+		out_[0] = kBase64Alphabet[(v >> 18) & 0x3f];
+		out_[1] = kBase64Alphabet[(v >> 12) & 0x3f];
+		out_[2] = kBase64Alphabet[(v >>  6) & 0x3f];
+		out_[3] = kBase64Alphabet[ v        & 0x3f];
+	}
+	return i;
 }
-template <> void Json::setValue<bool>(bool _value, const char* _name)
+static uint Base64DecodeSw(const uint8* _decode, const char* _in, uint _inSizeBytes, uint8* out_, bool& valid_)
 {
-	m_impl->findAddBool(_name, -1, _value);
+	uint i = 0;
+	uint32 err = 0;
+	for (; i + 4 <= _inSizeBytes; i += 4, out_ += 3) {
+		uint32 a = _decode[(uint8)_in[i]];
+		uint32 b = _decode[(uint8)_in[i + 1]];
+		uint32 c = _decode[(uint8)_in[i + 2]];
+		uint32 d = _decode[(uint8)_in[i + 3]];
+		err |= a | b | c | d;
+		uint32 v = (a << 18) | (b << 12) | (c << 6) | d;
+		out_[0] = (uint8)(v >> 16);
+		out_[1] = (uint8)(v >> 8);
+		out_[2] = (uint8)v;
+	}
+	valid_ = (err & 0x80) == 0;
+	return i;
 }
-template <> void Json::setValue<const char*>(const char* _value, int _i)
+
+// Map 6-bit indices to ASCII via a single shuffle; compute the offset to add to each index from its range.
+APT_TARGET_SSE41 static inline __m128i Base64EncLookup128(__m128i _indices)
 {
-	m_impl->findAddString(nullptr, _i, _value);
+	const __m128i shiftLut = _mm_setr_epi8(
+		'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, 
+		'0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0
+		);
+	__m128i ret = _mm_subs_epu8(_indices, _mm_set1_epi8(51));
+	__m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), _indices);
+	ret = _mm_or_si128(ret, _mm_and_si128(less, _mm_set1_epi8(13)));
+	return _mm_add_epi8(_mm_shuffle_epi8(shiftLut, ret), _indices);
 }
-template <> void Json::setValue<const char*>(const char* _value, const char* _name)
+APT_TARGET_AVX2 static inline __m256i Base64EncLookup256(__m256i _indices)
 {
-	m_impl->findAddString(_name, -1, _value);
+	const __m256i shiftLut = _mm256_setr_epi8(
+		'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, 
+		'0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+		'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, 
+		'0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0
+		);
+	__m256i ret = _mm256_subs_epu8(_indices, _mm256_set1_epi8(51));
+	__m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), _indices);
+	ret = _mm256_or_si256(ret, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+	return _mm256_add_epi8(_mm256_shuffle_epi8(shiftLut, ret), _indices);
 }
-#define Json_setValue_Number(_type, _enum) \
-	template <> void Json::setValue<_type>(_type _value, int _i) { \
-		m_impl->findAddNumber<_type>(nullptr, _i, _value); \
-	} \
-	template <> void Json::setValue<_type>(_type _value, const char* _name) { \
-		m_impl->findAddNumber<_type>(_name, -1, _value); \
-	}
-APT_DataType_decl(Json_setValue_Number)
-
-#define Json_setValue_Vector(_type) \
-	template <> void Json::setValue<_type>(_type _value, int _i) { \
-		m_impl->findAddVector<_type>(nullptr, _i, _value); \
-	} \
-	template <> void Json::setValue<_type>(_type _value, const char* _name) { \
-		m_impl->findAddVector<_type>(_name, -1, _value); \
-	}
-Json_setValue_Vector(vec2)
-Json_setValue_Vector(vec3)
-Json_setValue_Vector(vec4)
-Json_setValue_Vector(ivec2)
-Json_setValue_Vector(ivec3)
-Json_setValue_Vector(ivec4)
-Json_setValue_Vector(uvec2)
-Json_setValue_Vector(uvec3)
-Json_setValue_Vector(uvec4)
-
 
-#define Json_setValue_Matrix(_type, _count) \
-	template <> void Json::setValue<_type>(_type _value, int _i) { \
-		m_impl->findAddMatrix<_type, _count>(nullptr, _i, _value); \
-	} \
-	template <> void Json::setValue<_type>(_type _value, const char* _name) { \
-		m_impl->findAddMatrix<_type, _count>(_name, -1, _value); \
+APT_TARGET_SSE41 static uint Base64EncodeSse41(const uint8* _in, uint _inSizeBytes, char* out_)
+{
+	uint i = 0;
+	for (; i + 16 <= _inSizeBytes; i += 12, out_ += 16) { // load 16 bytes, consume 12
+		__m128i v = _mm_loadu_si128((const __m128i*)(_in + i));
+		v = _mm_shuffle_epi8(v, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+		__m128i t0 = _mm_mulhi_epu16(_mm_and_si128(v, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+		__m128i t1 = _mm_mullo_epi16(_mm_and_si128(v, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+		_mm_storeu_si128((__m128i*)out_, Base64EncLookup128(_mm_or_si128(t0, t1)));
 	}
-Json_setValue_Matrix(mat2, 2)
-Json_setValue_Matrix(mat3, 3)
-Json_setValue_Matrix(mat4, 4)
-
-#define Json_pushValue(_type, _enum) \
-	template <> void Json::pushValue<_type>(_type _value) { \
-		m_impl->pushNew(); \
-		setValue(_value); \
+	return i;
+}
+APT_TARGET_AVX2 static uint Base64EncodeAvx2(const uint8* _in, uint _inSizeBytes, char* out_)
+{
+	uint i = 0;
+	for (; i + 28 <= _inSizeBytes; i += 24, out_ += 32) { // 12 bytes per lane
+		__m256i v = _mm256_inserti128_si256(
+			_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(_in + i))),
+			_mm_loadu_si128((const __m128i*)(_in + i + 12)), 
+			1
+			);
+		v = _mm256_shuffle_epi8(v, _mm256_set_epi8(
+			10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+			10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1
+			));
+		__m256i t0 = _mm256_mulhi_epu16(_mm256_and_si256(v, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040));
+		__m256i t1 = _mm256_mullo_epi16(_mm256_and_si256(v, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010));
+		_mm256_storeu_si256((__m256i*)out_, Base64EncLookup256(_mm256_or_si256(t0, t1)));
 	}
-Json_pushValue(bool, 0)
-Json_pushValue(const char*, 0)
-APT_DataType_decl(Json_pushValue)
-Json_pushValue(vec2, 0)
-Json_pushValue(vec3, 0)
-Json_pushValue(vec4, 0)
-Json_pushValue(ivec2, 0)
-Json_pushValue(ivec3, 0)
-Json_pushValue(ivec4, 0)
-Json_pushValue(uvec2, 0)
-Json_pushValue(uvec3, 0)
-Json_pushValue(uvec4, 0)
-Json_pushValue(mat2, 0)
-Json_pushValue(mat3, 0)
-Json_pushValue(mat4, 0)
+	return i;
+}
 
-void Json::beginObject(const char* _name)
+// Decode 16/32 chars per iteration. Invalid chars are detected via the nibble lookup tables, in which case stop and let the 
+// scalar path report the error. Output is written 16/32 bytes at a time, hence _outSizeBytes is required.
+APT_TARGET_SSE41 static uint Base64DecodeSse41(const char* _in, uint _inSizeBytes, uint8* out_, uint _outSizeBytes)
 {
-	if (m_impl->m_containerStack.back().getType() == ValueType_Object) {
-		APT_ASSERT(_name);
-		if (!m_impl->find(_name)) {
-			m_impl->addNew(_name);
-			m_impl->m_currentValue.m_value->SetObject();
+	const __m128i lutLo   = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+	const __m128i lutHi   = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+	const __m128i lutRoll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m128i mask2f  = _mm_set1_epi8(0x2f);
+	uint i = 0;
+	for (uint o = 0; i + 16 <= _inSizeBytes && o + 16 <= _outSizeBytes; i += 16, o += 12) {
+		__m128i v = _mm_loadu_si128((const __m128i*)(_in + i));
+		__m128i hiNibbles = _mm_and_si128(_mm_srli_epi32(v, 4), mask2f);
+		__m128i lo = _mm_shuffle_epi8(lutLo, _mm_and_si128(v, mask2f));
+		__m128i hi = _mm_shuffle_epi8(lutHi, hiNibbles);
+		if (!_mm_testz_si128(lo, hi)) {
+			break;
 		}
-			
-	} else {
-		if (_name) {
-			APT_LOG_ERR("Json: beginObject() called inside array, name '%s' will be ignored", _name);
+		__m128i roll = _mm_shuffle_epi8(lutRoll, _mm_add_epi8(_mm_cmpeq_epi8(v, mask2f), hiNibbles));
+		v = _mm_add_epi8(v, roll);
+		v = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+		v = _mm_madd_epi16(v, _mm_set1_epi32(0x00011000));
+		v = _mm_shuffle_epi8(v, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+		_mm_storeu_si128((__m128i*)(out_ + o), v);
+	}
+	return i;
+}
+APT_TARGET_AVX2 static uint Base64DecodeAvx2(const char* _in, uint _inSizeBytes, uint8* out_, uint _outSizeBytes)
+{
+	const __m256i lutLo   = _mm256_setr_epi8(
+		0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+		0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a
+		);
+	const __m256i lutHi   = _mm256_setr_epi8(
+		0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+		0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10
+		);
+	const __m256i lutRoll = _mm256_setr_epi8(
+		0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0
+		);
+	const __m256i mask2f  = _mm256_set1_epi8(0x2f);
+	uint i = 0;
+	for (uint o = 0; i + 32 <= _inSizeBytes && o + 32 <= _outSizeBytes; i += 32, o += 24) {
+		__m256i v = _mm256_loadu_si256((const __m256i*)(_in + i));
+		__m256i hiNibbles = _mm256_and_si256(_mm256_srli_epi32(v, 4), mask2f);
+		__m256i lo = _mm256_shuffle_epi8(lutLo, _mm256_and_si256(v, mask2f));
+		__m256i hi = _mm256_shuffle_epi8(lutHi, hiNibbles);
+		if (!_mm256_testz_si256(lo, hi)) {
+			break;
 		}
-		m_impl->pushNew();
-		m_impl->m_currentValue.m_value->SetObject();
+		__m256i roll = _mm256_shuffle_epi8(lutRoll, _mm256_add_epi8(_mm256_cmpeq_epi8(v, mask2f), hiNibbles));
+		v = _mm256_add_epi8(v, roll);
+		v = _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+		v = _mm256_madd_epi16(v, _mm256_set1_epi32(0x00011000));
+		v = _mm256_shuffle_epi8(v, _mm256_setr_epi8(
+			2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+			2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1
+			));
+		v = _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1)); // pack 12 bytes from each lane
+		_mm256_storeu_si256((__m256i*)(out_ + o), v);
 	}
-	m_impl->enter();
+	return i;
 }
 
-void Json::beginArray(const char* _name)
+// Write Base64EncSizeBytes(_inSizeBytes) chars + a null terminator to out_.
+static void Base64Encode(const char* _in, uint _inSizeBytes, char* out_, uint _outSizeBytes)
 {
-	if (m_impl->m_containerStack.back().getType() == ValueType_Object) {
-		APT_ASSERT(_name);
-		if (!m_impl->find(_name)) {
-			m_impl->addNew(_name);
-			m_impl->m_currentValue.m_value->SetArray();
-		}
+	APT_ASSERT(_outSizeBytes == Base64EncSizeBytes(_inSizeBytes));
+	const Base64Tables& tables = GetBase64Tables();
+	const uint8* in = (const uint8*)_in;
+	uint i = 0;
+	if (tables.m_hasAvx2) {
+		i = Base64EncodeAvx2(in, _inSizeBytes, out_);
+	} else if (tables.m_hasSse41) {
+		i = Base64EncodeSse41(in, _inSizeBytes, out_);
+	}
+	i += Base64EncodeSw(in + i, _inSizeBytes - i, out_ + i / 3 * 4);
 
-	} else {
-		if (_name) {
-			APT_LOG_ERR("Json: beginArray() called inside array, name '%s' will be ignored", _name);
+	char* out = out_ + i / 3 * 4;
+	uint rem = _inSizeBytes - i;
+	if (rem) {
+		uint32 v = (uint32)in[i] << 16;
+		if (rem > 1) {
+			v |= (uint32)in[i + 1] << 8;
 		}
-		m_impl->pushNew();
-		m_impl->m_currentValue.m_value->SetArray();
+		out[0] = kBase64Alphabet[(v >> 18) & 0x3f];
+		out[1] = kBase64Alphabet[(v >> 12) & 0x3f];
+		out[2] = rem > 1 ? kBase64Alphabet[(v >> 6) & 0x3f] : '=';
+		out[3] = '=';
+		out += 4;
 	}
-	m_impl->enter();
+	*out = '\0';
 }
 
-static bool VisitRecursive(Json* _json_, Json::OnVisit* _onVisit, int _depth = 0)
+// _inSizeBytes excludes padding (see Base64DecSizeBytes()). Return false if _in contains invalid chars.
+static bool Base64Decode(const char* _in, uint _inSizeBytes, char* out_, uint _outSizeBytes)
 {
-	bool ret = true;
+	const Base64Tables& tables = GetBase64Tables();
+	uint8* out = (uint8*)out_;
+	uint i = 0;
+	if (tables.m_hasAvx2) {
+		i = Base64DecodeAvx2(_in, _inSizeBytes, out, _outSizeBytes);
+	} else if (tables.m_hasSse41) {
+		i = Base64DecodeSse41(_in, _inSizeBytes, out, _outSizeBytes);
+	}
+	bool valid;
+	i += Base64DecodeSw(tables.m_decode, _in + i, _inSizeBytes - i, out + i / 4 * 3, valid);
+	if (!valid) {
+		return false;
+	}
 
-	while (ret && _json_->next()) {
-		auto type  = _json_->getType();
-		auto name  = _json_->getName();
-		auto index = _json_->getIndex();
-		ret = _onVisit(_json_, type, name, index, _depth);
-		if (ret) {
-			if (type == Json::ValueType_Array) {
-				_json_->enterArray();
-				ret = VisitRecursive(_json_, _onVisit, _depth + 1);
-				_json_->leaveArray();
-			} else if (type == Json::ValueType_Object) {
-				_json_->enterObject();
-				ret = VisitRecursive(_json_, _onVisit, _depth + 1);
-				_json_->leaveObject();
-			}
+	out += i / 4 * 3;
+	uint rem = _inSizeBytes - i;
+	if (rem) {
+		APT_ASSERT(rem == 2 || rem == 3);
+		uint32 a = tables.m_decode[(uint8)_in[i]];
+		uint32 b = tables.m_decode[(uint8)_in[i + 1]];
+		uint32 c = rem > 2 ? tables.m_decode[(uint8)_in[i + 2]] : 0;
+		if ((a | b | c) & 0x80) {
+			return false;
+		}
+		uint32 v = (a << 18) | (b << 12) | (c << 6);
+		*out++ = (uint8)(v >> 16);
+		if (rem > 2) {
+			*out++ = (uint8)(v >> 8);
 		}
 	}
-
-	return ret;
-}
-void Json::visitAll(OnVisit* _onVisit)
-{
-	APT_STRICT_ASSERT(_onVisit);
-	VisitRecursive(this, _onVisit);
+	APT_ASSERT((uint)(out - (uint8*)out_) == _outSizeBytes);
+	return true;
 }
 
-/*******************************************************************************
-
-                              SerializerJson
-
-*******************************************************************************/
-
-// PUBLIC
-
-SerializerJson::SerializerJson(Json& _json_, Mode _mode)
-	: Serializer(_mode) 
-	, m_json(&_json_)
+bool SerializerJson::binary(void*& _data_, uint& _sizeBytes_, const char* _name, CompressionFlags _compressionFlags)
 {
-}
+ // See BinaryPrefixSize() for the format.
+	if (getMode() == Mode_Write) {
+		APT_ASSERT(_data_);
+		char* data = (char*)_data_;
+		uint sizeBytes = _sizeBytes_;
+		if (_compressionFlags != CompressionFlags_None) {
+			data = nullptr;
+			Compress(_data_, _sizeBytes_, (void*&)data, sizeBytes, _compressionFlags, getBinaryDictionary());
+		}
+		bool checksum = _compressionFlags != CompressionFlags_None && getBinaryChecksum();
+		String<16> prefix;
+		if (checksum) {
+			prefix.setf("2%08x", Crc32c(_data_, _sizeBytes_));
+		} else {
+			prefix.set(_compressionFlags == CompressionFlags_None ? "0" : "1"); // prepend 0, or 1 if compression
+		}
+		uint prefixSize = prefix.getLength();
+		if (m_binaryRaw && !m_stream) {
+			uint rawSize = 1 + prefixSize + sizeBytes;
+			char* raw = (char*)APT_MALLOC(rawSize);
+			raw[0] = '\0';
+			memcpy(raw + 1, (const char*)prefix, prefixSize);
+			memcpy(raw + 1 + prefixSize, data, sizeBytes);
+			Json::Impl& impl = *m_json->m_impl;
+			if (_name) {
+				impl.findAdd(_name, -1);
+			} else {
+				impl.pushNew();
+			}
+			impl.m_currentValue.m_value->SetString(raw, rawSize, impl.m_dom.GetAllocator());
+			APT_FREE(raw);
+		} else {
+			String<0> str;
+			str.setLength(Base64EncSizeBytes(sizeBytes) + prefixSize);
+			memcpy((char*)str, (const char*)prefix, prefixSize);
+			Base64Encode(data, sizeBytes, (char*)str + prefixSize, str.getLength() - prefixSize);
+			value((StringBase&)str, _name);
+		}
+		if (_compressionFlags != CompressionFlags_None) {
+			free(data);
+		}
 
-bool SerializerJson::beginObject(const char* _name)
-{
-	if (getMode() == SerializerJson::Mode_Read) {
+	} else {
+	 // locate the value directly, raw binary strings contain null characters
 		if (_name) {
 			if (!m_json->find(_name)) {
-				setError("Error serializing object: '%s' not found", _name);
+				setError("Error serializing binary; '%s' not found", _name);
 				return false;
 			}
 		} else {
@@ -754,317 +3504,678 @@ bool SerializerJson::beginObject(const char* _name)
 				return false;
 			}
 		}
-		if (m_json->getType() != Json::ValueType_Object) {
-			setError("Error serializing object: '%s' not an object", m_json->getName());
+		if (m_json->getType() != Json::ValueType_String) {
+			setError("Error serializing binary; '%s' not a string", _name ? _name : "");
 			return false;
 		}
+		const JsonValue& jsonValue = *m_json->m_impl->m_currentValue.m_value;
+		const char* str = jsonValue.GetString();
+		uint strLength = jsonValue.GetStringLength();
+		bool raw = IsRawBinary(str, strLength);
+		if (raw) {
+			++str;
+			--strLength;
+		}
+		if (strLength == 0) {
+			setError("Error serializing binary '%s', missing prefix", _name ? _name : "");
+			return false;
+		}
+		bool compressed = str[0] == '1' || str[0] == '2';
+		bool checksum = str[0] == '2';
+		uint prefixSize = BinaryPrefixSize(str[0]);
+		uint32 crc = 0;
+		if (checksum) {
+			if (strLength < prefixSize) {
+				setError("Error serializing binary '%s', missing checksum", _name ? _name : "");
+				return false;
+			}
+			String<16> crcStr;
+			crcStr.set(str + 1, kBinaryChecksumSize);
+			crc = (uint32)strtoul((const char*)crcStr, nullptr, 16);
+		}
+		const char* payload = str + prefixSize;
+		uint payloadSizeBytes = strLength - prefixSize;
+		uint binSizeBytes = payloadSizeBytes;
+		char* bin = (char*)APT_MALLOC(binSizeBytes ? binSizeBytes : 1);
+		if (raw) {
+			memcpy(bin, payload, payloadSizeBytes);
+		} else {
+			if (!Base64DecSizeBytes(payload, payloadSizeBytes, binSizeBytes)) {
+				setError("Error serializing binary '%s', invalid base64 length", _name ? _name : "");
+				APT_FREE(bin);
+				return false;
+			}
+			if (!Base64Decode(payload, payloadSizeBytes, bin, binSizeBytes)) {
+				setError("Error serializing binary '%s', invalid base64 data", _name ? _name : "");
+				APT_FREE(bin);
+				return false;
+			}
+		}
 
-		m_json->enterObject();
-
-	} else {
-		m_json->beginObject(_name);
+		char* ret = bin;
+		uint retSizeBytes = binSizeBytes;
+		if (compressed) {
+			if (_data_) {
+			 // decompress directly to the caller's buffer
+				ret = (char*)_data_;
+				bool decompressed = Decompress(bin, binSizeBytes, ret, _sizeBytes_, retSizeBytes);
+				APT_FREE(bin);
+				if (!decompressed || retSizeBytes != _sizeBytes_) {
+					setError("Error serializing binary '%s', decompression failed (buffer size was %u)", _name ? _name : "", _sizeBytes_);
+					return false;
+				}
+			} else {
+				ret = nullptr; // Decompress allocates the final buffer
+				Decompress(bin, binSizeBytes, (void*&)ret, retSizeBytes);
+				APT_FREE(bin);
+			}
+		}
+		if (checksum && Crc32c(ret, retSizeBytes) != crc) {
+			setError("Error serializing binary '%s', checksum mismatch", _name ? _name : "");
+			if (ret != _data_) {
+				APT_FREE(ret);
+			}
+			return false;
+		}
+		if (ret == _data_) {
+			return true;
+		}
+		if (_data_) {
+			if (retSizeBytes != _sizeBytes_) {
+				setError("Error serializing binary '%s', buffer size was %u (expected %u)", _name ? _name : "", _sizeBytes_, retSizeBytes);
+				APT_FREE(ret);
+				return false;
+			}
+			memcpy(_data_, ret, retSizeBytes);
+			APT_FREE(ret);
+		} else {
+			_data_ = ret;
+			_sizeBytes_ = retSizeBytes;
+		}
 	}
-	
 	return true;
 }
-void SerializerJson::endObject()
+
+// PRIVATE
+
+void SerializerJson::onModeChange(Mode _mode)
 {
-	if (m_mode == Mode_Read) {
-		m_json->leaveObject();
+	if (m_stream) {
+		APT_ASSERT(_mode == Mode_Write); // streaming mode is write-only
 	} else {
-		m_json->endObject();
+		m_json->reset();
 	}
 }
 
-bool SerializerJson::beginArray(uint& _length_, const char* _name)
-{
-	if (getMode() == SerializerJson::Mode_Read) {
-		if (_name) {
-			if (!m_json->find(_name)) {
-				setError("Error serializing array: '%s' not found", _name);
-				return false;
-			}
-		} else {
-			if (!m_json->next()) {
-				return false;
-			}
-		}
-		if (m_json->getType() != Json::ValueType_Array) {
-			setError("Error serializing array: '%s' not an array", m_json->getName());
-			return false;
-		}
+/*******************************************************************************
 
-		m_json->enterArray();
-		_length_ = (uint)m_json->getArrayLength();
+                                JsonReader
 
-	} else {
-		m_json->beginArray(_name);
-	}
+*******************************************************************************/
 
-	return true;
-}
-void SerializerJson::endArray()
+// PUBLIC
+
+JsonReader::JsonReader(File& _file_, uint _bufferSizeBytes)
+	: m_file(nullptr)
+	, m_buffer(nullptr)
+	, m_bufferSize(0)
+	, m_offset(0)
+	, m_token(Token_End)
+	, m_isDone(false)
 {
-	if (m_mode == Mode_Read) {
-		m_json->leaveArray();
+	if (_file_.isOpen()) {
+		m_file = &_file_;
+		m_bufferSize = APT_MAX(_bufferSizeBytes, (uint)1);
+		m_buffer = (char*)APT_MALLOC(m_bufferSize);
+		m_beg = m_cur = m_end = m_buffer;
 	} else {
-		m_json->endArray();
+		m_beg = m_cur = _file_.getData();
+		m_end = m_beg + _file_.getDataSize();
 	}
+	m_name.push_back('\0');
+	m_string.push_back('\0');
 }
 
-const char* SerializerJson::getName() const
+JsonReader::JsonReader(const char* _data, uint64 _sizeBytes)
+	: m_file(nullptr)
+	, m_buffer(nullptr)
+	, m_bufferSize(0)
+	, m_beg(_data)
+	, m_cur(_data)
+	, m_end(_data + _sizeBytes)
+	, m_offset(0)
+	, m_token(Token_End)
+	, m_isDone(false)
 {
-	return m_json->getName();
+	m_name.push_back('\0');
+	m_string.push_back('\0');
 }
 
-uint32 SerializerJson::getIndex() const
+JsonReader::~JsonReader()
 {
-	return (uint32)m_json->getIndex();
+	if (m_buffer) {
+		APT_FREE(m_buffer);
+	}
 }
 
-template <typename tType>
-static bool ValueImpl(SerializerJson& _serializer_, tType& _value_, const char* _name)
+JsonReader::Token JsonReader::next()
 {
-	Json* json = _serializer_.getJson();
-	//if (!_name && json->getArrayLength() < 0) {
-	//	_serializer_.setError("Error serializing %s: name must be specified if not in an array", Serializer::ValueTypeToStr<tType>());
-	//	return false;
-	//}
+	if (m_token == Token_Error) {
+		return m_token;
+	}
+	if (!skipWhitespace()) {
+		return m_token;
+	}
 
-	if (_serializer_.getMode() == SerializerJson::Mode_Read) {
-		if (_name) {
-			if (!json->find(_name)) {
-				_serializer_.setError("Error serializing %s: '%s' not found", Serializer::ValueTypeToStr<tType>(), _name);
-				return false;
+	if (m_stack.empty()) {
+		if (m_isDone) {
+			if (peek() != -1) {
+				return setError("Unexpected data after the root value");
 			}
-		} else {
-			if (!json->next()) {
-				return false;
+			return m_token = Token_End;
+		}
+		m_isDone = true;
+		return readValue();
+	}
+
+	Container& container = m_stack.back();
+	char close = container.m_isArray ? ']' : '}';
+	int c = peek();
+	if (!container.m_isFirst) {
+		if (c == ',') {
+			take();
+			if (!skipWhitespace()) {
+				return m_token;
 			}
+			c = peek(); // trailing commas are permitted
+		} else if (c != close) {
+			return setError("Expected ',' or '%c'", close);
 		}
-		_value_ = json->getValue<tType>();
-		return true;
+	}
+	if (c == close) {
+		take();
+		bool isArray = container.m_isArray;
+		m_stack.pop_back();
+		m_name.clear();
+		m_name.push_back('\0');
+		return m_token = isArray ? Token_EndArray : Token_EndObject;
+	}
 
+	container.m_isFirst = false;
+	if (container.m_isArray) {
+		m_name.clear();
+		m_name.push_back('\0');
 	} else {
-		if (_name) {
-			json->setValue<tType>(_value_, _name);
-		} else {
-			json->pushValue<tType>(_value_);
+		if (take() != '"') {
+			return setError("Expected a member name");
+		}
+		if (!readString(m_name) || !skipWhitespace()) {
+			return m_token;
+		}
+		if (take() != ':') {
+			return setError("Expected ':' after '%s'", m_name.data());
+		}
+		if (!skipWhitespace()) {
+			return m_token;
 		}
-		return true; 
 	}
+	return readValue();
 }
 
-bool SerializerJson::value(bool&    _value_, const char* _name) { return ValueImpl<bool>   (*this, _value_, _name); }
-bool SerializerJson::value(sint8&   _value_, const char* _name) { return ValueImpl<sint8>  (*this, _value_, _name); }
-bool SerializerJson::value(uint8&   _value_, const char* _name) { return ValueImpl<uint8>  (*this, _value_, _name); }
-bool SerializerJson::value(sint16&  _value_, const char* _name) { return ValueImpl<sint16> (*this, _value_, _name); }
-bool SerializerJson::value(uint16&  _value_, const char* _name) { return ValueImpl<uint16> (*this, _value_, _name); }
-bool SerializerJson::value(sint32&  _value_, const char* _name) { return ValueImpl<sint32> (*this, _value_, _name); }
-bool SerializerJson::value(uint32&  _value_, const char* _name) { return ValueImpl<uint32> (*this, _value_, _name); }
-bool SerializerJson::value(sint64&  _value_, const char* _name) { return ValueImpl<sint64> (*this, _value_, _name); }
-bool SerializerJson::value(uint64&  _value_, const char* _name) { return ValueImpl<uint64> (*this, _value_, _name); }
-bool SerializerJson::value(float32& _value_, const char* _name) { return ValueImpl<float32>(*this, _value_, _name); }
-bool SerializerJson::value(float64& _value_, const char* _name) { return ValueImpl<float64>(*this, _value_, _name); }
-
-bool SerializerJson::value(StringBase& _value_, const char* _name) 
-{ 
-	//if (!_name && m_json->getArrayLength() == -1) {
-	//	setError("Error serializing StringBase; name must be specified if not in an array");
-	//	return false;
-	//}
-	if (getMode() == SerializerJson::Mode_Read) {
-		if (_name) {
-			if (!m_json->find(_name)) {
-				setError("Error serializing StringBase; '%s' not found", _name);
-				return false;
-			}
-		} else {
-			if (!m_json->next()) {
-				return false;
+bool JsonReader::skip()
+{
+	if (m_token != Token_BeginObject && m_token != Token_BeginArray) {
+		return false;
+	}
+	int depth = 1;
+	while (depth > 0) {
+	 // scan the current chunk for the next character of interest
+		const char* cur = m_cur;
+		while (cur < m_end) {
+			char c = *cur;
+			if (c == '"' || c == '{' || c == '}' || c == '[' || c == ']' || c == '/') {
+				break;
 			}
+			++cur;
 		}
+		m_cur = cur;
 
-		if (m_json->getType() == Json::ValueType_String) {
-			_value_.set(m_json->getValue<const char*>());
-			return true;
-		} else {
-			setError("Error serializing StringBase; '%s' not a string", _name ? _name : "");
+		switch (take()) {
+			case -1:
+				setError("Unexpected end of data");
+				return false;
+			case '"':
+				if (!skipString()) {
+					return false;
+				}
+				break;
+			case '/':
+				if (!skipComment()) {
+					return false;
+				}
+				break;
+			case '{':
+			case '[':
+				++depth;
+				break;
+			case '}':
+			case ']':
+				--depth;
+				break;
+			default:
+				break;
+		};
+	}
+
+	bool isArray = m_stack.back().m_isArray;
+	m_stack.pop_back();
+	m_name.clear();
+	m_name.push_back('\0');
+	m_token = isArray ? Token_EndArray : Token_EndObject;
+	return true;
+}
+
+bool JsonReader::find(const char* _name)
+{
+	if (m_stack.empty() || m_stack.back().m_isArray) {
+		return false;
+	}
+	uint depth = (uint)m_stack.size();
+	for (;;) {
+		Token token = next();
+		if (token == Token_Error || m_stack.size() < depth) {
 			return false;
 		}
-
-	} else {
-		if (_name) {
-			m_json->setValue<const char*>((const char*)_value_, _name);
-		} else {
-			m_json->pushValue<const char*>((const char*)_value_);
+		if (strcmp(getName(), _name) == 0) {
+			return true;
+		}
+		if (token == Token_BeginObject || token == Token_BeginArray) {
+			if (!skip()) {
+				return false;
+			}
 		}
-		return true; 
 	}
 }
 
+bool JsonReader::read(Json& json_)
+{
+	if (m_token != Token_BeginObject) {
+		return false;
+	}
+	Json::Impl& impl = *json_.m_impl;
+	impl.clear();
+	auto generator = [this](JsonDocument& _handler_) { return populate(_handler_); };
+	impl.m_dom.Populate(generator);
+	if (!impl.m_dom.IsObject()) {
+		impl.m_dom.SetObject();
+	}
+	impl.reset();
+	return m_token != Token_Error;
+}
 
-// Base64 encode/decode of binary data, adapted from https://github.com/adamvr/arduino-base64
-static const char kBase64Alphabet[] = 
-		"ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-		"abcdefghijklmnopqrstuvwxyz"
-		"0123456789+/"
-		;
-static inline void Base64A3ToA4(const unsigned char* _a3, unsigned char* a4_) 
+template <> bool JsonReader::getValue<bool>() const
 {
-	a4_[0] = (_a3[0] & 0xfc) >> 2;
-	a4_[1] = ((_a3[0] & 0x03) << 4) + ((_a3[1] & 0xf0) >> 4);
-	a4_[2] = ((_a3[1] & 0x0f) << 2) + ((_a3[2] & 0xc0) >> 6);
-	a4_[3] = (_a3[2] & 0x3f);
+	APT_ASSERT(m_token == Token_Bool);
+	return m_bool;
 }
-static inline void Base64A4ToA3(const unsigned char* _a4, unsigned char* a3_) {
-	a3_[0] = (_a4[0] << 2) + ((_a4[1] & 0x30) >> 4);
-	a3_[1] = ((_a4[1] & 0xf) << 4) + ((_a4[2] & 0x3c) >> 2);
-	a3_[2] = ((_a4[2] & 0x3) << 6) + _a4[3];
+
+template <> const char* JsonReader::getValue<const char*>() const
+{
+	APT_ASSERT(m_token == Token_String);
+	return m_string.data();
 }
-static inline unsigned char Base64Index(char _c)
+
+template <typename tType>
+tType JsonReader::getNumber() const
 {
-	if (_c >= 'A' && _c <= 'Z') return _c - 'A';
-	if (_c >= 'a' && _c <= 'z') return _c - 71;
-	if (_c >= '0' && _c <= '9') return _c + 4;
-	if (_c == '+') return 62;
-	if (_c == '/') return 63;
-	return -1;
+	APT_ASSERT(m_token == Token_Number);
+	switch (APT_DATA_TYPE_TO_ENUM(tType)) {
+		case DataType_Float16:
+			return (tType)PackFloat16((float32)m_float);
+		case DataType_Float32:
+		case DataType_Float64:
+			return (tType)m_float;
+		default:
+			return DataTypeIsSigned(APT_DATA_TYPE_TO_ENUM(tType)) ? (tType)m_sint : (tType)m_uint;
+	};
 }
-static void Base64Encode(const char* _in, uint _inSizeBytes, char* out_, uint outSizeBytes_)
+
+#define JsonReader_getValue_Number(_type, _enum) \
+	template <> _type JsonReader::getValue<_type>() const { \
+		return getNumber<_type>(); \
+	}
+APT_DataType_decl(JsonReader_getValue_Number)
+
+// PRIVATE
+
+bool JsonReader::refill()
 {
-	uint i = 0;
-	uint j = 0;
-	uint k = 0;
-	unsigned char a3[3];
-	unsigned char a4[4];
-	while (_inSizeBytes--) {
-		a3[i++] = *(_in++);
-		if (i == 3) {
-			Base64A3ToA4(a3, a4);
-			for (i = 0; i < 4; i++) {
-				out_[k++] = kBase64Alphabet[a4[i]];
-			}
-			i = 0;
-		}
+	if (!m_file) {
+		return false;
 	}
-	if (i) {
-		for (j = i; j < 3; j++) {
-			a3[j] = '\0';
+	m_offset += (uint64)(m_end - m_beg);
+	uint64 n = m_file->read(m_buffer, m_bufferSize);
+	m_beg = m_cur = m_buffer;
+	m_end = m_buffer + n;
+	return n > 0;
+}
+
+JsonReader::Token JsonReader::setError(const char* _msg, ...)
+{
+	va_list args;
+	va_start(args, _msg);
+	m_error.setfv(_msg, args);
+	va_end(args);
+	APT_LOG_ERR("JsonReader: %s (offset %llu)", (const char*)m_error, getOffset());
+	return m_token = Token_Error;
+}
+
+bool JsonReader::skipWhitespace()
+{
+	for (;;) {
+		while (m_cur < m_end && (*m_cur == ' ' || *m_cur == '\t' || *m_cur == '\n' || *m_cur == '\r')) {
+			++m_cur;
+		}
+		int c = peek();
+		if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+			continue;
 		}
-		Base64A3ToA4(a3, a4);
-		for (j = 0; j < i + 1; j++) {
-			out_[k++] = kBase64Alphabet[a4[j]];
+		if (c != '/') {
+			return true;
 		}
-		while ((i++ < 3)) {
-			out_[k++] = '=';
+		take();
+		if (!skipComment()) {
+			return false;
 		}
 	}
-	out_[k] = '\0';
-	APT_ASSERT(outSizeBytes_ == k); // overflow
 }
-static void Base64Decode(const char* _in, uint _inSizeBytes, char* out_, uint outSizeBytes_) {
-	uint i = 0;
-	uint j = 0;
-	uint k = 0;
-	unsigned char a3[3];
-	unsigned char a4[4];
-	while (_inSizeBytes--) {
-		if (*_in == '=') {
-			break;
-		}
-		a4[i++] = *(_in++);
-		if (i == 4) {
-			for (i = 0; i < 4; i++) {
-				a4[i] = Base64Index(a4[i]);
-			}
-			Base64A4ToA3(a4, a3);
-			for (i = 0; i < 3; i++) {
-				out_[k++] = a3[i];
+
+bool JsonReader::skipComment()
+{
+	int c = take();
+	if (c == '/') {
+		while ((c = take()) != -1 && c != '\n');
+		return true;
+	}
+	if (c == '*') {
+		int prev = 0;
+		while ((c = take()) != -1) {
+			if (prev == '*' && c == '/') {
+				return true;
 			}
-			i = 0;
+			prev = c;
 		}
+		setError("Unterminated comment");
+		return false;
 	}
+	setError("Invalid comment");
+	return false;
+}
+
+JsonReader::Token JsonReader::readValue()
+{
+	int c = peek();
+	switch (c) {
+		case '{':
+		case '[':
+			take();
+			m_stack.push_back({ c == '[', true });
+			return m_token = (c == '[' ? Token_BeginArray : Token_BeginObject);
+		case '"':
+			take();
+			return readString(m_string) ? (m_token = Token_String) : m_token;
+		case 't':
+		case 'f':
+			m_bool = c == 't';
+			return readLiteral(m_bool ? "true" : "false") ? (m_token = Token_Bool) : m_token;
+		case 'n':
+			return readLiteral("null") ? (m_token = Token_Null) : m_token;
+		case -1:
+			return setError("Unexpected end of data");
+		default:
+			if (c == '-' || (c >= '0' && c <= '9')) {
+				return readNumber() ? (m_token = Token_Number) : m_token;
+			}
+			return setError("Unexpected character '%c'", (char)c);
+	};
+}
+
+bool JsonReader::readString(eastl::vector<char>& out_)
+{
+	out_.clear();
+	for (;;) {
+	 // copy runs of unescaped characters from the current chunk
+		const char* run = m_cur;
+		while (m_cur < m_end && *m_cur != '"' && *m_cur != '\\' && (uint8)*m_cur >= 0x20) {
+			++m_cur;
+		}
+		if (m_cur != run) {
+			out_.insert(out_.end(), run, m_cur);
+		}
 
-	if (i) {
-		for (j = i; j < 4; j++) {
-			a4[j] = '\0';
+		int c = take();
+		if (c == '"') {
+			break;
 		}
-		for (j = 0; j < 4; j++) {
-			a4[j] = Base64Index(a4[j]);
+		if (c == -1) {
+			return stringError(out_, "Unterminated string");
 		}
-		Base64A4ToA3(a4, a3);
-		for (j = 0; j < i - 1; j++) {
-			out_[k++] = a3[j];
+		if (c != '\\') {
+			if (c < 0x20) {
+				return stringError(out_, "Invalid character in string");
+			}
+			out_.push_back((char)c);
+			continue;
 		}
+
+		c = take();
+		switch (c) {
+			case '"':  out_.push_back('"');  break;
+			case '\\': out_.push_back('\\'); break;
+			case '/':  out_.push_back('/');  break;
+			case 'b':  out_.push_back('\b'); break;
+			case 'f':  out_.push_back('\f'); break;
+			case 'n':  out_.push_back('\n'); break;
+			case 'r':  out_.push_back('\r'); break;
+			case 't':  out_.push_back('\t'); break;
+			case 'u': {
+				uint32 codepoint = 0;
+				for (int n = 0; n < 2; ++n) {
+					uint32 u = 0;
+					for (int i = 0; i < 4; ++i) {
+						c = take();
+						int h = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+						if (h < 0) {
+							return stringError(out_, "Invalid unicode escape");
+						}
+						u = (u << 4) | (uint32)h;
+					}
+					if (n == 0) {
+						codepoint = u;
+						if (u < 0xd800 || u > 0xdbff) {
+							break;
+						}
+					 // high surrogate, expect a low surrogate
+						if (take() != '\\' || take() != 'u') {
+							return stringError(out_, "Invalid unicode surrogate");
+						}
+					} else {
+						if (u < 0xdc00 || u > 0xdfff) {
+							return stringError(out_, "Invalid unicode surrogate");
+						}
+						codepoint = 0x10000 + ((codepoint - 0xd800) << 10) + (u - 0xdc00);
+					}
+				}
+			 // encode UTF-8
+				if (codepoint < 0x80) {
+					out_.push_back((char)codepoint);
+				} else if (codepoint < 0x800) {
+					out_.push_back((char)(0xc0 | (codepoint >> 6)));
+					out_.push_back((char)(0x80 | (codepoint & 0x3f)));
+				} else if (codepoint < 0x10000) {
+					out_.push_back((char)(0xe0 | (codepoint >> 12)));
+					out_.push_back((char)(0x80 | ((codepoint >> 6) & 0x3f)));
+					out_.push_back((char)(0x80 | (codepoint & 0x3f)));
+				} else {
+					out_.push_back((char)(0xf0 | (codepoint >> 18)));
+					out_.push_back((char)(0x80 | ((codepoint >> 12) & 0x3f)));
+					out_.push_back((char)(0x80 | ((codepoint >> 6) & 0x3f)));
+					out_.push_back((char)(0x80 | (codepoint & 0x3f)));
+				}
+				break;
+			}
+			default:
+				return stringError(out_, "Invalid escape sequence");
+		};
 	}
-	APT_ASSERT(outSizeBytes_ == k); // overflow
+	out_.push_back('\0');
+	return true;
 }
-static uint Base64EncSizeBytes(uint _sizeBytes) 
+
+bool JsonReader::stringError(eastl::vector<char>& out_, const char* _msg)
 {
-	uint n = _sizeBytes;
-	return (n + 2 - ((n + 2) % 3)) / 3 * 4;
+	setError(_msg);
+	out_.push_back('\0');
+	return false;
 }
-static uint Base64DecSizeBytes(char* _buf, uint _sizeBytes) 
+
+bool JsonReader::readNumber()
 {
-	uint padCount = 0;
-	for (uint i = _sizeBytes - 1; _buf[i] == '='; i--) {
-		padCount++;
+	char buf[64];
+	uint n = 0;
+	bool isInteger = true;
+	for (int c = peek(); (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E'; c = peek()) {
+		if (n == sizeof(buf) - 1) {
+			setError("Number too long");
+			return false;
+		}
+		isInteger &= c != '.' && c != 'e' && c != 'E';
+		buf[n++] = (char)take();
+	}
+	buf[n] = '\0';
+
+	char* end = nullptr;
+	errno = 0;
+	bool isNegative = buf[0] == '-';
+	if (isInteger) {
+		if (isNegative) {
+			m_sint = strtoll(buf, &end, 10);
+			m_uint = (uint64)m_sint;
+			m_float = (float64)m_sint;
+		} else {
+			m_uint = strtoull(buf, &end, 10);
+			m_sint = (sint64)m_uint;
+			m_float = (float64)m_uint;
+		}
+		isInteger = errno != ERANGE; // out of range, read as a float
+	}
+	if (!isInteger) {
+		m_float = strtod(buf, &end);
+	 // integer conversions are only defined if the value is in range
+		m_sint = (m_float >= -9223372036854775808.0 && m_float < 9223372036854775808.0) ? (sint64)m_float : 0;
+		m_uint = (m_float >= 0.0 && m_float < 18446744073709551616.0) ? (uint64)m_float : (uint64)m_sint;
 	}
-	return ((6 * _sizeBytes) / 8) - padCount;
+	if (end != buf + n) {
+		setError("Invalid number '%s'", buf);
+		return false;
+	}
+	m_isInteger  = isInteger;
+	m_isNegative = isNegative;
+	return true;
 }
 
-bool SerializerJson::binary(void*& _data_, uint& _sizeBytes_, const char* _name, CompressionFlags _compressionFlags)
+bool JsonReader::readLiteral(const char* _str)
 {
-	if (getMode() == Mode_Write) {
-		APT_ASSERT(_data_);
-		char* data = (char*)_data_;
-		uint sizeBytes = _sizeBytes_;
-		if (_compressionFlags != CompressionFlags_None) {
-			data = nullptr;
-			Compress(_data_, _sizeBytes_, (void*&)data, sizeBytes, _compressionFlags);
-		}
-		String<0> str;
-		str.setLength(Base64EncSizeBytes(sizeBytes) + 1);
-		str[0] = _compressionFlags == CompressionFlags_None ? '0' : '1'; // prepend 0, or 1 if compression
-		Base64Encode(data, sizeBytes, (char*)str + 1, str.getLength() - 1);
-		if (_compressionFlags != CompressionFlags_None) {
-			free(data);
+	for (const char* c = _str; *c; ++c) {
+		if (take() != *c) {
+			setError("Invalid literal, expected '%s'", _str);
+			return false;
 		}
-		value((StringBase&)str, _name);
+	}
+	return true;
+}
 
-	} else {
-		String<0> str;
-		if (!value((StringBase&)str, _name)) {
+bool JsonReader::skipString()
+{
+	for (;;) {
+		while (m_cur < m_end && *m_cur != '"' && *m_cur != '\\') {
+			++m_cur;
+		}
+		int c = take();
+		if (c == '"') {
+			return true;
+		}
+		if (c == -1 || (c == '\\' && take() == -1)) {
+			setError("Unterminated string");
 			return false;
 		}
-		bool compressed = str[0] == '1' ? true : false;
-		uint binSizeBytes = Base64DecSizeBytes((char*)str + 1, str.getLength() - 1);
-		char* bin = (char*)APT_MALLOC(binSizeBytes);
-		Base64Decode((char*)str + 1, str.getLength() - 1, bin, binSizeBytes);
+	}
+}
 
-		char* ret = bin;
-		uint retSizeBytes = binSizeBytes;
-		if (compressed) {
-			ret = nullptr; // decompress to allocates the final buffer
-			Decompress(bin, binSizeBytes, (void*&)ret, retSizeBytes);
-		}
-		if (_data_) {
-			if (retSizeBytes != _sizeBytes_) {
-				setError("Error serializing %s, buffer size was %llu (expected %llu)", _sizeBytes_, retSizeBytes);
-				if (compressed) {
-					APT_FREE(ret);
-				}
+template <typename tHandler>
+bool JsonReader::populate(tHandler& _handler_)
+{
+	APT_ASSERT(m_token == Token_BeginObject);
+	eastl::vector<rapidjson::SizeType> counts; // # members/elements per container
+	counts.push_back(0);
+	_handler_.StartObject();
+	for (;;) {
+		Token token = next();
+		bool isBegin = token == Token_BeginObject || token == Token_BeginArray;
+		if (token != Token_EndObject && token != Token_EndArray) {
+			if (token == Token_Error || token == Token_End) {
 				return false;
 			}
-			memcpy(_data_, ret, retSizeBytes);
-			if (compressed) {
-				APT_FREE(ret);
+			const Container& parent = m_stack[m_stack.size() - (isBegin ? 2 : 1)];
+			if (!parent.m_isArray) {
+				_handler_.Key(m_name.data(), (rapidjson::SizeType)(m_name.size() - 1), true);
 			}
-		} else {
-			_data_ = ret;
-			_sizeBytes_ = retSizeBytes;
+			++counts.back();
 		}
+		switch (token) {
+			case Token_BeginObject:
+				_handler_.StartObject();
+				counts.push_back(0);
+				break;
+			case Token_BeginArray:
+				_handler_.StartArray();
+				counts.push_back(0);
+				break;
+			case Token_EndObject:
+				_handler_.EndObject(counts.back());
+				counts.pop_back();
+				if (counts.empty()) {
+					return true;
+				}
+				break;
+			case Token_EndArray:
+				_handler_.EndArray(counts.back());
+				counts.pop_back();
+				break;
+			case Token_Null:
+				_handler_.Null();
+				break;
+			case Token_Bool:
+				_handler_.Bool(m_bool);
+				break;
+			case Token_Number:
+				if (!m_isInteger) {
+					_handler_.Double(m_float);
+				} else if (m_isNegative) {
+					_handler_.Int64(m_sint);
+				} else {
+					_handler_.Uint64(m_uint);
+				}
+				break;
+			case Token_String:
+				if (IsRawBinary(m_string.data(), (uint)(m_string.size() - 1))) {
+					setError(kReservedStringError);
+					return false;
+				}
+				_handler_.String(m_string.data(), (rapidjson::SizeType)(m_string.size() - 1), true);
+				break;
+			default:
+				break;
+		};
 	}
-	return true;
 }
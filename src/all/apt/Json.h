@@ -4,8 +4,13 @@
 #include <apt/FileSystem.h>
 #include <apt/Serializer.h>
 
+#include <EASTL/vector.h>
+
 namespace apt {
 
+class JsonPath;
+namespace internal { struct JsonPoolAllocator; }
+
 ////////////////////////////////////////////////////////////////////////////////
 // Json
 // Traversal of a loaded document is a state machine:
@@ -75,10 +80,15 @@ namespace apt {
 // - String ptrs passed as the _name argument for setValue() are assumed to have 
 //   a lifetime at least as long as the Json object. String ptrs passed as the 
 //   _value argument are copied internally.
+// - DOM memory is allocated in chunks from a Json::Pool. Chunks released by a
+//   Json (via clear(), Read() or the destructor) are retained by the pool for
+//   reuse, hence parsing many documents with a shared pool (or a single Json
+//   and clear()) doesn't allocate once the pool is warm.
 ////////////////////////////////////////////////////////////////////////////////
 class Json
 {
 	friend class SerializerJson; 
+	friend class JsonReader;
 public:
 	enum ValueType_
 	{
@@ -93,20 +103,130 @@ public:
 	};
 	typedef int ValueType;
 
+	enum WriteFlags_
+	{
+		WriteFlags_Compact          = 0,      // no whitespace
+		WriteFlags_Pretty           = 1 << 0, // newlines, tab indentation
+		WriteFlags_SingleLineArrays = 1 << 1, // with WriteFlags_Pretty, write arrays on a single line
+		WriteFlags_MessagePack      = 1 << 2, // binary encoding (other flags are ignored), see Read()
+
+		WriteFlags_Default          = WriteFlags_Pretty | WriteFlags_SingleLineArrays
+	};
+	typedef int WriteFlags;
+
+	static const uint kDefaultMemberIndexThreshold = 64;
+
+	// Memory for the DOM and parser stack. May be shared between Json instances on the same thread, must outlive them.
+	class Pool: private non_copyable<Pool>
+	{
+	public:
+		static const uint kDefaultChunkSize = 64 * 1024;
+
+		Pool(uint _chunkSizeBytes = kDefaultChunkSize);
+		~Pool();
+
+		uint getChunkSize() const { return m_chunkSize; }
+
+		// Total size of the retained (unused) memory.
+		uint getRetainedSize() const;
+
+		// Free retained memory.
+		void shrink();
+
+	private:
+		friend struct internal::JsonPoolAllocator;
+
+		uint                 m_chunkSize;
+		eastl::vector<void*> m_retained; // unused blocks, see JsonPoolAllocator
+
+		void* acquire(uint _sizeBytes);
+		void  release(void* _block);
+	};
+
+	// Text or MessagePack encoding is detected from the first byte (a MessagePack document begins with a map). Strings
+	// beginning with '\0' are reserved for raw binary (see SerializerJson::setBinaryRaw()), reading fails if _file
+	// contains one.
 	static bool Read(Json& json_, const File& _file);
 	static bool Read(Json& json_, const char* _path, int _root = FileSystem::GetDefaultRoot());
-	static bool Write(const Json& _json, File& file_);
-	static bool Write(const Json& _json, const char* _path, int _root = FileSystem::GetDefaultRoot());
+	// Parse in place; json_ takes ownership of file_'s data and strings in the DOM point into it rather than being copied.
+	// file_ is left empty. Mapped data is copied first (mapped data is read-only), otherwise the data must be null
+	// terminated (see File::Read()).
+	static bool ReadInsitu(Json& json_, File& file_);
+	static bool ReadInsitu(Json& json_, const char* _path, int _root = FileSystem::GetDefaultRoot());
+	// If file_ was opened via File::OpenWrite() the output is streamed to the file via a fixed size buffer, else file_'s
+	// data is replaced.
+	static bool Write(const Json& _json, File& file_, WriteFlags _flags = WriteFlags_Default);
+	// Stream directly to _path, the document isn't copied.
+	static bool Write(const Json& _json, const char* _path, int _root = FileSystem::GetDefaultRoot(), WriteFlags _flags = WriteFlags_Default);
+
+	// Asynchronous read: the file is read and parsed on a worker thread. _json_ is nullptr if the read failed, else the
+	// callback takes ownership of _json_ (release via APT_DELETE). _error describes the failure (errors aren't logged
+	// via the application's log callback, which is per thread), else nullptr.
+	typedef void (ReadAsyncCallback)(const char* _path, Json* _json_, const char* _error, void* _userData);
+	typedef uint32 ReadAsyncId; // 0 is invalid
+
+	// Read _path on a worker thread. If _defer is true _callback is called by DispatchReadAsync(), else it is called
+	// on the worker thread.
+	static ReadAsyncId ReadAsync(const char* _path, ReadAsyncCallback* _callback, void* _userData = nullptr, int _root = FileSystem::GetDefaultRoot(), bool _defer = true);
+	// Cancel a read, the callback won't be called. Return false if the callback was already called (or is executing).
+	static bool        CancelReadAsync(ReadAsyncId _id);
+	// Call the callbacks for completed reads on the calling thread, return the number of callbacks called. This should
+	// be called frequently.
+	static int         DispatchReadAsync();
+	// Block until all reads have completed, then dispatch.
+	static int         WaitReadAsync();
+
+	// Set patch_ to the operations which transform _from into _to, return the number of operations. The operations are
+	// stored in a 'patch' array as per RFC 6902, e.g. { "patch": [ { "op": "replace", "path": "/a/0", "value": 1 } ] }.
+	// Only "add", "remove" and "replace" are generated. Subtrees are compared via a hash, identical subtrees aren't
+	// traversed. Array elements are compared by index.
+	static int         Diff(const Json& _from, const Json& _to, Json& patch_);
+	// Apply a patch created by Diff() to json_, return false if an operation failed (previous operations are applied).
+	// The traversal state of json_ is reset.
+	static bool        ApplyPatch(Json& json_, const Json& _patch);
 		
 	// Read from _path if specified.
 	Json(const char* _path = nullptr, int _root = FileSystem::GetDefaultRoot());
+	// Allocate from _pool_ rather than an internal pool.
+	Json(Pool& _pool_, const char* _path = nullptr, int _root = FileSystem::GetDefaultRoot());
 	~Json();
 
+	// Reset to an empty document. Memory is retained by the pool.
+	void        clear();
+
+	// Objects with at least _minMemberCount members are indexed by name hash on the first call to find(), subsequent
+	// lookups by name are O(1). 0 disables indexing.
+	void        setMemberIndexThreshold(uint _minMemberCount);
+
  // Traversal
 
 	// Go to a named value in the current object, return false if not found.
 	bool        find(const char* _name);
 	
+	// Go to the _match-th value matching _path, relative to the current object/array, return false if not found. The
+	// containers along the path are entered (as if by enterObject()/enterArray()), call leave*() or reset() to return.
+	// Use findNext() to iterate over all matches.
+	bool        find(const JsonPath& _path, int _match = 0);
+
+	// Position of an iteration over the values matching a JsonPath, see findNext().
+	class PathIterator
+	{
+		friend class Json;
+		eastl::vector<int> m_positions;  // per segment, index of the current match in its container (-1 = none)
+		int                m_depth = -1; // container stack depth when the iteration began
+	public:
+		void reset() { m_positions.clear(); m_depth = -1; }
+	};
+
+	// Go to the next value matching _path, relative to the current object/array when _it_ was reset. The containers
+	// along the path are entered as per find(), the traversal state between calls must be restored to the same depth.
+	// Return false when there are no more matches, in which case the traversal state is at the start of the container
+	// and _it_ is reset. Iterating over all matches walks the DOM once.
+	//
+	//  Json::PathIterator it;
+	//  while (json.findNext(kPath, it)) { json.getValue<float>(); }
+	bool        findNext(const JsonPath& _path, PathIterator& _it_);
+
 	// Go to the next value in the current object/array, return true if not the end of the object/array.
 	bool        next();
 
@@ -146,6 +266,22 @@ public:
 	// Get a named value. Equivalent to find(_name) followed by getValue(-1).
 	template <typename tType>
 	tType       getValue(const char* _name) { APT_VERIFY(find(_name)); return getValue<tType>(-1); }
+
+	// Copy up to _maxCount values matching _path (relative to the current object/array) into out_, return the number of
+	// matches. Matches of the wrong type are skipped with an error. The traversal state is unchanged. tType may be bool,
+	// const char* or a number type.
+	template <typename tType>
+	int         getValues(const JsonPath& _path, tType* out_, int _maxCount) const;
+
+	// Copy up to _maxCount elements of the current array (call after find() or next()) into out_, return the number of
+	// elements copied or -1 if the current value isn't an array or an element has the wrong type. Elements are converted
+	// as per getValue<tType>(). tType may be bool or a number type.
+	template <typename tType>
+	int         getArray(tType* out_, int _maxCount) const;
+
+	// Get a named array. Equivalent to find(_name) followed by getArray().
+	template <typename tType>
+	int         getArray(const char* _name, tType* out_, int _maxCount) { return find(_name) ? getArray<tType>(out_, _maxCount) : -1; }
 		
 
  // Modification
@@ -158,6 +294,14 @@ public:
 	template <typename tType>
 	void       setValue(tType _value, const char* _name);
 
+	// Set the current value, or the _ith element of the current array if _i >= 0, to an array of _count elements.
+	template <typename tType>
+	void       setArray(const tType* _data, int _count, int _i = -1);
+
+	// Set a named array. If the value already exists this modifies the type and value.
+	template <typename tType>
+	void       setArray(const tType* _data, int _count, const char* _name);
+
 	// Push _value into the current array.
 	template <typename tType>
 	void       pushValue(tType _value);
@@ -185,16 +329,94 @@ private:
 
 };
 
+////////////////////////////////////////////////////////////////////////////////
+// JsonPath
+// Query compiled from a string, e.g. "scene.nodes[*].transform". Segments are
+// member names (pre-hashed, see Json::setMemberIndexThreshold()) separated by
+// '.', array indices "[n]", or wildcards ("*" for all members of an object,
+// "[*]" for all elements of an array):
+//
+//  static const JsonPath kScale("scene.nodes[*].scale"); // compile once
+//  float scales[64];
+//  int n = json.getValues(kScale, scales, 64);
+//
+// Member names may not contain '.' or '['.
+////////////////////////////////////////////////////////////////////////////////
+class JsonPath
+{
+public:
+	JsonPath(const char* _path);
+
+	// Return false if the path string was invalid (a path with no segments matches nothing).
+	bool        isValid() const         { return m_isValid; }
+	int         getSegmentCount() const { return (int)m_segments.size(); }
+
+private:
+	friend class Json;
+
+	enum SegmentType_
+	{
+		SegmentType_Member,
+		SegmentType_Index,
+		SegmentType_AnyMember,
+		SegmentType_AnyElement,
+
+		SegmentType_Count
+	};
+	typedef int SegmentType;
+
+	struct Segment
+	{
+		SegmentType m_type;
+		uint32      m_hash;   // SegmentType_Member
+		uint32      m_name;   // SegmentType_Member, offset into m_names
+		uint32      m_nameLength;
+		int         m_index;  // SegmentType_Index
+	};
+
+	eastl::vector<Segment> m_segments;
+	eastl::vector<char>    m_names;   // null-terminated member names
+	bool                   m_isValid;
+
+	const char* getName(const Segment& _segment) const { return m_names.data() + _segment.m_name; }
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 // SerializerJson
+// Serializes to/from a Json DOM, or streams directly to a File without building
+// a DOM (Mode_Write only):
+//
+//  File f;
+//  FileSystem::OpenWrite(f, "json.json");
+//  SerializerJson ser(f);   // if f isn't open the output is appended to f's data
+//  Serialize(ser, ...);
+//  ser.flush();             // close the root object, write any buffered output
+//
+// In streaming mode values are written in order; writing the same name twice
+// produces a duplicate member (in DOM mode the existing value is modified).
+// The output is identical to Json::Write().
 ////////////////////////////////////////////////////////////////////////////////
-class SerializerJson: public Serializer
+class SerializerJson final: public Serializer, private non_copyable<SerializerJson>
 {
 public:
 	SerializerJson(Json& _json_, Mode _mode);
+	SerializerJson(File& file_);
+	~SerializerJson();
 
+	// Streaming mode: close the root object and write buffered output to the file. Called by the destructor if not called
+	// explicitly, no further values may be written. Return false if an error occurred, including if a value couldn't be
+	// written (e.g. NaN/Inf), in which case the output is incomplete.
+	bool        flush();
+
+	// Return nullptr in streaming mode.
 	Json*       getJson() { return m_json; }
 
+	// If enabled, binary() stores raw bytes in the DOM rather than base64 (ignored in streaming mode). Raw binary is
+	// written as MessagePack bin by Json::Write() with WriteFlags_MessagePack, and converted to base64 for text output.
+	// binary() reads either form; getValue<const char*>() returns "" for raw binary.
+	bool        getBinaryRaw() const           { return m_binaryRaw; }
+	void        setBinaryRaw(bool _binaryRaw)  { m_binaryRaw = _binaryRaw; }
+
 	bool        beginObject(const char* _name = nullptr) override;
 	void        endObject() override;
 
@@ -216,15 +438,167 @@ public:
 	bool        value(float32&    _value_, const char* _name = nullptr) override;
 	bool        value(float64&    _value_, const char* _name = nullptr) override;
 	bool        value(StringBase& _value_, const char* _name = nullptr) override;
+
+	using Serializer::valueArray;
+	bool        valueArray(bool*    _data_, uint _count, const char* _name = nullptr) override;
+	bool        valueArray(sint8*   _data_, uint _count, const char* _name = nullptr) override;
+	bool        valueArray(uint8*   _data_, uint _count, const char* _name = nullptr) override;
+	bool        valueArray(sint16*  _data_, uint _count, const char* _name = nullptr) override;
+	bool        valueArray(uint16*  _data_, uint _count, const char* _name = nullptr) override;
+	bool        valueArray(sint32*  _data_, uint _count, const char* _name = nullptr) override;
+	bool        valueArray(uint32*  _data_, uint _count, const char* _name = nullptr) override;
+	bool        valueArray(sint64*  _data_, uint _count, const char* _name = nullptr) override;
+	bool        valueArray(uint64*  _data_, uint _count, const char* _name = nullptr) override;
+	bool        valueArray(float32* _data_, uint _count, const char* _name = nullptr) override;
+	bool        valueArray(float64* _data_, uint _count, const char* _name = nullptr) override;
 	
 	bool        binary(void*& _data_, uint& _sizeBytes_, const char* _name = nullptr, CompressionFlags _compressionFlags = CompressionFlags_None) override;
 
 private:
-	Json* m_json;
+	struct Stream;
+	Json*   m_json;
+	Stream* m_stream;
+	bool    m_binaryRaw;
 
-	void onModeChange(Mode _mode) override { m_json->reset(); }
+	void onModeChange(Mode _mode) override;
+
+	template <typename tType>
+	bool valueArrayImpl(tType* _data_, uint _count, const char* _name);
 
 }; // class SerializerJson
 
+////////////////////////////////////////////////////////////////////////////////
+// JsonReader
+// Pull parser, reads a document as a sequence of tokens without building a DOM.
+// Data is read in chunks from a File opened via File::OpenRead(), hence memory
+// use is constant regardless of the file size:
+//
+//  File f;
+//  FileSystem::OpenRead(f, "big.json");
+//  JsonReader reader(f);
+//  if (reader.next() == JsonReader::Token_BeginObject) {    // root
+//     if (reader.find("records") && reader.getToken() == JsonReader::Token_BeginArray) {
+//        while (reader.next() == JsonReader::Token_BeginObject) {
+//           Json record;
+//           reader.read(record);                                  // subtree to a DOM, use SerializerJson etc.
+//        }
+//     }
+//  }
+//
+// skip() jumps over an object/array without tokenizing its contents, find()
+// moves forward to a named member of the current object. Comments and trailing
+// commas are accepted, as per Json::Read().
+////////////////////////////////////////////////////////////////////////////////
+class JsonReader: private non_copyable<JsonReader>
+{
+public:
+	enum Token_
+	{
+		Token_End,          // end of the document
+		Token_Error,        // see getError()
+		Token_BeginObject,
+		Token_EndObject,
+		Token_BeginArray,
+		Token_EndArray,
+		Token_Null,
+		Token_Bool,
+		Token_Number,
+		Token_String,
+
+		Token_Count
+	};
+	typedef int Token;
+
+	static const uint kDefaultBufferSize = 64 * 1024;
+
+	// Read from _file_ in chunks of _bufferSizeBytes if it was opened via File::OpenRead(), else read from its data
+	// (e.g. a mapped file). _file_ must outlive the reader.
+	JsonReader(File& _file_, uint _bufferSizeBytes = kDefaultBufferSize);
+	// Read from _data (not copied).
+	JsonReader(const char* _data, uint64 _sizeBytes);
+	~JsonReader();
+
+	// Advance to the next token.
+	Token       next();
+	Token       getToken() const                                     { return m_token; }
+
+	// If the current token is Token_BeginObject/Token_BeginArray, advance to the matching end token without tokenizing the
+	// contents. The contents aren't fully validated.
+	bool        skip();
+
+	// Advance to the member _name of the current object, skipping other members. Return false if the end of the object is
+	// reached, in which case the current token is Token_EndObject.
+	bool        find(const char* _name);
+
+	// If the current token is Token_BeginObject, read the object into json_ and advance to the matching Token_EndObject.
+	// As per Json::Read(), strings beginning with '\0' are an error.
+	bool        read(Json& json_);
+
+	// Name of the current value, or "" if the value is an array element (or an end token).
+	const char* getName() const                                      { return m_name.data(); }
+	// Depth of the current value (0 = root).
+	int         getDepth() const                                     { return (int)m_stack.size() - (m_token == Token_BeginObject || m_token == Token_BeginArray ? 1 : 0); }
+	// Byte offset of the next unread character.
+	uint64      getOffset() const                                    { return m_offset + (uint64)(m_cur - m_beg); }
+
+	// Get the current value. tType must match the token (bool for Token_Bool, const char* for Token_String, a number type
+	// for Token_Number). Ptrs returned by getValue<const char*>() are valid until the next call to next().
+	template <typename tType>
+	tType       getValue() const;
+	uint        getStringLength() const                              { return (uint)m_string.size() - 1; }
+
+	const char* getError() const                                     { return m_error.isEmpty() ? nullptr : (const char*)m_error; }
+
+private:
+	struct Container
+	{
+		bool m_isArray;
+		bool m_isFirst;  // no elements read yet
+	};
+
+	File*                    m_file;    // nullptr if reading from memory
+	char*                    m_buffer;  // owned if m_file != nullptr
+	uint                     m_bufferSize;
+	const char*              m_beg;     // current chunk
+	const char*              m_cur;
+	const char*              m_end;
+	uint64                   m_offset;  // offset of m_beg in the stream
+	Token                    m_token;
+	bool                     m_isDone;  // root value was read
+	eastl::vector<Container> m_stack;
+	eastl::vector<char>      m_name;
+	eastl::vector<char>      m_string;
+	bool                     m_bool;
+	bool                     m_isInteger;
+	bool                     m_isNegative;
+	sint64                   m_sint;
+	uint64                   m_uint;
+	float64                  m_float;
+	String<64>               m_error;
+
+	// Return the next character without consuming it, or -1 at the end of the data.
+	int   peek()                                                     { return (m_cur < m_end || refill()) ? (uint8)*m_cur : -1; }
+	int   take()                                                     { return (m_cur < m_end || refill()) ? (uint8)*m_cur++ : -1; }
+	bool  refill();
+
+	Token setError(const char* _msg, ...);
+	bool  skipWhitespace(); // also skips comments, return false on error
+	bool  skipComment();    // call after the leading '/'
+	Token readValue();
+	bool  readString(eastl::vector<char>& out_);
+	bool  stringError(eastl::vector<char>& out_, const char* _msg); // setError(), out_ remains null terminated
+	bool  readNumber();
+	bool  readLiteral(const char* _str);
+	bool  skipString();
+
+	template <typename tType>
+	tType getNumber() const;
+
+	// Send SAX events for the current object to _handler_ (e.g. a rapidjson document).
+	template <typename tHandler>
+	bool  populate(tHandler& _handler_);
+
+}; // class JsonReader
+
 
 } // namespace apt
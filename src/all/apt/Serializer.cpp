@@ -1,8 +1,11 @@
 #include <apt/Serializer.h>
 
+#include <apt/hash.h>
 #include <apt/log.h>
+#include <apt/memory.h>
 
 #include <cstdarg>
+#include <cstring>
 
 using namespace apt;
 
@@ -21,31 +24,23 @@ void Serializer::setError(const char* _msg, ...)
 }
 
 template <typename tType, uint kLen>
-static bool ValueVecMatImpl(Serializer& _serializer_, tType& _value_, const char* _name)
-{
-	uint len = kLen; \
-	if (_serializer_.beginArray(len, _name)) { \
-		bool ret = true;
-		if (len != kLen) {
-			_serializer_.setError("Error serializing %s '%s': array length was %d, expected %d", Serializer::ValueTypeToStr<tType>(), _name ? _name : "", (int)len, (int)kLen);
-			ret = false;
-		} else {
-			float* v = (float*)&_value_; // access vec/mat as a flat array
-			for (int i = 0; i < (int)kLen; ++i) { 
-				ret &= _serializer_.value(v[i]);
-			}
-		}
-		_serializer_.endArray();
-		return ret;
-	}
-	return false;
+static bool ValueVecMatImpl(Serializer& _serializer_, tType* _data_, uint _count, const char* _name)
+{
+	return _serializer_.valueArray((float32*)_data_, _count * kLen, _name); // access vec/mat as a flat array
 }
-bool Serializer::value(vec2& _value_, const char* _name) { return ValueVecMatImpl<vec2,   2>(*this, _value_, _name); }
-bool Serializer::value(vec3& _value_, const char* _name) { return ValueVecMatImpl<vec3,   3>(*this, _value_, _name); }
-bool Serializer::value(vec4& _value_, const char* _name) { return ValueVecMatImpl<vec4,   4>(*this, _value_, _name); }
-bool Serializer::value(mat2& _value_, const char* _name) { return ValueVecMatImpl<mat2, 2*2>(*this, _value_, _name); }
-bool Serializer::value(mat3& _value_, const char* _name) { return ValueVecMatImpl<mat3, 3*3>(*this, _value_, _name); }
-bool Serializer::value(mat4& _value_, const char* _name) { return ValueVecMatImpl<mat4, 4*4>(*this, _value_, _name); }
+bool Serializer::value(vec2& _value_, const char* _name) { return ValueVecMatImpl<vec2,   2>(*this, &_value_, 1, _name); }
+bool Serializer::value(vec3& _value_, const char* _name) { return ValueVecMatImpl<vec3,   3>(*this, &_value_, 1, _name); }
+bool Serializer::value(vec4& _value_, const char* _name) { return ValueVecMatImpl<vec4,   4>(*this, &_value_, 1, _name); }
+bool Serializer::value(mat2& _value_, const char* _name) { return ValueVecMatImpl<mat2, 2*2>(*this, &_value_, 1, _name); }
+bool Serializer::value(mat3& _value_, const char* _name) { return ValueVecMatImpl<mat3, 3*3>(*this, &_value_, 1, _name); }
+bool Serializer::value(mat4& _value_, const char* _name) { return ValueVecMatImpl<mat4, 4*4>(*this, &_value_, 1, _name); }
+
+bool Serializer::valueArray(vec2* _data_, uint _count, const char* _name) { return ValueVecMatImpl<vec2,   2>(*this, _data_, _count, _name); }
+bool Serializer::valueArray(vec3* _data_, uint _count, const char* _name) { return ValueVecMatImpl<vec3,   3>(*this, _data_, _count, _name); }
+bool Serializer::valueArray(vec4* _data_, uint _count, const char* _name) { return ValueVecMatImpl<vec4,   4>(*this, _data_, _count, _name); }
+bool Serializer::valueArray(mat2* _data_, uint _count, const char* _name) { return ValueVecMatImpl<mat2, 2*2>(*this, _data_, _count, _name); }
+bool Serializer::valueArray(mat3* _data_, uint _count, const char* _name) { return ValueVecMatImpl<mat3, 3*3>(*this, _data_, _count, _name); }
+bool Serializer::valueArray(mat4* _data_, uint _count, const char* _name) { return ValueVecMatImpl<mat4, 4*4>(*this, _data_, _count, _name); }
 
 // PROTECTED
 
@@ -76,16 +71,18 @@ const char* Serializer::ValueTypeToStr()
 
 //---
 
+bool apt::internal::SerializeError(Serializer& _serializer_)
+{
+	if (_serializer_.getError()) {
+		APT_LOG_ERR(_serializer_.getError());
+	}
+	return false;
+}
+
 template <typename T>
 static bool SerializeImpl(Serializer& _serializer_, T& _value_, const char* _name)
 {
-	if (!_serializer_.value(_value_, _name)) {
-		if (_serializer_.getError()) {
-			APT_LOG_ERR(_serializer_.getError());
-		}
-		return false;
-	}
-	return true;
+	return _serializer_.value(_value_, _name) || internal::SerializeError(_serializer_);
 }
 bool apt::Serialize(Serializer& _serializer_, bool&       _value_, const char* _name) { return SerializeImpl(_serializer_, _value_, _name); }
 bool apt::Serialize(Serializer& _serializer_, sint8&      _value_, const char* _name) { return SerializeImpl(_serializer_, _value_, _name); }
@@ -104,4 +101,1049 @@ bool apt::Serialize(Serializer& _serializer_, vec3&       _value_, const char* _
 bool apt::Serialize(Serializer& _serializer_, vec4&       _value_, const char* _name) { return SerializeImpl(_serializer_, _value_, _name); }
 bool apt::Serialize(Serializer& _serializer_, mat2&       _value_, const char* _name) { return SerializeImpl(_serializer_, _value_, _name); }
 bool apt::Serialize(Serializer& _serializer_, mat3&       _value_, const char* _name) { return SerializeImpl(_serializer_, _value_, _name); }
-bool apt::Serialize(Serializer& _serializer_, mat4&       _value_, const char* _name) { return SerializeImpl(_serializer_, _value_, _name); }
\ No newline at end of file
+bool apt::Serialize(Serializer& _serializer_, mat4&       _value_, const char* _name) { return SerializeImpl(_serializer_, _value_, _name); }
+
+
+/*******************************************************************************
+
+                              SerializerBinary
+
+*******************************************************************************/
+
+namespace {
+
+enum BinaryTag_
+{
+	BinaryTag_Bool,
+	BinaryTag_Sint8,
+	BinaryTag_Uint8,
+	BinaryTag_Sint16,
+	BinaryTag_Uint16,
+	BinaryTag_Sint32,
+	BinaryTag_Uint32,
+	BinaryTag_Sint64,
+	BinaryTag_Uint64,
+	BinaryTag_Float32,
+	BinaryTag_Float64,
+	BinaryTag_String,      // uint32 length, chars (no null terminator)
+	BinaryTag_Binary,      // uint32 size, uint32 checksum, uint32 raw size, uint8 mode (0 = raw, 1 = compressed, 2 = compressed + checksum), uint8 padding, [padding], data
+	BinaryTag_Object,      // uint32 size, elements
+	BinaryTag_Array,       // uint32 size, uint32 count, elements
+	BinaryTag_TypedArray,  // uint32 count, uint8 element tag, uint8 padding, [padding], data
+	BinaryTag_TypedArrayPatch, // uint32 size, uint32 count, uint8 element tag, ranges (uint32 first, uint32 count, data)
+
+	BinaryTag_Count
+};
+
+const char  kBinaryMagic[4]             = { 'a', 'p', 't', 'S' };
+const char  kBinaryPatchMagic[4]        = { 'a', 'p', 't', 'P' };
+const uint  kBinaryHeaderSize           = 14;
+const uint  kBinaryTypedArrayHeaderSize = 6;
+const uint  kBinaryMaxCompressionRatio  = 1032; // deflate's limit, the LZ codec's is lower
+const uint8 kBinaryScalarSizes[]        = { 1, 1, 1, 2, 2, 4, 4, 8, 8, 4, 8 }; // BinaryTag_Bool..BinaryTag_Float64
+
+template <typename tType> struct BinaryTag {};
+	template <> struct BinaryTag<bool>    { enum { kValue = BinaryTag_Bool    }; };
+	template <> struct BinaryTag<sint8>   { enum { kValue = BinaryTag_Sint8   }; };
+	template <> struct BinaryTag<uint8>   { enum { kValue = BinaryTag_Uint8   }; };
+	template <> struct BinaryTag<sint16>  { enum { kValue = BinaryTag_Sint16  }; };
+	template <> struct BinaryTag<uint16>  { enum { kValue = BinaryTag_Uint16  }; };
+	template <> struct BinaryTag<sint32>  { enum { kValue = BinaryTag_Sint32  }; };
+	template <> struct BinaryTag<uint32>  { enum { kValue = BinaryTag_Uint32  }; };
+	template <> struct BinaryTag<sint64>  { enum { kValue = BinaryTag_Sint64  }; };
+	template <> struct BinaryTag<uint64>  { enum { kValue = BinaryTag_Uint64  }; };
+	template <> struct BinaryTag<float32> { enum { kValue = BinaryTag_Float32 }; };
+	template <> struct BinaryTag<float64> { enum { kValue = BinaryTag_Float64 }; };
+
+// Data may be unaligned.
+template <typename tType>
+inline tType BinaryLoad(const uint8* _src)
+{
+	tType ret;
+	memcpy(&ret, _src, sizeof(tType));
+	return ret;
+}
+template <typename tType>
+inline void BinaryStore(uint8* dst_, tType _value)
+{
+	memcpy(dst_, &_value, sizeof(tType));
+}
+
+// Load a numeric value with conversion. Return false if _tag isn't numeric.
+template <typename tType>
+bool BinaryLoadNumeric(uint8 _tag, const uint8* _data, tType& _value_)
+{
+	switch (_tag) {
+		case BinaryTag_Bool:    _value_ = (tType)(_data[0] != 0);                return true;
+		case BinaryTag_Sint8:   _value_ = (tType)BinaryLoad<sint8>  (_data);     return true;
+		case BinaryTag_Uint8:   _value_ = (tType)BinaryLoad<uint8>  (_data);     return true;
+		case BinaryTag_Sint16:  _value_ = (tType)BinaryLoad<sint16> (_data);     return true;
+		case BinaryTag_Uint16:  _value_ = (tType)BinaryLoad<uint16> (_data);     return true;
+		case BinaryTag_Sint32:  _value_ = (tType)BinaryLoad<sint32> (_data);     return true;
+		case BinaryTag_Uint32:  _value_ = (tType)BinaryLoad<uint32> (_data);     return true;
+		case BinaryTag_Sint64:  _value_ = (tType)BinaryLoad<sint64> (_data);     return true;
+		case BinaryTag_Uint64:  _value_ = (tType)BinaryLoad<uint64> (_data);     return true;
+		case BinaryTag_Float32: _value_ = (tType)BinaryLoad<float32>(_data);     return true;
+		case BinaryTag_Float64: _value_ = (tType)BinaryLoad<float64>(_data);     return true;
+		default:                                                                 return false;
+	};
+}
+
+// Parse the element at _p. Return a ptr to the end of the element, or nullptr if the element is invalid or overflows _end.
+const uint8* BinaryParseElement(const uint8* _p, const uint8* _end, bool _named, uint8& tag_, uint32& nameHash_, const uint8*& data_)
+{
+	uint headerSize = _named ? 1 + sizeof(uint32) : 1;
+	if ((uint)(_end - _p) < headerSize) {
+		return nullptr;
+	}
+	tag_ = _p[0];
+	nameHash_ = _named ? BinaryLoad<uint32>(_p + 1) : 0;
+	data_ = _p + headerSize;
+
+	uint64 avail = (uint64)(_end - data_);
+	uint64 dataSize = 0;
+	switch (tag_) {
+		case BinaryTag_String:
+		case BinaryTag_Object:
+			if (avail < sizeof(uint32)) {
+				return nullptr;
+			}
+			dataSize = sizeof(uint32) + BinaryLoad<uint32>(data_);
+			break;
+		case BinaryTag_Array:
+			if (avail < sizeof(uint32) * 2 || BinaryLoad<uint32>(data_) < sizeof(uint32)) {
+				return nullptr;
+			}
+			dataSize = sizeof(uint32) + BinaryLoad<uint32>(data_);
+			break;
+		case BinaryTag_Binary:
+			if (avail < kBinaryHeaderSize) {
+				return nullptr;
+			}
+			dataSize = kBinaryHeaderSize + data_[kBinaryHeaderSize - 1] + (uint64)BinaryLoad<uint32>(data_);
+			break;
+		case BinaryTag_TypedArray:
+			if (avail < kBinaryTypedArrayHeaderSize || data_[4] >= APT_ARRAY_COUNT(kBinaryScalarSizes)) {
+				return nullptr;
+			}
+			dataSize = kBinaryTypedArrayHeaderSize + data_[kBinaryTypedArrayHeaderSize - 1] + (uint64)BinaryLoad<uint32>(data_) * kBinaryScalarSizes[data_[4]];
+			break;
+		case BinaryTag_TypedArrayPatch:
+			if (avail < sizeof(uint32) * 2 + 1 || BinaryLoad<uint32>(data_) < sizeof(uint32) + 1 || data_[8] >= APT_ARRAY_COUNT(kBinaryScalarSizes)) {
+				return nullptr;
+			}
+			dataSize = sizeof(uint32) + BinaryLoad<uint32>(data_);
+			break;
+		default:
+			if (tag_ >= APT_ARRAY_COUNT(kBinaryScalarSizes)) {
+				return nullptr;
+			}
+			dataSize = kBinaryScalarSizes[tag_];
+			break;
+	};
+	return dataSize <= avail ? data_ + dataSize : nullptr;
+}
+
+// Append the payload of the elements in [_beg, _end) to hash_. Alignment padding (which depends on the offset in the
+// buffer) and container sizes (which include the padding) are skipped, hence the hash doesn't change if the elements
+// move. Return false if the elements are invalid.
+bool BinaryHashElements(const uint8* _beg, const uint8* _end, bool _named, HashState& hash_)
+{
+	for (const uint8* p = _beg; p < _end; ) {
+		uint8 tag;
+		uint32 nameHash;
+		const uint8* data;
+		const uint8* next = BinaryParseElement(p, _end, _named, tag, nameHash, data);
+		if (!next) {
+			return false;
+		}
+		hash_.update(p, (uint)(data - p)); // tag, name hash
+		switch (tag) {
+			case BinaryTag_Binary:
+			case BinaryTag_TypedArray: {
+				uint headerSize = tag == BinaryTag_Binary ? kBinaryHeaderSize : kBinaryTypedArrayHeaderSize;
+				const uint8* payload = data + headerSize + data[headerSize - 1];
+				hash_.update(data, headerSize - 1);
+				hash_.update(payload, (uint)(next - payload));
+				break;
+			}
+			case BinaryTag_Object:
+				if (!BinaryHashElements(data + sizeof(uint32), next, true, hash_)) {
+					return false;
+				}
+				break;
+			case BinaryTag_Array:
+				hash_.update(data + sizeof(uint32), sizeof(uint32)); // count
+				if (!BinaryHashElements(data + sizeof(uint32) * 2, next, false, hash_)) {
+					return false;
+				}
+				break;
+			default:
+				hash_.update(data, (uint)(next - data));
+				break;
+		};
+		p = next;
+	}
+	return true;
+}
+
+// Call _func(first, count, src) for each range in a BinaryTag_TypedArrayPatch element. Return false if the ranges are invalid.
+template <typename tFunc>
+bool BinaryForEachRange(const uint8* _data, tFunc _func)
+{
+	uint64 count = BinaryLoad<uint32>(_data + 4);
+	uint64 stride = kBinaryScalarSizes[_data[8]];
+	const uint8* p = _data + sizeof(uint32) * 2 + 1;
+	const uint8* end = _data + sizeof(uint32) + BinaryLoad<uint32>(_data);
+	while (p < end) {
+		if ((uint)(end - p) < sizeof(uint32) * 2) {
+			return false;
+		}
+		uint32 first = BinaryLoad<uint32>(p);
+		uint32 n = BinaryLoad<uint32>(p + 4);
+		p += sizeof(uint32) * 2;
+		if ((uint64)first + n > count || n * stride > (uint64)(end - p)) {
+			return false;
+		}
+		_func((uint)first, (uint)n, p);
+		p += n * stride;
+	}
+	return true;
+}
+
+} // namespace
+
+// PUBLIC
+
+SerializerBinary::SerializerBinary(Mode _mode)
+	: Serializer(_mode)
+	, m_data(nullptr)
+	, m_dataSize(0)
+	, m_snapshot(nullptr)
+	, m_isPatch(false)
+	, m_isAbsent(false)
+{
+	onModeChange(_mode);
+}
+
+bool SerializerBinary::setData(const void* _data, uint _sizeBytes)
+{
+	APT_ASSERT(getMode() == Mode_Read);
+	m_data = nullptr;
+	m_dataSize = 0;
+	bool ret = _data && _sizeBytes >= sizeof(kBinaryMagic) && (memcmp(_data, kBinaryMagic, sizeof(kBinaryMagic)) == 0 || memcmp(_data, kBinaryPatchMagic, sizeof(kBinaryPatchMagic)) == 0);
+	if (ret) {
+		m_data = (const uint8*)_data;
+		m_dataSize = _sizeBytes;
+	} else {
+		setError("Error reading binary data: invalid header");
+	}
+	onModeChange(Mode_Read);
+	return ret;
+}
+
+bool SerializerBinary::applyPatch(const void* _base, uint _baseSizeBytes, const void* _patch, uint _patchSizeBytes)
+{
+	APT_ASSERT(getMode() == Mode_Write);
+	APT_ASSERT(_base != getData() && _patch != getData()); // inputs must not alias the internal buffer
+	bool ret = !_base || (_baseSizeBytes >= sizeof(kBinaryMagic) && memcmp(_base, kBinaryMagic, sizeof(kBinaryMagic)) == 0);
+	ret &= _patch && _patchSizeBytes >= sizeof(kBinaryPatchMagic) && memcmp(_patch, kBinaryPatchMagic, sizeof(kBinaryPatchMagic)) == 0;
+	if (!ret) {
+		setError("Error applying patch: invalid header");
+		return false;
+	}
+	m_buffer.clear();
+	memcpy(writeData(sizeof(kBinaryMagic)), kBinaryMagic, sizeof(kBinaryMagic));
+	const uint8* base = (const uint8*)_base;
+	const uint8* patch = (const uint8*)_patch;
+	ret = patchMerge(
+		base ? base + sizeof(kBinaryMagic) : nullptr,
+		base ? base + _baseSizeBytes : nullptr,
+		patch + sizeof(kBinaryPatchMagic),
+		patch + _patchSizeBytes
+		);
+	if (!ret) {
+		setError("Error applying patch: invalid data");
+		m_buffer.resize(sizeof(kBinaryMagic));
+	}
+	return ret;
+}
+
+bool SerializerBinary::beginObject(const char* _name)
+{
+	if (getMode() == Mode_Read) {
+		uint8 tag;
+		const uint8* data = readElement(_name, "object", tag);
+		if (!data) {
+			if (m_isAbsent) {
+			 // unchanged object, push an empty scope so that its members are also absent
+				m_scopes.push_back(Scope());
+				return true;
+			}
+			return false;
+		}
+		if (tag != BinaryTag_Object) {
+			setError("Error serializing object: '%s' not an object", (const char*)m_name);
+			return false;
+		}
+		Scope scope = {};
+		scope.m_beg = scope.m_cur = data + sizeof(uint32);
+		scope.m_end = scope.m_beg + BinaryLoad<uint32>(data);
+		m_scopes.push_back(scope);
+
+	} else {
+		Scope scope = {};
+		scope.m_elementOffset = getDataSize();
+		scope.m_isAtomic = m_scopes.back().m_isAtomic;
+		scope.m_path = isDelta() ? deltaPath(_name) : 0;
+		writeElement(BinaryTag_Object, _name);
+		scope.m_offset = getDataSize();
+		writeData(sizeof(uint32));
+		m_scopes.push_back(scope);
+	}
+	
+	return true;
+}
+void SerializerBinary::endObject()
+{
+	APT_ASSERT(m_scopes.size() > 1 && !m_scopes.back().m_isArray);
+	if (m_mode == Mode_Write) {
+		const Scope& scope = m_scopes.back();
+		uint size = getDataSize() - scope.m_offset - sizeof(uint32);
+		BinaryStore<uint32>(m_buffer.data() + scope.m_offset, (uint32)size);
+		if (isDelta()) {
+		 // omit the object if it's empty (all members were unchanged) and not new
+			bool isNew = m_snapshot->m_hashes.insert(eastl::make_pair(scope.m_path, (uint64)0)).second;
+			if (size == 0 && !isNew) {
+				m_buffer.resize(scope.m_elementOffset);
+			}
+		}
+	}
+	m_scopes.pop_back();
+}
+
+bool SerializerBinary::beginArray(uint& _length_, const char* _name)
+{
+	if (getMode() == Mode_Read) {
+		uint8 tag;
+		const uint8* data = readElement(_name, "array", tag);
+		if (!data) {
+			if (m_isAbsent) {
+			 // unchanged array, _length_ is left unmodified
+				Scope scope = {};
+				scope.m_isArray = true;
+				m_scopes.push_back(scope);
+				return true;
+			}
+			return false;
+		}
+		if (tag != BinaryTag_Array) {
+			setError("Error serializing array: '%s' not an array", (const char*)m_name);
+			return false;
+		}
+		Scope scope = {};
+		scope.m_beg = scope.m_cur = data + sizeof(uint32) * 2;
+		scope.m_end = data + sizeof(uint32) + BinaryLoad<uint32>(data);
+		scope.m_isArray = true;
+		m_scopes.push_back(scope);
+		_length_ = BinaryLoad<uint32>(data + sizeof(uint32));
+
+	} else {
+		Scope scope = {};
+		scope.m_elementOffset = getDataSize();
+		scope.m_path = isDelta() ? deltaPath(_name) : 0;
+		scope.m_isArray = true;
+		scope.m_isAtomic = true;
+		writeElement(BinaryTag_Array, _name);
+		scope.m_offset = getDataSize();
+		writeData(sizeof(uint32) * 2);
+		m_scopes.push_back(scope);
+	}
+
+	return true;
+}
+void SerializerBinary::endArray()
+{
+	APT_ASSERT(m_scopes.size() > 1 && m_scopes.back().m_isArray);
+	if (m_mode == Mode_Write) {
+		Scope scope = m_scopes.back();
+		uint8* dst = m_buffer.data() + scope.m_offset;
+		BinaryStore<uint32>(dst, (uint32)(getDataSize() - scope.m_offset - sizeof(uint32)));
+		BinaryStore<uint32>(dst + sizeof(uint32), scope.m_index);
+		m_scopes.pop_back();
+		if (isDelta()) {
+		 // arrays are written in full if any element changed
+			HashState hash;
+			APT_VERIFY(BinaryHashElements(m_buffer.data() + scope.m_elementOffset, m_buffer.data() + getDataSize(), !m_scopes.back().m_isArray, hash));
+			if (deltaUnchanged(scope.m_path, hash.get<uint64>())) {
+				m_buffer.resize(scope.m_elementOffset);
+			}
+		}
+		return;
+	}
+	m_scopes.pop_back();
+}
+
+const char* SerializerBinary::getName() const
+{
+	return (const char*)m_name;
+}
+
+uint32 SerializerBinary::getIndex() const
+{
+	uint32 index = m_scopes.back().m_index;
+	return index > 0 ? index - 1 : 0;
+}
+
+bool SerializerBinary::value(bool&    _value_, const char* _name) { return valueImpl<bool>   (_value_, _name); }
+bool SerializerBinary::value(sint8&   _value_, const char* _name) { return valueImpl<sint8>  (_value_, _name); }
+bool SerializerBinary::value(uint8&   _value_, const char* _name) { return valueImpl<uint8>  (_value_, _name); }
+bool SerializerBinary::value(sint16&  _value_, const char* _name) { return valueImpl<sint16> (_value_, _name); }
+bool SerializerBinary::value(uint16&  _value_, const char* _name) { return valueImpl<uint16> (_value_, _name); }
+bool SerializerBinary::value(sint32&  _value_, const char* _name) { return valueImpl<sint32> (_value_, _name); }
+bool SerializerBinary::value(uint32&  _value_, const char* _name) { return valueImpl<uint32> (_value_, _name); }
+bool SerializerBinary::value(sint64&  _value_, const char* _name) { return valueImpl<sint64> (_value_, _name); }
+bool SerializerBinary::value(uint64&  _value_, const char* _name) { return valueImpl<uint64> (_value_, _name); }
+bool SerializerBinary::value(float32& _value_, const char* _name) { return valueImpl<float32>(_value_, _name); }
+bool SerializerBinary::value(float64& _value_, const char* _name) { return valueImpl<float64>(_value_, _name); }
+
+bool SerializerBinary::value(StringBase& _value_, const char* _name)
+{
+	if (getMode() == Mode_Read) {
+		uint8 tag;
+		const uint8* data = readElement(_name, "StringBase", tag);
+		if (!data) {
+			return m_isAbsent;
+		}
+		if (tag != BinaryTag_String) {
+			setError("Error serializing StringBase; '%s' not a string", (const char*)m_name);
+			return false;
+		}
+		uint len = BinaryLoad<uint32>(data);
+		if (len > 0) {
+			_value_.set((const char*)data + sizeof(uint32), len);
+		} else {
+			_value_.clear();
+		}
+
+	} else {
+		uint len = _value_.getLength();
+		if (isDelta() && deltaUnchanged(deltaPath(_name), HashFast<uint64>((const char*)_value_, len, BinaryTag_String))) {
+			m_name.set(_name ? _name : "");
+			return true;
+		}
+		writeElement(BinaryTag_String, _name);
+		uint8* dst = writeData(sizeof(uint32) + len);
+		BinaryStore<uint32>(dst, (uint32)len);
+		memcpy(dst + sizeof(uint32), (const char*)_value_, len);
+	}
+	return true;
+}
+
+bool SerializerBinary::binary(void*& _data_, uint& _sizeBytes_, const char* _name, CompressionFlags _compressionFlags)
+{
+	if (getMode() == Mode_Write) {
+		APT_ASSERT(_data_);
+		if (isDelta() && deltaUnchanged(deltaPath(_name), HashFast<uint64>(_data_, _sizeBytes_, ((uint64)_compressionFlags << 8) | BinaryTag_Binary))) {
+			m_name.set(_name ? _name : "");
+			return true;
+		}
+		void* data = _data_;
+		uint sizeBytes = _sizeBytes_;
+		uint8 mode = 0;
+		uint32 crc = 0;
+		if (_compressionFlags != CompressionFlags_None) {
+			data = nullptr;
+			Compress(_data_, _sizeBytes_, data, sizeBytes, _compressionFlags, getBinaryDictionary());
+			mode = 1;
+			if (getBinaryChecksum()) {
+				mode = 2;
+				crc = Crc32c(_data_, _sizeBytes_);
+			}
+		}
+		writeElement(BinaryTag_Binary, _name);
+		uint8* dst;
+		uint8* header = writeAligned(kBinaryHeaderSize, sizeBytes, dst);
+		BinaryStore<uint32>(header, (uint32)sizeBytes);
+		BinaryStore<uint32>(header + 4, crc);
+		BinaryStore<uint32>(header + 8, (uint32)_sizeBytes_);
+		header[12] = mode;
+		memcpy(dst, data, sizeBytes);
+		if (data != _data_) {
+			free(data);
+		}
+
+	} else {
+		uint8 tag;
+		const uint8* data = readElement(_name, "binary", tag);
+		if (!data) {
+			return m_isAbsent;
+		}
+		if (tag != BinaryTag_Binary) {
+			setError("Error serializing binary '%s', not binary data", (const char*)m_name);
+			return false;
+		}
+		uint sizeBytes = BinaryLoad<uint32>(data);
+		uint32 crc = BinaryLoad<uint32>(data + 4);
+		uint rawSizeBytes = BinaryLoad<uint32>(data + 8);
+		uint8 mode = data[12];
+		const uint8* bin = data + kBinaryHeaderSize + data[kBinaryHeaderSize - 1];
+		if (mode > 2 || (mode == 0 && rawSizeBytes != sizeBytes) || (mode != 0 && (sizeBytes == 0 || (uint64)sizeBytes * kBinaryMaxCompressionRatio < rawSizeBytes))) {
+			setError("Error serializing binary '%s', invalid header", (const char*)m_name);
+			return false;
+		}
+
+		void* ret = _data_;
+		uint retSizeBytes = sizeBytes;
+		if (mode == 0) {
+			if (_data_) {
+				if (sizeBytes != _sizeBytes_) {
+					setError("Error serializing binary '%s', buffer size was %u (expected %u)", (const char*)m_name, _sizeBytes_, sizeBytes);
+					return false;
+				}
+			} else {
+				ret = APT_MALLOC(sizeBytes ? sizeBytes : 1);
+			}
+			memcpy(ret, bin, sizeBytes);
+
+		} else if (_data_) {
+		 // decompress directly to the caller's buffer
+			if (!Decompress(bin, sizeBytes, _data_, _sizeBytes_, retSizeBytes) || retSizeBytes != _sizeBytes_) {
+				setError("Error serializing binary '%s', decompression failed (buffer size was %u)", (const char*)m_name, _sizeBytes_);
+				return false;
+			}
+
+		} else {
+			ret = APT_MALLOC(rawSizeBytes ? rawSizeBytes : 1);
+			if (!Decompress(bin, sizeBytes, ret, rawSizeBytes, retSizeBytes) || retSizeBytes != rawSizeBytes) {
+				setError("Error serializing binary '%s', decompression failed", (const char*)m_name);
+				APT_FREE(ret);
+				return false;
+			}
+		}
+
+		if (mode == 2 && Crc32c(ret, retSizeBytes) != crc) {
+			setError("Error serializing binary '%s', checksum mismatch", (const char*)m_name);
+			if (ret != _data_) {
+				APT_FREE(ret);
+			}
+			return false;
+		}
+		_data_ = ret;
+		_sizeBytes_ = retSizeBytes;
+	}
+	return true;
+}
+
+#define SerializerBinary_ValueArray(_type) \
+	bool SerializerBinary::valueArray(_type* _data_, uint _count, const char* _name) { return valueArrayImpl<_type>(_data_, _count, _name); } \
+	bool SerializerBinary::arrayView(const _type*& data_, uint& count_, const char* _name) { return arrayViewImpl<_type>(data_, count_, _name); }
+SerializerBinary_ValueArray(bool)
+SerializerBinary_ValueArray(sint8)
+SerializerBinary_ValueArray(uint8)
+SerializerBinary_ValueArray(sint16)
+SerializerBinary_ValueArray(uint16)
+SerializerBinary_ValueArray(sint32)
+SerializerBinary_ValueArray(uint32)
+SerializerBinary_ValueArray(sint64)
+SerializerBinary_ValueArray(uint64)
+SerializerBinary_ValueArray(float32)
+SerializerBinary_ValueArray(float64)
+#undef SerializerBinary_ValueArray
+
+bool SerializerBinary::binaryView(const void*& data_, uint& sizeBytes_, const char* _name)
+{
+	APT_ASSERT(getMode() == Mode_Read);
+	uint8 tag;
+	const uint8* data = readElement(_name, "binary", tag);
+	if (!data) {
+		return false;
+	}
+	if (tag != BinaryTag_Binary) {
+		setError("Error serializing binary '%s', not binary data", (const char*)m_name);
+		return false;
+	}
+	if (data[12] != 0) {
+		setError("Error serializing binary '%s', data is compressed", (const char*)m_name);
+		return false;
+	}
+	data_ = data + kBinaryHeaderSize + data[kBinaryHeaderSize - 1];
+	sizeBytes_ = BinaryLoad<uint32>(data);
+	return true;
+}
+
+bool SerializerBinary::stringView(const char*& str_, uint& length_, const char* _name)
+{
+	APT_ASSERT(getMode() == Mode_Read);
+	uint8 tag;
+	const uint8* data = readElement(_name, "StringBase", tag);
+	if (!data) {
+		return false;
+	}
+	if (tag != BinaryTag_String) {
+		setError("Error serializing StringBase; '%s' not a string", (const char*)m_name);
+		return false;
+	}
+	str_ = (const char*)data + sizeof(uint32);
+	length_ = BinaryLoad<uint32>(data);
+	return true;
+}
+
+// PRIVATE
+
+void SerializerBinary::onModeChange(Mode _mode)
+{
+	m_scopes.clear();
+	m_name.set("");
+	Scope root = {}; // root is an object
+	if (_mode == Mode_Write) {
+		m_buffer.clear();
+		memcpy(writeData(sizeof(kBinaryMagic)), m_snapshot ? kBinaryPatchMagic : kBinaryMagic, sizeof(kBinaryMagic));
+		m_data = nullptr;
+		m_dataSize = 0;
+		m_isPatch = false;
+	} else {
+		if (m_mode == Mode_Write) {
+		 // read back the internal buffer
+			m_data = m_buffer.data();
+			m_dataSize = m_buffer.size();
+		}
+		if (m_data) {
+			root.m_beg = root.m_cur = m_data + sizeof(kBinaryMagic);
+			root.m_end = m_data + m_dataSize;
+			m_isPatch = memcmp(m_data, kBinaryPatchMagic, sizeof(kBinaryPatchMagic)) == 0;
+		}
+	}
+	m_scopes.push_back(root);
+}
+
+const uint8* SerializerBinary::readElement(const char* _name, const char* _typeStr, uint8& tag_)
+{
+	Scope& scope = m_scopes.back();
+	bool named = !scope.m_isArray;
+	m_name.set(_name ? _name : "");
+	m_isAbsent = false;
+	uint32 nameHash;
+	const uint8* data;
+	const uint8* end;
+
+	if (m_isPatch && !scope.m_beg) {
+	 // inside an object/array which was missing from the patch
+		m_isAbsent = true;
+		return nullptr;
+	}
+
+	if (_name && named) {
+	 // usually elements are read in the order they were written, else search the whole object
+		uint32 hash = HashString<uint32>(_name);
+		end = BinaryParseElement(scope.m_cur, scope.m_end, true, tag_, nameHash, data);
+		if (end && nameHash == hash) {
+			++scope.m_index;
+		} else {
+			end = nullptr;
+			uint32 index = 0;
+			for (const uint8* p = scope.m_beg; p && p < scope.m_end; ++index) {
+				p = BinaryParseElement(p, scope.m_end, true, tag_, nameHash, data);
+				if (p && nameHash == hash) {
+					end = p;
+					scope.m_index = index + 1;
+					break;
+				}
+			}
+			if (!end) {
+				if (m_isPatch) {
+					m_isAbsent = true; // missing members of a patch are unchanged
+				} else {
+					setError("Error serializing %s: '%s' not found", _typeStr, _name);
+				}
+				return nullptr;
+			}
+		}
+
+	} else {
+		if (scope.m_cur >= scope.m_end) {
+			return nullptr; // end of the object/array
+		}
+		end = BinaryParseElement(scope.m_cur, scope.m_end, named, tag_, nameHash, data);
+		if (!end) {
+			setError("Error serializing %s: invalid data", _typeStr);
+			return nullptr;
+		}
+		++scope.m_index;
+	}
+
+	scope.m_cur = end;
+	return data;
+}
+
+void SerializerBinary::writeElement(uint8 _tag, const char* _name)
+{
+	Scope& scope = m_scopes.back();
+	m_name.set(_name ? _name : "");
+	++scope.m_index;
+	if (scope.m_isArray) {
+		*writeData(1) = _tag;
+	} else {
+		uint8* dst = writeData(1 + sizeof(uint32));
+		dst[0] = _tag;
+		BinaryStore<uint32>(dst + 1, HashString<uint32>((const char*)m_name));
+	}
+}
+
+uint8* SerializerBinary::writeData(uint _sizeBytes)
+{
+	uint offset = m_buffer.size();
+	m_buffer.resize(offset + _sizeBytes);
+	return m_buffer.data() + offset;
+}
+
+uint8* SerializerBinary::writeAligned(uint _headerSizeBytes, uint _dataSizeBytes, uint8*& data_)
+{
+	uint padding = (kAlignment - (getDataSize() + _headerSizeBytes) % kAlignment) % kAlignment;
+	uint8* ret = writeData(_headerSizeBytes + padding + _dataSizeBytes); // padding is zeroed by resize()
+	ret[_headerSizeBytes - 1] = (uint8)padding;
+	data_ = ret + _headerSizeBytes + padding;
+	return ret;
+}
+
+void SerializerBinary::writeTypedArray(const char* _name, uint8 _elementTag, const void* _data, uint _count, uint _elementSizeBytes)
+{
+	writeElement(BinaryTag_TypedArray, _name);
+	uint8* dst;
+	uint8* header = writeAligned(kBinaryTypedArrayHeaderSize, _elementSizeBytes * _count, dst);
+	BinaryStore<uint32>(header, (uint32)_count);
+	header[4] = _elementTag;
+	memcpy(dst, _data, _elementSizeBytes * _count);
+}
+
+uint64 SerializerBinary::deltaPath(const char* _name) const
+{
+	uint32 nameHash = HashString<uint32>(_name ? _name : "");
+	return Hash<uint64>(&nameHash, sizeof(nameHash), m_scopes.back().m_path);
+}
+
+bool SerializerBinary::deltaUnchanged(uint64 _path, uint64 _hash)
+{
+	auto it = m_snapshot->m_hashes.insert(eastl::make_pair(_path, _hash));
+	if (it.second) {
+		return false;
+	}
+	if (it.first->second == _hash) {
+		return true;
+	}
+	it.first->second = _hash;
+	return false;
+}
+
+void SerializerBinary::deltaTypedArray(const char* _name, uint8 _elementTag, const void* _data, uint _count, uint _elementSizeBytes)
+{
+	uint64 path = deltaPath(_name);
+	bool full = !deltaUnchanged(path, ((uint64)_count << 8) | _elementTag); // length or type changed
+
+ // hash blocks, find ranges of changed blocks
+	const uint8* data = (const uint8*)_data;
+	uint blockCount = (_count * _elementSizeBytes + kDeltaBlockSize - 1) / kDeltaBlockSize;
+	uint perBlock = APT_MAX(kDeltaBlockSize / _elementSizeBytes, (uint)1);
+	eastl::vector<uint> ranges; // pairs of first block, end block
+	for (uint i = 0; i < blockCount; ++i) {
+		uint first = i * perBlock;
+		uint n = APT_MIN(perBlock, _count - first);
+		uint32 blockIndex = (uint32)i;
+		uint64 blockPath = Hash<uint64>(&blockIndex, sizeof(blockIndex), path);
+		if (!deltaUnchanged(blockPath, HashFast<uint64>(data + first * _elementSizeBytes, n * _elementSizeBytes))) {
+			if (!ranges.empty() && ranges.back() == i) {
+				ranges.back() = i + 1;
+			} else {
+				ranges.push_back(i);
+				ranges.push_back(i + 1);
+			}
+		}
+	}
+	m_name.set(_name ? _name : "");
+	if (full || (ranges.size() == 2 && ranges[0] == 0 && ranges[1] == blockCount)) {
+		writeTypedArray(_name, _elementTag, _data, _count, _elementSizeBytes);
+		return;
+	}
+	if (ranges.empty()) {
+		return;
+	}
+
+	writeElement(BinaryTag_TypedArrayPatch, _name);
+	uint offset = getDataSize();
+	uint8* header = writeData(sizeof(uint32) * 2 + 1);
+	BinaryStore<uint32>(header + 4, (uint32)_count);
+	header[8] = _elementTag;
+	for (uint i = 0; i < ranges.size(); i += 2) {
+		uint first = ranges[i] * perBlock;
+		uint n = APT_MIN(ranges[i + 1] * perBlock, _count) - first;
+		uint8* dst = writeData(sizeof(uint32) * 2 + n * _elementSizeBytes);
+		BinaryStore<uint32>(dst, (uint32)first);
+		BinaryStore<uint32>(dst + 4, (uint32)n);
+		memcpy(dst + sizeof(uint32) * 2, data + first * _elementSizeBytes, n * _elementSizeBytes);
+	}
+	BinaryStore<uint32>(m_buffer.data() + offset, (uint32)(getDataSize() - offset - sizeof(uint32)));
+}
+
+bool SerializerBinary::patchMerge(const uint8* _base, const uint8* _baseEnd, const uint8* _patch, const uint8* _patchEnd)
+{
+	struct PatchElement
+	{
+		const uint8* m_data;
+		const uint8* m_end;
+		uint32       m_nameHash;
+		uint8        m_tag;
+		bool         m_used;
+	};
+	eastl::vector<PatchElement> elements;
+	eastl::hash_map<uint32, uint> elementIndex;
+	for (const uint8* p = _patch; p < _patchEnd; ) {
+		PatchElement e = {};
+		e.m_end = BinaryParseElement(p, _patchEnd, true, e.m_tag, e.m_nameHash, e.m_data);
+		if (!e.m_end) {
+			return false;
+		}
+		elementIndex.insert(eastl::make_pair(e.m_nameHash, (uint)elements.size()));
+		elements.push_back(e);
+		p = e.m_end;
+	}
+
+ // base elements in order, replaced or merged with patch elements
+	for (const uint8* p = _base; p < _baseEnd; ) {
+		uint8 tag;
+		uint32 nameHash;
+		const uint8* data;
+		const uint8* end = BinaryParseElement(p, _baseEnd, true, tag, nameHash, data);
+		if (!end) {
+			return false;
+		}
+		auto it = elementIndex.find(nameHash);
+		if (it == elementIndex.end() || elements[it->second].m_used) {
+			if (!patchCopyElement(true, tag, nameHash, data, end)) {
+				return false;
+			}
+
+		} else {
+			PatchElement& e = elements[it->second];
+			e.m_used = true;
+			if (tag == BinaryTag_Object && e.m_tag == BinaryTag_Object) {
+				uint8* header = writeData(1 + sizeof(uint32));
+				header[0] = tag;
+				BinaryStore<uint32>(header + 1, nameHash);
+				uint offset = getDataSize();
+				writeData(sizeof(uint32));
+				if (!patchMerge(data + sizeof(uint32), end, e.m_data + sizeof(uint32), e.m_end)) {
+					return false;
+				}
+				BinaryStore<uint32>(m_buffer.data() + offset, (uint32)(getDataSize() - offset - sizeof(uint32)));
+
+			} else if (e.m_tag == BinaryTag_TypedArrayPatch) {
+				if (tag != BinaryTag_TypedArray || BinaryLoad<uint32>(data) != BinaryLoad<uint32>(e.m_data + 4) || data[4] != e.m_data[8]) {
+					return false;
+				}
+				uint8* dst = patchCopyElement(true, tag, nameHash, data, end);
+				uint stride = kBinaryScalarSizes[data[4]];
+				bool valid = BinaryForEachRange(e.m_data, [&](uint _first, uint _n, const uint8* _src) {
+					memcpy(dst + _first * stride, _src, _n * stride);
+				});
+				if (!valid) {
+					return false;
+				}
+
+			} else if (!patchCopyElement(true, e.m_tag, e.m_nameHash, e.m_data, e.m_end)) {
+				return false;
+			}
+		}
+		p = end;
+	}
+
+ // new elements
+	for (const PatchElement& e : elements) {
+		if (!e.m_used && !patchCopyElement(true, e.m_tag, e.m_nameHash, e.m_data, e.m_end)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool SerializerBinary::patchCopy(const uint8* _beg, const uint8* _end, bool _named)
+{
+	for (const uint8* p = _beg; p < _end; ) {
+		uint8 tag;
+		uint32 nameHash;
+		const uint8* data;
+		const uint8* end = BinaryParseElement(p, _end, _named, tag, nameHash, data);
+		if (!end || !patchCopyElement(_named, tag, nameHash, data, end)) {
+			return false;
+		}
+		p = end;
+	}
+	return true;
+}
+
+uint8* SerializerBinary::patchCopyElement(bool _named, uint8 _tag, uint32 _nameHash, const uint8* _data, const uint8* _end)
+{
+	if (_tag == BinaryTag_TypedArrayPatch) {
+		return nullptr; // can't apply without a base
+	}
+	uint8* header = writeData(_named ? 1 + sizeof(uint32) : 1);
+	header[0] = _tag;
+	if (_named) {
+		BinaryStore<uint32>(header + 1, _nameHash);
+	}
+
+	switch (_tag) {
+		case BinaryTag_Binary:
+		case BinaryTag_TypedArray: {
+		 // realign the data
+			uint headerSize = _tag == BinaryTag_Binary ? kBinaryHeaderSize : kBinaryTypedArrayHeaderSize;
+			uint sizeBytes = _tag == BinaryTag_Binary ? BinaryLoad<uint32>(_data) : BinaryLoad<uint32>(_data) * kBinaryScalarSizes[_data[4]];
+			uint8* dst;
+			uint8* dstHeader = writeAligned(headerSize, sizeBytes, dst);
+			memcpy(dstHeader, _data, headerSize - 1);
+			memcpy(dst, _data + headerSize + _data[headerSize - 1], sizeBytes);
+			return dst;
+		}
+		case BinaryTag_Object:
+		case BinaryTag_Array: {
+			uint headerSize = _tag == BinaryTag_Object ? sizeof(uint32) : sizeof(uint32) * 2;
+			uint offset = getDataSize();
+			memcpy(writeData(headerSize), _data, headerSize);
+			if (!patchCopy(_data + headerSize, _end, _tag == BinaryTag_Object)) {
+				return nullptr;
+			}
+			BinaryStore<uint32>(m_buffer.data() + offset, (uint32)(getDataSize() - offset - sizeof(uint32)));
+			return m_buffer.data() + offset;
+		}
+		default: {
+			uint8* dst = writeData(_end - _data);
+			memcpy(dst, _data, _end - _data);
+			return dst;
+		}
+	};
+}
+
+template <typename tType>
+bool SerializerBinary::valueImpl(tType& _value_, const char* _name)
+{
+	if (getMode() == Mode_Read) {
+		uint8 tag;
+		const uint8* data = readElement(_name, ValueTypeToStr<tType>(), tag);
+		if (!data) {
+			return m_isAbsent;
+		}
+		if (!BinaryLoadNumeric(tag, data, _value_)) {
+			setError("Error serializing %s: '%s' not a number", ValueTypeToStr<tType>(), (const char*)m_name);
+			return false;
+		}
+
+	} else {
+		if (isDelta() && deltaUnchanged(deltaPath(_name), HashFast<uint64>(&_value_, sizeof(tType), BinaryTag<tType>::kValue))) {
+			m_name.set(_name ? _name : "");
+			return true;
+		}
+		writeElement(BinaryTag<tType>::kValue, _name);
+		BinaryStore<tType>(writeData(sizeof(tType)), _value_);
+	}
+	return true;
+}
+
+template <typename tType>
+bool SerializerBinary::valueArrayImpl(tType* _data_, uint _count, const char* _name)
+{
+	APT_ASSERT(_data_ || _count == 0);
+	if (getMode() == Mode_Read) {
+		uint8 tag;
+		const uint8* data = readElement(_name, ValueTypeToStr<tType>(), tag);
+		if (!data) {
+			return m_isAbsent;
+		}
+		if (tag == BinaryTag_Array) {
+		 // array written via beginArray()/value(), convert per element
+			uint count = BinaryLoad<uint32>(data + sizeof(uint32));
+			if (count != _count) {
+				setError("Error serializing %s array '%s': array length was %u, expected %u", ValueTypeToStr<tType>(), (const char*)m_name, count, _count);
+				return false;
+			}
+			const uint8* p = data + sizeof(uint32) * 2;
+			const uint8* end = data + sizeof(uint32) + BinaryLoad<uint32>(data);
+			for (uint i = 0; i < _count; ++i) {
+				uint8 elementTag;
+				uint32 nameHash;
+				const uint8* src;
+				p = BinaryParseElement(p, end, false, elementTag, nameHash, src);
+				if (!p || !BinaryLoadNumeric(elementTag, src, _data_[i])) {
+					setError("Error serializing %s array '%s': element %u not a number", ValueTypeToStr<tType>(), (const char*)m_name, i);
+					return false;
+				}
+			}
+			return true;
+		}
+		if (tag == BinaryTag_TypedArrayPatch) {
+			uint count = BinaryLoad<uint32>(data + 4);
+			if (count != _count) {
+				setError("Error serializing %s array '%s': array length was %u, expected %u", ValueTypeToStr<tType>(), (const char*)m_name, count, _count);
+				return false;
+			}
+			uint8 elementTag = data[8];
+			uint stride = kBinaryScalarSizes[elementTag];
+			bool valid = BinaryForEachRange(data, [&](uint _first, uint _n, const uint8* _src) {
+				if (elementTag == BinaryTag<tType>::kValue) {
+					memcpy(_data_ + _first, _src, sizeof(tType) * _n);
+				} else {
+					for (uint i = 0; i < _n; ++i, _src += stride) {
+						BinaryLoadNumeric(elementTag, _src, _data_[_first + i]);
+					}
+				}
+			});
+			if (!valid) {
+				setError("Error serializing %s array '%s': invalid data", ValueTypeToStr<tType>(), (const char*)m_name);
+			}
+			return valid;
+		}
+		if (tag != BinaryTag_TypedArray) {
+			setError("Error serializing %s array '%s': not an array", ValueTypeToStr<tType>(), (const char*)m_name);
+			return false;
+		}
+		uint count = BinaryLoad<uint32>(data);
+		if (count != _count) {
+			setError("Error serializing %s array '%s': array length was %u, expected %u", ValueTypeToStr<tType>(), (const char*)m_name, count, _count);
+			return false;
+		}
+		uint8 elementTag = data[4];
+		const uint8* src = data + kBinaryTypedArrayHeaderSize + data[kBinaryTypedArrayHeaderSize - 1];
+		if (elementTag == BinaryTag<tType>::kValue) {
+			memcpy(_data_, src, sizeof(tType) * _count);
+		} else {
+			uint stride = kBinaryScalarSizes[elementTag];
+			for (uint i = 0; i < _count; ++i, src += stride) {
+				BinaryLoadNumeric(elementTag, src, _data_[i]);
+			}
+		}
+
+	} else {
+		if (isDelta()) {
+			deltaTypedArray(_name, BinaryTag<tType>::kValue, _data_, _count, sizeof(tType));
+		} else {
+			writeTypedArray(_name, BinaryTag<tType>::kValue, _data_, _count, sizeof(tType));
+		}
+	}
+	return true;
+}
+
+template <typename tType>
+bool SerializerBinary::arrayViewImpl(const tType*& data_, uint& count_, const char* _name)
+{
+	APT_ASSERT(getMode() == Mode_Read);
+	uint8 tag;
+	const uint8* data = readElement(_name, ValueTypeToStr<tType>(), tag);
+	if (!data) {
+		return false;
+	}
+	if (tag != BinaryTag_TypedArray || data[4] != BinaryTag<tType>::kValue) {
+		setError("Error serializing %s array '%s': type mismatch", ValueTypeToStr<tType>(), (const char*)m_name);
+		return false;
+	}
+	data_ = (const tType*)(data + kBinaryTypedArrayHeaderSize + data[kBinaryTypedArrayHeaderSize - 1]);
+	count_ = BinaryLoad<uint32>(data);
+	return true;
+}
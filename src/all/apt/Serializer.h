@@ -6,6 +6,9 @@
 #include <apt/types.h>
 #include <apt/String.h>
 
+#include <EASTL/hash_map.h>
+#include <EASTL/vector.h>
+
 namespace apt {
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -27,6 +30,14 @@ public:
 	const char*         getError() const                             { return m_errStr.isEmpty() ? nullptr : (const char*)m_errStr; }
 	void                setError(const char* _msg, ...);
 
+	// If enabled, a checksum is written with compressed binary() data. The checksum is always verified when reading.
+	bool                getBinaryChecksum() const                    { return m_binaryChecksum; }
+	void                setBinaryChecksum(bool _binaryChecksum)      { m_binaryChecksum = _binaryChecksum; }
+
+	// Id of a CompressionDictionary used when writing compressed binary() data (0 = none). The dictionary must be registered when reading.
+	uint32              getBinaryDictionary() const                  { return m_binaryDictionary; }
+	void                setBinaryDictionary(uint32 _dictionaryId)    { m_binaryDictionary = _dictionaryId; }
+
 	// Return false if _name is not found, or if the end of the current object is reached. If in an object/array and _name is not specified,
 	// advance to the next element.
 	virtual bool        beginObject(const char* _name = nullptr) = 0;
@@ -60,7 +71,7 @@ public:
 	virtual bool        value(float64&    _value_, const char* _name = nullptr) = 0;
 	virtual bool        value(StringBase& _value_, const char* _name = nullptr) = 0;
 	
-	// vec* and mat* variants are implemented in terms of beginArray/endArray and value(float&).
+	// vec* and mat* variants are implemented in terms of valueArray(float32*).
 	bool                value(vec2& _value_, const char* _name = nullptr);
 	bool                value(vec3& _value_, const char* _name = nullptr);
 	bool                value(vec4& _value_, const char* _name = nullptr);
@@ -75,6 +86,28 @@ public:
 		 return value((StringBase&)_value_, _name); 
 	}
 
+	// Serialize _count values as an array. When reading, _count must match the array length. Backends implement these as a
+	// single operation, which is much faster than calling value() per element inside beginArray()/endArray().
+	virtual bool        valueArray(bool*    _data_, uint _count, const char* _name = nullptr) = 0;
+	virtual bool        valueArray(sint8*   _data_, uint _count, const char* _name = nullptr) = 0;
+	virtual bool        valueArray(uint8*   _data_, uint _count, const char* _name = nullptr) = 0;
+	virtual bool        valueArray(sint16*  _data_, uint _count, const char* _name = nullptr) = 0;
+	virtual bool        valueArray(uint16*  _data_, uint _count, const char* _name = nullptr) = 0;
+	virtual bool        valueArray(sint32*  _data_, uint _count, const char* _name = nullptr) = 0;
+	virtual bool        valueArray(uint32*  _data_, uint _count, const char* _name = nullptr) = 0;
+	virtual bool        valueArray(sint64*  _data_, uint _count, const char* _name = nullptr) = 0;
+	virtual bool        valueArray(uint64*  _data_, uint _count, const char* _name = nullptr) = 0;
+	virtual bool        valueArray(float32* _data_, uint _count, const char* _name = nullptr) = 0;
+	virtual bool        valueArray(float64* _data_, uint _count, const char* _name = nullptr) = 0;
+
+	// vec* and mat* variants serialize a flat array of _count * N floats.
+	bool                valueArray(vec2* _data_, uint _count, const char* _name = nullptr);
+	bool                valueArray(vec3* _data_, uint _count, const char* _name = nullptr);
+	bool                valueArray(vec4* _data_, uint _count, const char* _name = nullptr);
+	bool                valueArray(mat2* _data_, uint _count, const char* _name = nullptr);
+	bool                valueArray(mat3* _data_, uint _count, const char* _name = nullptr);
+	bool                valueArray(mat4* _data_, uint _count, const char* _name = nullptr);
+
 	// Directly serialize bytes of binary data with optional compression. When reading, _data_ will be allocated by the function if null, and 
 	// should subsequently be released via APT_FREE().
 	virtual bool        binary(
@@ -90,9 +123,13 @@ public:
 
 protected:
 	Mode m_mode;
+	bool m_binaryChecksum;
+	uint32 m_binaryDictionary;
 
 	Serializer(Mode _mode)
 		: m_mode(_mode)
+		, m_binaryChecksum(false)
+		, m_binaryDictionary(0)
 	{
 	}
 	virtual ~Serializer()
@@ -108,6 +145,198 @@ private:
 
 }; // class Serializer
 
+////////////////////////////////////////////////////////////////////////////////
+// SerializerBinary
+// Compact little-endian binary backend. Each value is written as a 1 byte type
+// tag, a 32 bit name hash (object members only, array elements are unnamed)
+// and the value data. Objects and arrays are size-prefixed, hence reading 
+// named values in a different order to which they were written, or skipping
+// values, is supported (but reading in order is fastest). Numeric values are
+// converted on read if the type differs.
+//
+// In Mode_Write, data is written to an internal buffer (see getData()). In
+// Mode_Read, call setData() to read from an external buffer (which must 
+// remain valid while reading, no copy is made). Changing from Mode_Write to
+// Mode_Read reads back the internal buffer.
+//
+// getName() returns the name passed to the last call, or "" when reading
+// unnamed values (names aren't stored).
+//
+// Uncompressed binary() data and typed arrays (see valueArray()) are aligned
+// to kAlignment relative to the start of the data. In Mode_Read, the *View()
+// functions return ptrs directly into the source buffer, e.g. a mapped file:
+//
+//   File f;
+//   File::Map(f, "scene.bin");
+//   SerializerBinary ser(SerializerBinary::Mode_Read);
+//   ser.setData(f.getData(), (uint)f.getDataSize());
+//   const float* vertices; uint vertexCount;
+//   ser.arrayView(vertices, vertexCount, "vertices"); // valid while f is mapped
+//
+// Delta serialization: in Mode_Write, if a DeltaSnapshot is set then values
+// which are unchanged since the last write with the same snapshot are skipped
+// and the result is a patch:
+// - Objects are omitted if all their members are unchanged.
+// - Arrays (beginArray()) are written in full if any element changed.
+// - Typed arrays (valueArray()) are written as ranges of changed blocks of
+//   kDeltaBlockSize bytes.
+// A patch can be read directly, in which case members missing from the patch
+// aren't an error (the values are left unmodified and the read succeeds; the
+// *View() functions return false), or merged with the previous complete data
+// via applyPatch(). Members can't be removed by a patch.
+////////////////////////////////////////////////////////////////////////////////
+class SerializerBinary final: public Serializer
+{
+public:
+	static const uint kAlignment      = 16;
+	static const uint kDeltaBlockSize = 4096;
+
+	// Hashes of the values written with the snapshot set, keyed by path.
+	class DeltaSnapshot
+	{
+		friend class SerializerBinary;
+		eastl::hash_map<uint64, uint64> m_hashes;
+	public:
+		void clear()                                                 { m_hashes.clear(); }
+	};
+
+	SerializerBinary(Mode _mode);
+
+	// Read from _data (Mode_Read only). Return false if _data doesn't contain a valid header.
+	bool        setData(const void* _data, uint _sizeBytes);
+
+	// Mode_Read: whether the data is a patch.
+	bool        isPatch() const                                      { return m_isPatch; }
+
+	// Mode_Write: subsequent writes produce a patch relative to _snapshot_ (or complete data if nullptr), _snapshot_ is
+	// updated. Resets the internal buffer.
+	void        setDeltaSnapshot(DeltaSnapshot* _snapshot_)          { m_snapshot = _snapshot_; onModeChange(m_mode); }
+	DeltaSnapshot* getDeltaSnapshot()                                { return m_snapshot; }
+
+	// Mode_Write: write the result of applying _patch to _base (complete data, or nullptr if the patch was the first write
+	// with a snapshot). Return false if either is invalid.
+	bool        applyPatch(const void* _base, uint _baseSizeBytes, const void* _patch, uint _patchSizeBytes);
+
+	// Written data (Mode_Write).
+	const void* getData() const                                      { return m_buffer.data(); }
+	uint        getDataSize() const                                  { return (uint)m_buffer.size(); }
+
+	bool        beginObject(const char* _name = nullptr) override;
+	void        endObject() override;
+
+	bool        beginArray(uint& _length_, const char* _name = nullptr) override;
+	void        endArray() override;
+
+	const char* getName() const override;
+	uint32      getIndex() const override;
+
+	bool        value(bool&       _value_, const char* _name = nullptr) override;
+	bool        value(sint8&      _value_, const char* _name = nullptr) override;
+	bool        value(uint8&      _value_, const char* _name = nullptr) override;
+	bool        value(sint16&     _value_, const char* _name = nullptr) override;
+	bool        value(uint16&     _value_, const char* _name = nullptr) override;
+	bool        value(sint32&     _value_, const char* _name = nullptr) override;
+	bool        value(uint32&     _value_, const char* _name = nullptr) override;
+	bool        value(sint64&     _value_, const char* _name = nullptr) override;
+	bool        value(uint64&     _value_, const char* _name = nullptr) override;
+	bool        value(float32&    _value_, const char* _name = nullptr) override;
+	bool        value(float64&    _value_, const char* _name = nullptr) override;
+	bool        value(StringBase& _value_, const char* _name = nullptr) override;
+
+	bool        binary(void*& _data_, uint& _sizeBytes_, const char* _name = nullptr, CompressionFlags _compressionFlags = CompressionFlags_None) override;
+
+	// Arrays are written as a typed array (stored contiguously, aligned to kAlignment). When reading, values are converted if the
+	// type differs; arrays written via beginArray()/value() are also accepted.
+	using Serializer::valueArray;
+	bool        valueArray(bool*    _data_, uint _count, const char* _name = nullptr) override;
+	bool        valueArray(sint8*   _data_, uint _count, const char* _name = nullptr) override;
+	bool        valueArray(uint8*   _data_, uint _count, const char* _name = nullptr) override;
+	bool        valueArray(sint16*  _data_, uint _count, const char* _name = nullptr) override;
+	bool        valueArray(uint16*  _data_, uint _count, const char* _name = nullptr) override;
+	bool        valueArray(sint32*  _data_, uint _count, const char* _name = nullptr) override;
+	bool        valueArray(uint32*  _data_, uint _count, const char* _name = nullptr) override;
+	bool        valueArray(sint64*  _data_, uint _count, const char* _name = nullptr) override;
+	bool        valueArray(uint64*  _data_, uint _count, const char* _name = nullptr) override;
+	bool        valueArray(float32* _data_, uint _count, const char* _name = nullptr) override;
+	bool        valueArray(float64* _data_, uint _count, const char* _name = nullptr) override;
+
+	// Zero-copy access (Mode_Read). Return ptrs into the source buffer, valid while the source buffer is valid. Return false if
+	// _name is not found, if binary data is compressed or if the array type doesn't match. Strings aren't null terminated.
+	bool        binaryView(const void*& data_, uint& sizeBytes_, const char* _name = nullptr);
+	bool        stringView(const char*& str_, uint& length_, const char* _name = nullptr);
+	bool        arrayView(const bool*&    data_, uint& count_, const char* _name = nullptr);
+	bool        arrayView(const sint8*&   data_, uint& count_, const char* _name = nullptr);
+	bool        arrayView(const uint8*&   data_, uint& count_, const char* _name = nullptr);
+	bool        arrayView(const sint16*&  data_, uint& count_, const char* _name = nullptr);
+	bool        arrayView(const uint16*&  data_, uint& count_, const char* _name = nullptr);
+	bool        arrayView(const sint32*&  data_, uint& count_, const char* _name = nullptr);
+	bool        arrayView(const uint32*&  data_, uint& count_, const char* _name = nullptr);
+	bool        arrayView(const sint64*&  data_, uint& count_, const char* _name = nullptr);
+	bool        arrayView(const uint64*&  data_, uint& count_, const char* _name = nullptr);
+	bool        arrayView(const float32*& data_, uint& count_, const char* _name = nullptr);
+	bool        arrayView(const float64*& data_, uint& count_, const char* _name = nullptr);
+
+private:
+	struct Scope
+	{
+		const uint8* m_beg;     // Mode_Read: first element
+		const uint8* m_end;     // Mode_Read: end of the object/array
+		const uint8* m_cur;     // Mode_Read: next element
+		uint         m_offset;  // Mode_Write: offset of the size field in m_buffer
+		uint         m_elementOffset; // Mode_Write: offset of the element header in m_buffer
+		uint64       m_path;    // Mode_Write: delta snapshot key
+		uint32       m_index;   // index of the next element
+		bool         m_isArray; // array elements are unnamed
+		bool         m_isAtomic; // Mode_Write: array or inside an array, no delta per member
+	};
+
+	eastl::vector<uint8> m_buffer;
+	eastl::vector<Scope> m_scopes;
+	const uint8*         m_data;
+	uint                 m_dataSize;
+	String<32>           m_name;    // copy of the last _name, the caller's string may be temporary
+	DeltaSnapshot*       m_snapshot;
+	bool                 m_isPatch;
+	bool                 m_isAbsent; // Mode_Read: the last element wasn't found because it was missing from a patch
+
+	void onModeChange(Mode _mode) override;
+
+	// Mode_Read: find the next element, or the element matching _name. Return a ptr to the element data or nullptr if not found
+	// (m_isAbsent is set if the element was missing from a patch, which isn't an error).
+	const uint8* readElement(const char* _name, const char* _typeStr, uint8& tag_);
+	// Mode_Write: write an element header. writeData() returns a ptr to _sizeBytes at the end of m_buffer.
+	void         writeElement(uint8 _tag, const char* _name);
+	uint8*       writeData(uint _sizeBytes);
+	// Mode_Write: write a header of _headerSizeBytes (the last byte of which is the padding size) followed by _dataSizeBytes aligned
+	// to kAlignment. Return a ptr to the header, data_ receives a ptr to the data.
+	uint8*       writeAligned(uint _headerSizeBytes, uint _dataSizeBytes, uint8*& data_);
+
+	// Mode_Write: write a typed array element.
+	void         writeTypedArray(const char* _name, uint8 _elementTag, const void* _data, uint _count, uint _elementSizeBytes);
+
+	// Mode_Write: whether values in the current scope are written with delta.
+	bool         isDelta() const                                     { return m_snapshot && !m_scopes.back().m_isAtomic; }
+	// Mode_Write: snapshot key for _name in the current scope.
+	uint64       deltaPath(const char* _name) const;
+	// Mode_Write: return true if _hash matches the snapshot at _path (the value can be skipped), else update the snapshot.
+	bool         deltaUnchanged(uint64 _path, uint64 _hash);
+	// Mode_Write: write the changed ranges of a typed array (or nothing if unchanged).
+	void         deltaTypedArray(const char* _name, uint8 _elementTag, const void* _data, uint _count, uint _elementSizeBytes);
+
+	// applyPatch() helpers, copy or merge elements between _beg and _end.
+	bool         patchMerge(const uint8* _base, const uint8* _baseEnd, const uint8* _patch, const uint8* _patchEnd);
+	bool         patchCopy(const uint8* _beg, const uint8* _end, bool _named);
+	uint8*       patchCopyElement(bool _named, uint8 _tag, uint32 _nameHash, const uint8* _data, const uint8* _end);
+
+	template <typename tType>
+	bool         valueImpl(tType& _value_, const char* _name);
+	template <typename tType>
+	bool         valueArrayImpl(tType* _data_, uint _count, const char* _name);
+	template <typename tType>
+	bool         arrayViewImpl(const tType*& data_, uint& count_, const char* _name);
+
+}; // class SerializerBinary
+
 // Serialize* variants implicitly log an error if _serializer_.value() returns false.
 bool Serialize(Serializer& _serializer_, bool&        _value_, const char* _name = nullptr);
 bool Serialize(Serializer& _serializer_, sint8&       _value_, const char* _name = nullptr);
@@ -159,4 +388,176 @@ bool SerializeEnum(Serializer& _serializer_, tType& _value_, const char* (&_strL
 	return ret;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Static serialization
+// SerializeStatic() resolves value calls at compile time: if tSerializer is a
+// concrete backend (SerializerBinary, SerializerJson) calls are devirtualized
+// and may be inlined; passing a Serializer& falls back to virtual dispatch.
+// Arrays of scalar/vector/matrix types are serialized via a single call to
+// valueArray(). Class types must provide a serialize() member template which
+// lists the fields to serialize:
+//
+//   struct Node
+//   {
+//      String<32> m_name;
+//      mat4       m_world;
+//      float      m_weights[4];
+//      Node       m_children[2]; // arrays of class types are arrays of objects
+//
+//      template <typename tSerializer>
+//      bool serialize(tSerializer& _serializer_)
+//      {
+//         return SerializeFields(_serializer_,
+//            APT_SERIALIZE_FIELD(m_name),
+//            APT_SERIALIZE_FIELD(m_world),
+//            SerializeField("weights", m_weights) // explicit name
+//            );
+//      }
+//   };
+//
+//   SerializerBinary ser(SerializerBinary::Mode_Write);
+//   SerializeStatic(ser, node, "node"); // class types are written as a named object
+//
+// To serialize a class's fields directly into the current object, call its
+// serialize() member. Errors are logged as per Serialize().
+////////////////////////////////////////////////////////////////////////////////
+template <typename tType>
+struct SerializeFieldRef
+{
+	const char* m_name;
+	tType&      m_value;
+};
+template <typename tType>
+inline SerializeFieldRef<tType> SerializeField(const char* _name, tType& _value_)
+{
+	return SerializeFieldRef<tType>{ _name, _value_ };
+}
+#define APT_SERIALIZE_FIELD(_field) apt::SerializeField(#_field, _field)
+
+namespace internal {
+
+// Log the current error (if any), return false.
+bool SerializeError(Serializer& _serializer_);
+
+#define APT_SerializeStatic_Scalar(_type) \
+	template <typename tSerializer> \
+	inline bool SerializeStaticImpl(tSerializer& _serializer_, _type& _value_, const char* _name) \
+	{ \
+		return _serializer_.value(_value_, _name) || SerializeError(_serializer_); \
+	} \
+	template <typename tSerializer> \
+	inline bool SerializeStaticArray(tSerializer& _serializer_, _type* _data_, uint _count, const char* _name) \
+	{ \
+		return _serializer_.valueArray(_data_, _count, _name) || SerializeError(_serializer_); \
+	}
+APT_SerializeStatic_Scalar(bool)
+APT_SerializeStatic_Scalar(sint8)
+APT_SerializeStatic_Scalar(uint8)
+APT_SerializeStatic_Scalar(sint16)
+APT_SerializeStatic_Scalar(uint16)
+APT_SerializeStatic_Scalar(sint32)
+APT_SerializeStatic_Scalar(uint32)
+APT_SerializeStatic_Scalar(sint64)
+APT_SerializeStatic_Scalar(uint64)
+APT_SerializeStatic_Scalar(float32)
+APT_SerializeStatic_Scalar(float64)
+#undef APT_SerializeStatic_Scalar
+
+// Vector/matrix types are flat arrays of their base type.
+#define APT_SerializeStatic_Composite(_type) \
+	template <typename tSerializer> \
+	inline bool SerializeStaticImpl(tSerializer& _serializer_, _type& _value_, const char* _name) \
+	{ \
+		return _serializer_.valueArray((APT_TRAITS_BASE_TYPE(_type)*)&_value_, APT_TRAITS_COUNT(_type), _name) || SerializeError(_serializer_); \
+	} \
+	template <typename tSerializer> \
+	inline bool SerializeStaticArray(tSerializer& _serializer_, _type* _data_, uint _count, const char* _name) \
+	{ \
+		return _serializer_.valueArray((APT_TRAITS_BASE_TYPE(_type)*)_data_, _count * APT_TRAITS_COUNT(_type), _name) || SerializeError(_serializer_); \
+	}
+APT_SerializeStatic_Composite(vec2)
+APT_SerializeStatic_Composite(vec3)
+APT_SerializeStatic_Composite(vec4)
+APT_SerializeStatic_Composite(ivec2)
+APT_SerializeStatic_Composite(ivec3)
+APT_SerializeStatic_Composite(ivec4)
+APT_SerializeStatic_Composite(uvec2)
+APT_SerializeStatic_Composite(uvec3)
+APT_SerializeStatic_Composite(uvec4)
+APT_SerializeStatic_Composite(mat2)
+APT_SerializeStatic_Composite(mat3)
+APT_SerializeStatic_Composite(mat4)
+#undef APT_SerializeStatic_Composite
+
+template <typename tSerializer>
+inline bool SerializeStaticImpl(tSerializer& _serializer_, StringBase& _value_, const char* _name)
+{
+	return _serializer_.value(_value_, _name) || SerializeError(_serializer_);
+}
+template <typename tSerializer, uint kCapacity>
+inline bool SerializeStaticImpl(tSerializer& _serializer_, String<kCapacity>& _value_, const char* _name)
+{
+	return SerializeStaticImpl(_serializer_, (StringBase&)_value_, _name);
+}
+
+// Class types.
+template <typename tSerializer, typename tType>
+inline bool SerializeStaticImpl(tSerializer& _serializer_, tType& _value_, const char* _name)
+{
+	if (!_serializer_.beginObject(_name)) {
+		return SerializeError(_serializer_);
+	}
+	bool ret = _value_.serialize(_serializer_);
+	_serializer_.endObject();
+	return ret;
+}
+
+template <typename tSerializer, typename tType, uint kCount>
+inline bool SerializeStaticImpl(tSerializer& _serializer_, tType (&_value_)[kCount], const char* _name);
+
+// Arrays of strings/class types.
+template <typename tSerializer, typename tType>
+inline bool SerializeStaticArray(tSerializer& _serializer_, tType* _data_, uint _count, const char* _name)
+{
+	uint count = _count;
+	if (!_serializer_.beginArray(count, _name)) {
+		return SerializeError(_serializer_);
+	}
+	bool ret = true;
+	if (count != _count) {
+		_serializer_.setError("Error serializing array '%s': array length was %u, expected %u", _name ? _name : "", count, _count);
+		ret = SerializeError(_serializer_);
+	} else {
+		for (uint i = 0; i < _count; ++i) {
+			ret &= SerializeStaticImpl(_serializer_, _data_[i], nullptr);
+		}
+	}
+	_serializer_.endArray();
+	return ret;
+}
+
+template <typename tSerializer, typename tType, uint kCount>
+inline bool SerializeStaticImpl(tSerializer& _serializer_, tType (&_value_)[kCount], const char* _name)
+{
+	return SerializeStaticArray(_serializer_, _value_, kCount, _name);
+}
+
+} // namespace internal
+
+template <typename tSerializer, typename tType>
+inline bool SerializeStatic(tSerializer& _serializer_, tType& _value_, const char* _name = nullptr)
+{
+	return internal::SerializeStaticImpl(_serializer_, _value_, _name);
+}
+
+// Serialize a list of fields (see SerializeField()). All fields are serialized, return false if any failed.
+template <typename tSerializer, typename ...tFields>
+inline bool SerializeFields(tSerializer& _serializer_, const tFields&... _fields)
+{
+	bool ret = true;
+	int expand[] = { 0, (ret &= internal::SerializeStaticImpl(_serializer_, _fields.m_value, _fields.m_name), 0)... };
+	(void)expand;
+	return ret;
+}
+
 } // namespace apt
@@ -61,6 +61,8 @@ uint StringBase::setfv(const char* _fmt, va_list _args)
 	APT_STRICT_ASSERT(len >= 0);
 	if (m_capacity < len + 1) {
 		alloc(len + 1);
+		va_end(args); // args was consumed by the first pass
+		va_copy(args, _args);
 		APT_VERIFY(vsnprintf(m_buf, m_capacity, _fmt, args) >= 0);
 	}
 #endif
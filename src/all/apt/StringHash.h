@@ -1,12 +1,22 @@
 #pragma once
 
 #include <apt/apt.h>
+#include <apt/hash.h>
+
+#include <type_traits>
+
+// Hash a string literal at compile time, e.g. APT_STRING_HASH("Player"). The result is identical to StringHash("Player").
+#define APT_STRING_HASH(_str) \
+	apt::StringHash::FromHash(std::integral_constant<apt::StringHash::HashType, apt::internal::HashStringConst64(_str)>::value)
 
 namespace apt {
 
 ////////////////////////////////////////////////////////////////////////////////
 // StringHash
 // Fast, non-cryptographic hash generated from a character string.
+// Use APT_STRING_HASH() or the _sh literal suffix to hash string literals at
+// compile time, e.g. Entity::Create(APT_STRING_HASH("Player")) or
+// case "Player"_sh: in a switch statement.
 ////////////////////////////////////////////////////////////////////////////////
 class StringHash
 {
@@ -15,7 +25,7 @@ public:
 	static const StringHash kInvalidHash;
 
 	// Default ctor, hash is invalid.
-	StringHash(): m_hash(0)  {}
+	constexpr StringHash(): m_hash(0)  {}
 
 	// Initialize from a null-terminated string.
 	StringHash(const char* _str);
@@ -23,10 +33,13 @@ public:
 	// Initialize from _len characters of _str.
 	StringHash(const char* _str, uint _len);
 
+	// Initialize from a precomputed hash value (see APT_STRING_HASH).
+	static constexpr StringHash FromHash(HashType _hash) { return StringHash(_hash, 0); }
+
 	// May be kInvalidHash in the case of an uninitialized StringHash.
-	HashType getHash() const { return m_hash; }
+	constexpr HashType getHash() const { return m_hash; }
 
-	operator HashType() const                      { return m_hash; }
+	constexpr operator HashType() const            { return m_hash; }
 	bool operator==(const StringHash& _rhs) const  { return m_hash == _rhs.m_hash; }
 	bool operator!=(const StringHash& _rhs) const  { return m_hash != _rhs.m_hash; }
 	bool operator> (const StringHash& _rhs) const  { return m_hash >  _rhs.m_hash; }
@@ -36,9 +49,14 @@ public:
 
 private:
 	HashType m_hash;
+
+	constexpr StringHash(HashType _hash, int): m_hash(_hash) {}
 };
 
 inline bool operator==(StringHash::HashType _lhs, const StringHash& _rhs) { return _lhs == _rhs.getHash(); }
 inline bool operator!=(StringHash::HashType _lhs, const StringHash& _rhs) { return _lhs != _rhs.getHash(); }
 
+// String literal suffix, e.g. "Player"_sh. Evaluated at compile time where the result is used as a constant expression.
+inline constexpr StringHash operator"" _sh(const char* _str, size_t /*_len*/) { return StringHash::FromHash(internal::HashStringConst64(_str)); }
+
 } // namespace apt
@@ -5,6 +5,12 @@
 
 #include <cstdarg> // va_list, va_start, va_end
 
+#if APT_COMPILER_MSVC
+	#include <intrin.h> // __cpuid, __cpuidex, _xgetbv
+#else
+	#include <cpuid.h>  // __get_cpuid, __get_cpuid_count
+#endif
+
 static thread_local apt::AssertCallback* g_AssertCallback = &apt::DefaultAssertCallback;
 
 void apt::SetAssertCallback(AssertCallback* _callback) 
@@ -49,3 +55,43 @@ const char* apt::internal::StripPath(const char* _path)
 	}
 	return &_path[last];
 }
+
+static apt::internal::CpuFeatures DetectCpuFeatures()
+{
+	using namespace apt::internal;
+	CpuFeatures ret = 0;
+	#if APT_COMPILER_MSVC
+		int info[4];
+		__cpuid(info, 0);
+		int maxLeaf = info[0];
+		__cpuid(info, 1);
+		ret |= (info[2] & (1 << 19)) ? CpuFeature_Sse41 : 0;
+		ret |= (info[2] & (1 << 20)) ? CpuFeature_Sse42 : 0;
+		bool osAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6; // OSXSAVE, AVX, XMM/YMM state enabled
+		if (osAvx && maxLeaf >= 7) {
+			__cpuidex(info, 7, 0);
+			ret |= (info[1] & (1 << 5)) ? CpuFeature_Avx2 : 0;
+		}
+	#else
+		unsigned a, b, c, d;
+		if (!__get_cpuid(1, &a, &b, &c, &d)) {
+			return ret;
+		}
+		ret |= (c & bit_SSE4_1) ? CpuFeature_Sse41 : 0;
+		ret |= (c & bit_SSE4_2) ? CpuFeature_Sse42 : 0;
+		bool osAvx = false;
+		if ((c & bit_OSXSAVE) != 0 && (c & bit_AVX) != 0) {
+			unsigned xcr0Lo, xcr0Hi;
+			__asm__ ("xgetbv" : "=a"(xcr0Lo), "=d"(xcr0Hi) : "c"(0));
+			osAvx = (xcr0Lo & 6) == 6;
+		}
+		ret |= (osAvx && __get_cpuid_count(7, 0, &a, &b, &c, &d) && (b & bit_AVX2) != 0) ? CpuFeature_Avx2 : 0; // fails if leaf 7 isn't supported
+	#endif
+	return ret;
+}
+
+apt::internal::CpuFeatures apt::internal::GetCpuFeatures()
+{
+	static CpuFeatures s_features = DetectCpuFeatures();
+	return s_features;
+}
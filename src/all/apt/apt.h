@@ -61,6 +61,29 @@ namespace apt { namespace internal {
 AssertBehavior AssertAndCallback(const char* _expr, const char* _file, int _line, const char* _msg, ...);
 const char* StripPath(const char* _path);
 
+enum CpuFeature_
+{
+	CpuFeature_Sse41 = 1 << 0,
+	CpuFeature_Sse42 = 1 << 1,
+	CpuFeature_Avx2  = 1 << 2, // includes OS support for the AVX state
+};
+typedef int CpuFeatures;
+
+// Return the instruction set extensions supported by the CPU (detected on the first call).
+CpuFeatures GetCpuFeatures();
+
+// Enable an instruction set for a single function, call only if supported (see GetCpuFeatures()). MSVC doesn't require
+// the target to be enabled.
+#if APT_COMPILER_GNU
+	#define APT_TARGET_SSE41 __attribute__((target("sse4.1")))
+	#define APT_TARGET_SSE42 __attribute__((target("sse4.2")))
+	#define APT_TARGET_AVX2  __attribute__((target("avx2")))
+#else
+	#define APT_TARGET_SSE41
+	#define APT_TARGET_SSE42
+	#define APT_TARGET_AVX2
+#endif
+
 template <typename tType, unsigned kCount>
 inline constexpr unsigned ArrayCount(const tType (&)[kCount]) { return kCount; }
 
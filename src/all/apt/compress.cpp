@@ -1,23 +1,840 @@
 #include <apt/compress.h>
 
+#include <apt/hash.h>
+#include <apt/log.h>
+#include <apt/math.h>
+#include <apt/memory.h>
+
+#include <EASTL/algorithm.h>
+#include <EASTL/sort.h>
+#include <EASTL/vector.h>
+
 #define MINIZ_IMPL
+#define MINIZ_NO_ZLIB_COMPATIBLE_NAMES
 #include <miniz.h>
 
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
 using namespace apt;
 
-void apt::Compress(const void* _in, uint _inSizeBytes, void*& out_, uint& outSizeBytes_, CompressionFlags _flags)
+static const int kCodecMask = 0xf;
+
+static int GetTdeflFlags(CompressionFlags _flags)
+{
+	int ret = TDEFL_WRITE_ZLIB_HEADER;
+	if ((_flags & kCodecMask) == CompressionFlags_Speed) {
+		ret |= TDEFL_GREEDY_PARSING_FLAG | 1; // 1 probe + greedy parsing selects the fast path in tdefl_compress()
+	} else {
+		ret |= TDEFL_DEFAULT_MAX_PROBES; // the low bits are the probe count, 0 = huffman only
+	}
+	return ret;
+}
+
+// Return a per-thread compressor, avoids allocating ~300kb per call.
+static tdefl_compressor* GetDeflator()
+{
+	struct DeflatorCache
+	{
+		tdefl_compressor* m_deflator = nullptr;
+		~DeflatorCache() { APT_FREE(m_deflator); }
+	};
+	thread_local DeflatorCache s_cache;
+	if (!s_cache.m_deflator) {
+		s_cache.m_deflator = (tdefl_compressor*)APT_MALLOC(sizeof(tdefl_compressor));
+	}
+	return s_cache.m_deflator;
+}
+
+/*	LZ format (CompressionFlags_Fast):
+
+	  LzHeader
+	  ...                   LZ4 block format sequences
+
+	Each sequence is a token (4 bits literal length, 4 bits match length - kLzMinMatch), optional literal length bytes, literals, a 
+	16 bit match offset and optional match length bytes. The last sequence contains only literals. See 
+	https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md.
+*/
+namespace {
+
+struct LzHeader
+{
+	uint8  m_magic[4];
+	uint32 m_rawSize;
+};
+const uint8 kLzMagic[4] = { 'a', 'p', 't', 'L' };
+
+const uint kLzMinMatch     = 4;
+const uint kLzLastLiterals = 5;     // the last 5 bytes are always literals
+const uint kLzMfLimit      = 12;    // the last match must start at least 12 bytes before the end
+const uint kLzMaxOffset    = 65535;
+const uint kLzHashLog      = 12;
+
+bool IsLzFormat(const void* _in, uint64 _inSizeBytes)
+{
+	return _inSizeBytes >= sizeof(LzHeader) && memcmp(_in, kLzMagic, sizeof(kLzMagic)) == 0;
+}
+
+inline uint32 LzRead32(const uint8* _p)
+{
+	uint32 ret;
+	memcpy(&ret, _p, sizeof(ret));
+	return ret;
+}
+
+inline uint64 LzRead64(const uint8* _p)
+{
+	uint64 ret;
+	memcpy(&ret, _p, sizeof(ret));
+	return ret;
+}
+
+inline uint LzHash(uint32 _v)
+{
+	return (_v * 2654435761u) >> (32 - kLzHashLog);
+}
+
+inline uint8* LzWriteLength(uint8* _out, uint _len)
+{
+	for (; _len >= 255; _len -= 255) {
+		*_out++ = 255;
+	}
+	*_out++ = (uint8)_len;
+	return _out;
+}
+
+// Fill _table_ with the positions of _in (see LzCompress()).
+void LzInitTable(const uint8* _in, uint _inSize, uint32* _table_)
+{
+	for (uint i = 0; i + sizeof(uint32) <= _inSize; ++i) {
+		_table_[LzHash(LzRead32(_in + i))] = i;
+	}
+}
+
+// Write LZ sequences for _in to out_. Return the size of the compressed data, or 0 if _outCapacity was insufficient.
+// If _historySize is non-zero, the first _historySize bytes of _in are a dictionary and aren't written, _historyTable contains
+// the positions of the dictionary (see LzInitTable()).
+uint LzCompress(const uint8* _in, uint _inSize, uint8* out_, uint _outCapacity, uint _historySize = 0, const uint32* _historyTable = nullptr)
+{
+	const uint8* ip     = _in + _historySize;
+	const uint8* iend   = _in + _inSize;
+	const uint8* anchor = ip; // start of pending literals
+	uint8*       op     = out_;
+	uint8*       oend   = out_ + _outCapacity;
+
+	if (iend - ip > (ptrdiff_t)kLzMfLimit) {
+		const uint8* mflimit    = iend - kLzMfLimit;
+		const uint8* matchlimit = iend - kLzLastLiterals;
+		uint32 table[1 << kLzHashLog]; // input offsets
+		if (_historyTable) {
+			memcpy(table, _historyTable, sizeof(table));
+		} else {
+			memset(table, 0, sizeof(table));
+			++ip;
+		}
+		while (ip < mflimit) {
+		 // find a match, skip faster through incompressible data
+			const uint8* match;
+			uint searchCount = 1 << 6;
+			for (;;) {
+				uint h = LzHash(LzRead32(ip));
+				match = _in + table[h];
+				table[h] = (uint32)(ip - _in);
+				if ((uint)(ip - match) <= kLzMaxOffset && LzRead32(match) == LzRead32(ip)) {
+					break;
+				}
+				ip += searchCount++ >> 6;
+				if (ip >= mflimit) {
+					goto LastLiterals;
+				}
+			}
+
+		 // extend the match backward and forward
+			while (ip > anchor && match > _in && ip[-1] == match[-1]) {
+				--ip;
+				--match;
+			}
+			const uint8* mp = ip + kLzMinMatch;
+			const uint8* ms = match + kLzMinMatch;
+			while (mp + 8 <= matchlimit && LzRead64(mp) == LzRead64(ms)) {
+				mp += 8;
+				ms += 8;
+			}
+			while (mp < matchlimit && *mp == *ms) {
+				++mp;
+				++ms;
+			}
+
+		 // write the sequence
+			uint litLen   = (uint)(ip - anchor);
+			uint matchLen = (uint)(mp - ip) - kLzMinMatch;
+			if ((uint)(oend - op) < 1 + litLen / 255 + 1 + litLen + 2 + matchLen / 255 + 1) {
+				return 0;
+			}
+			uint8* token = op++;
+			*token = (uint8)((litLen >= 15 ? 15 : litLen) << 4);
+			if (litLen >= 15) {
+				op = LzWriteLength(op, litLen - 15);
+			}
+			memcpy(op, anchor, litLen);
+			op += litLen;
+			uint offset = (uint)(ip - match);
+			*op++ = (uint8)offset;
+			*op++ = (uint8)(offset >> 8);
+			*token |= (uint8)(matchLen >= 15 ? 15 : matchLen);
+			if (matchLen >= 15) {
+				op = LzWriteLength(op, matchLen - 15);
+			}
+
+			ip = anchor = mp;
+			if (ip < mflimit) {
+				table[LzHash(LzRead32(ip - 2))] = (uint32)(ip - 2 - _in);
+			}
+		}
+	}
+
+LastLiterals:
+	uint litLen = (uint)(iend - anchor);
+	if ((uint)(oend - op) < 1 + litLen / 255 + 1 + litLen) {
+		return 0;
+	}
+	*op++ = (uint8)((litLen >= 15 ? 15 : litLen) << 4);
+	if (litLen >= 15) {
+		op = LzWriteLength(op, litLen - 15);
+	}
+	memcpy(op, anchor, litLen);
+	op += litLen;
+	return (uint)(op - out_);
+}
+
+// Decode LZ sequences from _in to out_, which must be exactly _outSize. Matches may reference the last _dictSize bytes of _dict.
+// Return false if _in is invalid.
+bool LzDecompress(const uint8* _in, uint _inSize, uint8* out_, uint _outSize, const uint8* _dict = nullptr, uint _dictSize = 0)
+{
+	const uint8* ip   = _in;
+	const uint8* iend = _in + _inSize;
+	uint8*       op   = out_;
+	uint8*       oend = out_ + _outSize;
+
+	for (;;) {
+		if (ip >= iend) {
+			return false;
+		}
+		uint token = *ip++;
+		uint litLen = token >> 4;
+
+	 // fast path for short sequences, requires enough input/output to copy without bounds checks
+		if (litLen != 15 && iend - ip >= 32 && oend - op >= 32) {
+			memcpy(op, ip, 16);
+			op += litLen;
+			ip += litLen;
+			uint offset = (uint)ip[0] | ((uint)ip[1] << 8);
+			uint matchLen = token & 15;
+			if (matchLen != 15 && offset >= 8 && offset <= (uint)(op - out_)) {
+				const uint8* match = op - offset;
+				ip += 2;
+				memcpy(op,      match,      8);
+				memcpy(op + 8,  match + 8,  8);
+				memcpy(op + 16, match + 16, 2);
+				op += matchLen + kLzMinMatch;
+				continue;
+			}
+			goto Match; // long or overlapping match
+		}
+
+	 // literals
+		if (litLen == 15) {
+			uint8 b;
+			do {
+				if (ip >= iend) {
+					return false;
+				}
+				b = *ip++;
+				litLen += b;
+			} while (b == 255);
+		}
+		if ((uint)(iend - ip) < litLen || (uint)(oend - op) < litLen) {
+			return false;
+		}
+		if (litLen <= 16 && iend - ip >= 16 && oend - op >= 16) {
+			memcpy(op, ip, 16); // common case, short literal run
+		} else {
+			memcpy(op, ip, litLen);
+		}
+		ip += litLen;
+		op += litLen;
+		if (ip == iend) {
+			return op == oend; // last sequence
+		}
+
+	 // match
+	Match:
+		if (iend - ip < 2) {
+			return false;
+		}
+		uint offset = (uint)ip[0] | ((uint)ip[1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > (uint)(op - out_) + _dictSize) {
+			return false;
+		}
+		uint matchLen = token & 15;
+		if (matchLen == 15) {
+			uint8 b;
+			do {
+				if (ip >= iend) {
+					return false;
+				}
+				b = *ip++;
+				matchLen += b;
+			} while (b == 255);
+		}
+		matchLen += kLzMinMatch;
+		if ((uint)(oend - op) < matchLen) {
+			return false;
+		}
+		if (offset > (uint)(op - out_)) {
+		 // match starts in the dictionary, copy up to the end of the dictionary and continue from the start of out_
+			uint dictOffset = offset - (uint)(op - out_);
+			uint n = dictOffset < matchLen ? dictOffset : matchLen;
+			memcpy(op, _dict + _dictSize - dictOffset, n);
+			op += n;
+			matchLen -= n;
+			if (matchLen == 0) {
+				continue;
+			}
+		}
+		const uint8* match = op - offset;
+		uint8* mend = op + matchLen;
+		if ((uint)(oend - op) >= matchLen + 16) {
+		 // wild copy, may overwrite up to 15 bytes past mend
+			if (offset >= 16) {
+				do {
+					memcpy(op, match, 16);
+					op += 16;
+					match += 16;
+				} while (op < mend);
+			} else if (offset >= 8) {
+				do {
+					memcpy(op, match, 8);
+					op += 8;
+					match += 8;
+				} while (op < mend);
+			} else {
+				while (op < mend) {
+					*op++ = *match++;
+				}
+			}
+			op = mend;
+		} else {
+			while (op < mend) {
+				*op++ = *match++;
+			}
+		}
+	}
+}
+
+uint LzCompressBound(uint _inSize)
+{
+	return (uint)sizeof(LzHeader) + _inSize + _inSize / 255 + 16;
+}
+
+} // namespace
+
+/*	Dictionary format:
+
+	  DictHeader
+	  ...                   raw deflate or LZ data
+
+	Deflate has no preset dictionary mechanism; instead the dictionary is 'primed' by compressing it followed by a sync flush, the 
+	output up to the sync flush is discarded. The compressor and decompressor states after priming are stored by the dictionary
+	and copied before each compress/decompress call.
+*/
+struct CompressionDictionary::Impl
+{
+	uint32               m_id;
+	eastl::vector<uint8> m_data;
+	tdefl_compressor*    m_deflator[2];                // compressor state after priming (CompressionFlags_Speed, _Size)
+	tinfl_decompressor   m_inflator[2];                // decompressor state after priming
+	uint32               m_lzTable[1 << kLzHashLog];   // LZ positions in m_data
+};
+
+namespace {
+
+struct DictHeader
+{
+	uint8  m_magic[4];
+	uint32 m_dictId;
+	uint32 m_rawSize;
+	uint32 m_codec;
+};
+const uint8 kDictMagic[4] = { 'a', 'p', 't', 'D' };
+
+bool IsDictFormat(const void* _in, uint64 _inSizeBytes)
+{
+	return _inSizeBytes >= sizeof(DictHeader) && memcmp(_in, kDictMagic, sizeof(kDictMagic)) == 0;
+}
+
+// Index into CompressionDictionary::Impl::m_deflator/m_inflator.
+int GetDictDeflateIndex(CompressionFlags _flags)
+{
+	return (_flags & kCodecMask) == CompressionFlags_Speed ? 0 : 1;
+}
+
+// Copy the state of a primed compressor. The LZ code and output buffers are empty after a flush and aren't copied.
+void CopyDeflator(tdefl_compressor* dst_, const tdefl_compressor* _src)
+{
+	memcpy(dst_, _src, offsetof(tdefl_compressor, m_lz_code_buf) + 1);
+	memcpy(dst_->m_next, _src->m_next, offsetof(tdefl_compressor, m_output_buf) - offsetof(tdefl_compressor, m_next));
+	
+ // pointers into _src need to be rebased
+	mz_uint8** ptrs[] = { &dst_->m_pLZ_code_buf, &dst_->m_pLZ_flags, &dst_->m_pOutput_buf, &dst_->m_pOutput_buf_end };
+	for (mz_uint8** ptr : ptrs) {
+		if (*ptr >= (const mz_uint8*)_src && *ptr <= (const mz_uint8*)(_src + 1)) {
+			*ptr = (mz_uint8*)dst_ + (*ptr - (const mz_uint8*)_src);
+		}
+	}
+}
+
+// Per-thread scratch buffer.
+uint8* GetScratch(uint _sizeBytes)
+{
+	thread_local eastl::vector<uint8> s_scratch;
+	if (s_scratch.size() < _sizeBytes) {
+		s_scratch.resize(_sizeBytes);
+	}
+	return s_scratch.data();
+}
+
+// Compress to out_ with the codec specified by _flags and optionally a dictionary. Return the size of the compressed data, or 0 if 
+// _outCapacity was insufficient. If _deflator is null a per-thread compressor is used.
+uint CompressImpl(const void* _in, uint _inSize, void* out_, uint _outCapacity, CompressionFlags _flags, tdefl_compressor* _deflator, const CompressionDictionary* _dict = nullptr)
+{
+	uint8* out = (uint8*)out_;
+	uint headerSize = 0;
+	if (_dict) {
+		headerSize = (uint)sizeof(DictHeader);
+		if (_outCapacity < headerSize) {
+			return 0;
+		}
+		DictHeader header; // out_ may be unaligned
+		memcpy(header.m_magic, kDictMagic, sizeof(kDictMagic));
+		header.m_dictId  = _dict->getId();
+		header.m_rawSize = _inSize;
+		header.m_codec   = _flags & kCodecMask;
+		memcpy(out, &header, sizeof(DictHeader));
+	} else if ((_flags & kCodecMask) == CompressionFlags_Fast) {
+		headerSize = (uint)sizeof(LzHeader);
+		if (_outCapacity < headerSize) {
+			return 0;
+		}
+		LzHeader header;
+		memcpy(header.m_magic, kLzMagic, sizeof(kLzMagic));
+		header.m_rawSize = _inSize;
+		memcpy(out, &header, sizeof(LzHeader));
+	}
+	out += headerSize;
+	_outCapacity -= headerSize;
+
+	uint ret = 0;
+	if ((_flags & kCodecMask) == CompressionFlags_Fast) {
+		if (_dict) {
+		 // the LZ compressor requires the dictionary and input to be contiguous
+			const CompressionDictionary::Impl* dict = _dict->getImpl();
+			uint dictSize = (uint)dict->m_data.size();
+			uint8* scratch = GetScratch(dictSize + _inSize);
+			memcpy(scratch, dict->m_data.data(), dictSize);
+			memcpy(scratch + dictSize, _in, _inSize);
+			ret = LzCompress(scratch, dictSize + _inSize, out, _outCapacity, dictSize, dict->m_lzTable);
+		} else {
+			ret = LzCompress((const uint8*)_in, _inSize, out, _outCapacity);
+		}
+
+	} else {
+		if (!_deflator) {
+			_deflator = GetDeflator();
+		}
+		if (_dict) {
+			CopyDeflator(_deflator, _dict->getImpl()->m_deflator[GetDictDeflateIndex(_flags)]);
+		} else {
+			tdefl_init(_deflator, nullptr, nullptr, GetTdeflFlags(_flags));
+		}
+		size_t inSize  = _inSize;
+		size_t outSize = _outCapacity;
+		if (tdefl_compress(_deflator, _in, &inSize, out, &outSize, TDEFL_FINISH) == TDEFL_STATUS_DONE) {
+			ret = (uint)outSize;
+		}
+	}
+
+	return ret ? ret + headerSize : 0;
+}
+
+// Decompress to out_, the codec is detected from the stream header. Return false if _outCapacity was insufficient or if _in is invalid.
+bool DecompressImpl(const void* _in, uint _inSize, void* out_, uint _outCapacity, uint& outSize_)
+{
+	if (IsDictFormat(_in, _inSize)) {
+		DictHeader header; // _in may be unaligned
+		memcpy(&header, _in, sizeof(DictHeader));
+		if (header.m_rawSize > _outCapacity) {
+			return false;
+		}
+		const CompressionDictionary* dict = CompressionDictionary::Find(header.m_dictId);
+		if (!dict) {
+			APT_LOG_ERR("Decompress: dictionary %08x not found", header.m_dictId);
+			return false;
+		}
+		const CompressionDictionary::Impl* impl = dict->getImpl();
+		const uint8* in = (const uint8*)_in + sizeof(DictHeader);
+		uint inSize = _inSize - (uint)sizeof(DictHeader);
+		uint dictSize = (uint)impl->m_data.size();
+		if (header.m_codec == CompressionFlags_Fast) {
+			if (!LzDecompress(in, inSize, (uint8*)out_, header.m_rawSize, impl->m_data.data(), dictSize)) {
+				return false;
+			}
+		} else {
+		 // decompress after the dictionary in a scratch buffer
+			uint8* scratch = GetScratch(dictSize + header.m_rawSize);
+			memcpy(scratch, impl->m_data.data(), dictSize);
+			tinfl_decompressor inflator = impl->m_inflator[GetDictDeflateIndex((CompressionFlags)header.m_codec)];
+			size_t inSizeBytes  = inSize;
+			size_t outSizeBytes = header.m_rawSize;
+			tinfl_status status = tinfl_decompress(&inflator, in, &inSizeBytes, scratch, scratch + dictSize, &outSizeBytes, TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
+			if (status != TINFL_STATUS_DONE || outSizeBytes != header.m_rawSize) {
+				return false;
+			}
+			memcpy(out_, scratch + dictSize, header.m_rawSize);
+		}
+		outSize_ = header.m_rawSize;
+		return true;
+	}
+
+	if (IsLzFormat(_in, _inSize)) {
+		LzHeader header; // _in may be unaligned
+		memcpy(&header, _in, sizeof(LzHeader));
+		if (header.m_rawSize > _outCapacity) {
+			return false;
+		}
+		if (!LzDecompress((const uint8*)_in + sizeof(LzHeader), _inSize - (uint)sizeof(LzHeader), (uint8*)out_, header.m_rawSize)) {
+			return false;
+		}
+		outSize_ = header.m_rawSize;
+		return true;
+	}
+
+	size_t outSize = tinfl_decompress_mem_to_mem(out_, _outCapacity, _in, _inSize, TINFL_FLAG_PARSE_ZLIB_HEADER);
+	if (outSize == TINFL_DECOMPRESS_MEM_TO_MEM_FAILED) {
+		return false;
+	}
+	outSize_ = (uint)outSize;
+	return true;
+}
+
+// If the raw size is stored in the header of _in, write it to rawSize_ and return true.
+bool GetRawSize(const void* _in, uint _inSize, uint& rawSize_)
+{
+	if (IsDictFormat(_in, _inSize)) {
+		DictHeader header;
+		memcpy(&header, _in, sizeof(DictHeader));
+		rawSize_ = header.m_rawSize;
+		return true;
+	}
+	if (IsLzFormat(_in, _inSize)) {
+		LzHeader header;
+		memcpy(&header, _in, sizeof(LzHeader));
+		rawSize_ = header.m_rawSize;
+		return true;
+	}
+	return false;
+}
+
+} // namespace
+
+/*	Block format:
+	
+	  BlockHeader
+	  uint64[blockCount]    block end offsets (relative to the first block)
+	  ...                   block data
+
+	Each block is independently compressed with the codec specified by the flags, or raw data if the block was incompressible 
+	(compressed size == uncompressed size).
+*/
+namespace {
+
+struct BlockHeader
+{
+	uint8  m_magic[4];
+	uint32 m_blockSize;  // uncompressed block size (the last block may be smaller)
+	uint64 m_rawSize;    // total uncompressed size
+};
+const uint8 kBlockMagic[4] = { 'a', 'p', 't', 'B' };
+
+bool IsBlockFormat(const void* _in, uint64 _inSizeBytes)
+{
+	return _inSizeBytes >= sizeof(BlockHeader) && memcmp(_in, kBlockMagic, sizeof(kBlockMagic)) == 0;
+}
+
+// Call _func(_index, _threadIndex) for _index in [0, _count) on up to _threadCount threads (0 = 1 per hardware thread).
+template <typename tFunc>
+void ParallelFor(uint _count, uint _threadCount, tFunc&& _func)
+{
+	if (_threadCount == 0) {
+		_threadCount = APT_MAX(std::thread::hardware_concurrency(), 1u);
+	}
+	_threadCount = APT_MIN(_threadCount, _count);
+	std::atomic<uint> next(0);
+	auto worker = [&](uint _threadIndex) {
+		for (uint i = next++; i < _count; i = next++) {
+			_func(i, _threadIndex);
+		}
+	};
+	eastl::vector<std::thread> threads;
+	for (uint i = 1; i < _threadCount; ++i) {
+		threads.push_back(std::thread(worker, i));
+	}
+	worker(0); // calling thread does some of the work
+	for (auto& thread : threads) {
+		thread.join();
+	}
+}
+
+struct BlockReader
+{
+	const BlockHeader* m_header;
+	const uint64*      m_blockEnd;
+	const uint8*       m_blockData;
+	uint64             m_blockDataSize;
+	uint               m_blockCount;
+
+	bool init(const void* _in, uint64 _inSizeBytes)
+	{
+		if (!IsBlockFormat(_in, _inSizeBytes)) {
+			return false;
+		}
+		m_header = (const BlockHeader*)_in;
+		if (m_header->m_blockSize == 0 || m_header->m_rawSize > (uint64)SIZE_MAX) {
+			return false;
+		}
+		uint64 blockCount = m_header->m_rawSize / m_header->m_blockSize + (m_header->m_rawSize % m_header->m_blockSize ? 1 : 0); // m_rawSize + m_blockSize - 1 may overflow
+		if (blockCount > UINT_MAX) {
+			return false;
+		}
+		uint64 indexSize = blockCount * sizeof(uint64);
+		if (_inSizeBytes - sizeof(BlockHeader) < indexSize) {
+			return false;
+		}
+		m_blockCount    = (uint)blockCount;
+		m_blockEnd      = (const uint64*)(m_header + 1);
+		m_blockData     = (const uint8*)m_blockEnd + indexSize;
+		m_blockDataSize = _inSizeBytes - sizeof(BlockHeader) - indexSize;
+		return true;
+	}
+
+	// Check that the block index is ordered and within the block data, and that each block's size is plausible for its raw size
+	// (such that a corrupt header can't cause a huge allocation).
+	bool validate() const
+	{
+		const uint64 kMaxRatio = 1032; // deflate's limit, the LZ codec's is lower
+		uint64 beg = 0;
+		for (uint i = 0; i < m_blockCount; ++i) {
+			uint64 end = m_blockEnd[i];
+			uint64 rawSize = APT_MIN(m_header->m_rawSize - (uint64)i * m_header->m_blockSize, (uint64)m_header->m_blockSize);
+			if (end < beg || end > m_blockDataSize || end - beg > rawSize || (end - beg) * kMaxRatio < rawSize) {
+				return false;
+			}
+			beg = end;
+		}
+		return true;
+	}
+
+	bool decompress(uint _blockIndex, void* out_, uint& outSizeBytes_) const
+	{
+		if (_blockIndex >= m_blockCount) {
+			return false;
+		}
+		uint64 beg = _blockIndex == 0 ? 0 : m_blockEnd[_blockIndex - 1];
+		uint64 end = m_blockEnd[_blockIndex];
+		uint64 rawOffset = (uint64)_blockIndex * m_header->m_blockSize;
+		uint rawSize = (uint)(m_header->m_rawSize - rawOffset < m_header->m_blockSize ? m_header->m_rawSize - rawOffset : m_header->m_blockSize);
+		if (beg > end || end > m_blockDataSize || end - beg > rawSize) {
+			return false;
+		}
+		uint64 size = end - beg;
+		if (size == rawSize) {
+			memcpy(out_, m_blockData + beg, rawSize);
+		} else {
+			uint outSize;
+			if (!DecompressImpl(m_blockData + beg, (uint)size, out_, rawSize, outSize) || outSize != rawSize) {
+				return false;
+			}
+		}
+		outSizeBytes_ = rawSize;
+		return true;
+	}
+
+	// Decompress all blocks to out_, which must be at least m_header->m_rawSize bytes.
+	bool decompressAll(void* out_, uint _threadCount) const
+	{
+		std::atomic<bool> ret(true);
+		ParallelFor(m_blockCount, _threadCount, 
+			[&](uint _blockIndex, uint _threadIndex) {
+				uint blockSize;
+				if (!decompress(_blockIndex, (uint8*)out_ + (uint64)_blockIndex * m_header->m_blockSize, blockSize)) {
+					ret = false;
+				}
+			});
+		return ret;
+	}
+};
+
+struct BlockWriter
+{
+	struct Block { void* m_data; uint m_size; };
+	eastl::vector<Block> m_blocks;
+	uint                 m_blockSize;
+	uint64               m_rawSize;
+	uint64               m_outSize;  // total size of the block format data, valid after compress()
+
+	~BlockWriter()
+	{
+		for (auto& block : m_blocks) {
+			free(block.m_data);
+		}
+	}
+
+	void compress(const void* _in, uint64 _inSizeBytes, CompressionFlags _flags, uint _blockSizeBytes, uint _threadCount)
+	{
+		APT_ASSERT(_blockSizeBytes > 0);
+		uint64 blockCount = (_inSizeBytes + _blockSizeBytes - 1) / _blockSizeBytes;
+		APT_ASSERT(blockCount <= UINT_MAX);
+		if (_threadCount == 0) {
+			_threadCount = APT_MAX(std::thread::hardware_concurrency(), 1u);
+		}
+		_threadCount = APT_MIN(_threadCount, (uint)blockCount);
+		m_blocks.resize((uint)blockCount);
+		m_blockSize = _blockSizeBytes;
+		m_rawSize = _inSizeBytes;
+
+		eastl::vector<uint8*> scratch(_threadCount);
+		for (uint i = 0; i < _threadCount; ++i) {
+			scratch[i] = (uint8*)APT_MALLOC(_blockSizeBytes);
+		}
+		ParallelFor((uint)blockCount, _threadCount, 
+			[&](uint _blockIndex, uint _threadIndex) {
+				const uint8* in = (const uint8*)_in + (uint64)_blockIndex * _blockSizeBytes;
+				uint inSize = (uint)APT_MIN(_inSizeBytes - (uint64)_blockIndex * _blockSizeBytes, (uint64)_blockSizeBytes);
+			
+			 // compress to scratch, the block is stored raw if it didn't fit (i.e. if it didn't compress)
+				uint outSize = CompressImpl(in, inSize, scratch[_threadIndex], inSize - 1, _flags, nullptr);
+				bool compressed = outSize > 0;
+				Block& block = m_blocks[_blockIndex];
+				block.m_size = compressed ? outSize : inSize;
+				block.m_data = malloc(block.m_size);
+				memcpy(block.m_data, compressed ? scratch[_threadIndex] : in, block.m_size);
+			});
+		for (uint i = 0; i < _threadCount; ++i) {
+			APT_FREE(scratch[i]);
+		}
+
+		m_outSize = sizeof(BlockHeader) + blockCount * sizeof(uint64);
+		for (auto& block : m_blocks) {
+			m_outSize += block.m_size;
+		}
+	}
+
+	// Write m_outSize bytes to out_.
+	void write(void* out_)
+	{
+		BlockHeader* header = (BlockHeader*)out_;
+		memcpy(header->m_magic, kBlockMagic, sizeof(kBlockMagic));
+		header->m_blockSize = m_blockSize;
+		header->m_rawSize   = m_rawSize;
+		uint64* blockEnd = (uint64*)(header + 1);
+		uint8* data = (uint8*)(blockEnd + m_blocks.size());
+		uint64 offset = 0;
+		for (uint i = 0; i < (uint)m_blocks.size(); ++i) {
+			memcpy(data + offset, m_blocks[i].m_data, m_blocks[i].m_size);
+			offset += m_blocks[i].m_size;
+			blockEnd[i] = offset;
+		}
+	}
+};
+
+} // namespace
+
+uint apt::CompressBound(uint _inSizeBytes, CompressionFlags _flags)
+{
+	if (_flags & CompressionFlags_Parallel) {
+		uint blockCount = (_inSizeBytes + kCompressBlockSizeDefault - 1) / kCompressBlockSizeDefault;
+		return (uint)sizeof(BlockHeader) + blockCount * (uint)sizeof(uint64) + _inSizeBytes; // incompressible blocks are stored raw
+	}
+	if ((_flags & kCodecMask) == CompressionFlags_Fast) {
+		return LzCompressBound(_inSizeBytes);
+	}
+	return (uint)mz_compressBound(_inSizeBytes); // sufficient for DictHeader + raw deflate
+}
+
+static const CompressionDictionary* FindDictionary(uint32 _dictionaryId)
+{
+	if (_dictionaryId == 0) {
+		return nullptr;
+	}
+	const CompressionDictionary* ret = CompressionDictionary::Find(_dictionaryId);
+	APT_ASSERT_MSG(ret, "Compress: dictionary %08x not found", _dictionaryId);
+	return ret;
+}
+
+void apt::Compress(const void* _in, uint _inSizeBytes, void*& out_, uint& outSizeBytes_, CompressionFlags _flags, uint32 _dictionaryId)
 {
 	APT_ASSERT(_in);
 	APT_ASSERT(_inSizeBytes);
 	APT_ASSERT(!out_);
 	APT_ASSERT(_flags != CompressionFlags_None); // the calling code should skip calling Compress in this case
 
-	int tdeflFlags = TDEFL_WRITE_ZLIB_HEADER;
-	if (_flags & CompressionFlags_Speed) {
-		tdeflFlags |= TDEFL_GREEDY_PARSING_FLAG;
+	if (_flags & CompressionFlags_Parallel) {
+		APT_ASSERT(_dictionaryId == 0); // block format doesn't support dictionaries
+		uint64 outSizeBytes = 0;
+		CompressBlocks(_in, _inSizeBytes, out_, outSizeBytes, _flags, kCompressBlockSizeDefault);
+		APT_ASSERT(outSizeBytes <= UINT_MAX);
+		outSizeBytes_ = (uint)outSizeBytes;
+		return;
 	}
-	out_ = tdefl_compress_mem_to_heap(_in, _inSizeBytes, &outSizeBytes_, tdeflFlags);
+
+	uint capacity = CompressBound(_inSizeBytes, _flags);
+	out_ = malloc(capacity);
 	APT_ASSERT(out_);
+	outSizeBytes_ = CompressImpl(_in, _inSizeBytes, out_, capacity, _flags, nullptr, FindDictionary(_dictionaryId));
+	APT_ASSERT(outSizeBytes_);
+	out_ = realloc(out_, outSizeBytes_);
+}
+
+bool apt::Compress(const void* _in, uint _inSizeBytes, void* out_, uint _outCapacityBytes, uint& outSizeBytes_, CompressionFlags _flags, uint32 _dictionaryId)
+{
+	APT_ASSERT(_in);
+	APT_ASSERT(_inSizeBytes);
+	APT_ASSERT(out_);
+	APT_ASSERT(_flags != CompressionFlags_None); // the calling code should skip calling Compress in this case
+
+	if (_flags & CompressionFlags_Parallel) {
+		APT_ASSERT(_dictionaryId == 0); // block format doesn't support dictionaries
+		BlockWriter writer;
+		writer.compress(_in, _inSizeBytes, _flags, kCompressBlockSizeDefault, 0);
+		if (writer.m_outSize > _outCapacityBytes) {
+			return false;
+		}
+		writer.write(out_);
+		outSizeBytes_ = (uint)writer.m_outSize;
+		return true;
+	}
+
+	uint outSizeBytes = CompressImpl(_in, _inSizeBytes, out_, _outCapacityBytes, _flags, nullptr, FindDictionary(_dictionaryId));
+	if (outSizeBytes == 0) {
+		return false;
+	}
+	outSizeBytes_ = outSizeBytes;
+	return true;
 }
 
 void apt::Decompress(const void* _in, uint _inSizeBytes, void*& out_, uint& outSizeBytes_)
@@ -26,7 +843,446 @@ void apt::Decompress(const void* _in, uint _inSizeBytes, void*& out_, uint& outS
 	APT_ASSERT(_inSizeBytes);
 	APT_ASSERT(!out_);
 
+	if (IsBlockFormat(_in, _inSizeBytes)) {
+		uint64 outSizeBytes = 0;
+		APT_VERIFY(DecompressBlocks(_in, _inSizeBytes, out_, outSizeBytes));
+		APT_ASSERT(outSizeBytes <= UINT_MAX);
+		outSizeBytes_ = (uint)outSizeBytes;
+		return;
+	}
+
+	uint rawSize;
+	if (GetRawSize(_in, _inSizeBytes, rawSize)) {
+		out_ = malloc(rawSize ? rawSize : 1);
+		APT_ASSERT(out_);
+		APT_VERIFY(DecompressImpl(_in, _inSizeBytes, out_, rawSize, outSizeBytes_));
+		return;
+	}
+
 	int tinflFlags = TINFL_FLAG_PARSE_ZLIB_HEADER;
-	out_ = tinfl_decompress_mem_to_heap(_in, _inSizeBytes, &outSizeBytes_, tinflFlags);
+	size_t outSizeBytes = 0;
+	out_ = tinfl_decompress_mem_to_heap(_in, _inSizeBytes, &outSizeBytes, tinflFlags);
+	outSizeBytes_ = (uint)outSizeBytes;
 	APT_ASSERT(out_);
 }
+
+bool apt::Decompress(const void* _in, uint _inSizeBytes, void* out_, uint _outCapacityBytes, uint& outSizeBytes_)
+{
+	APT_ASSERT(_in);
+	APT_ASSERT(_inSizeBytes);
+	APT_ASSERT(out_);
+
+	if (IsBlockFormat(_in, _inSizeBytes)) {
+		BlockReader reader;
+		if (!reader.init(_in, _inSizeBytes) || reader.m_header->m_rawSize > _outCapacityBytes) {
+			return false;
+		}
+		if (!reader.decompressAll(out_, 0)) {
+			return false;
+		}
+		outSizeBytes_ = (uint)reader.m_header->m_rawSize;
+		return true;
+	}
+
+	return DecompressImpl(_in, _inSizeBytes, out_, _outCapacityBytes, outSizeBytes_);
+}
+
+/*******************************************************************************
+
+                                 Compressor
+
+*******************************************************************************/
+
+struct Compressor::Impl
+{
+	tdefl_compressor m_deflator;
+	bool             m_done;
+};
+
+Compressor::Compressor(CompressionFlags _flags)
+{
+	m_impl = APT_NEW(Impl);
+	reset(_flags);
+}
+
+Compressor::~Compressor()
+{
+	APT_DELETE(m_impl);
+}
+
+void Compressor::reset(CompressionFlags _flags)
+{
+	APT_ASSERT(_flags != CompressionFlags_None);
+	APT_ASSERT(_flags == CompressionFlags_Speed || _flags == CompressionFlags_Size); // deflate only
+	tdefl_init(&m_impl->m_deflator, nullptr, nullptr, GetTdeflFlags(_flags));
+	m_impl->m_done = false;
+}
+
+CompressionStatus Compressor::compress(const void* _in, uint& _inSizeBytes_, void* out_, uint& _outSizeBytes_, bool _finish)
+{
+	if (m_impl->m_done) {
+		_inSizeBytes_ = _outSizeBytes_ = 0;
+		return CompressionStatus_Done;
+	}
+
+	size_t inSizeBytes  = _inSizeBytes_;
+	size_t outSizeBytes = _outSizeBytes_;
+	tdefl_status status = tdefl_compress(&m_impl->m_deflator, _in, &inSizeBytes, out_, &outSizeBytes, _finish ? TDEFL_FINISH : TDEFL_NO_FLUSH);
+	_inSizeBytes_  = (uint)inSizeBytes;
+	_outSizeBytes_ = (uint)outSizeBytes;
+	
+	switch (status) {
+		case TDEFL_STATUS_OKAY: 
+			return CompressionStatus_Continue;
+		case TDEFL_STATUS_DONE:
+			m_impl->m_done = true;
+			return CompressionStatus_Done;
+		default:
+			APT_LOG_ERR("Compressor: error %d", (int)status);
+			return CompressionStatus_Error;
+	}
+}
+
+/*******************************************************************************
+
+                                Decompressor
+
+*******************************************************************************/
+
+struct Decompressor::Impl
+{
+	tinfl_decompressor m_inflator;
+	tinfl_status       m_status;
+	uint               m_dictOffset;                // start of the pending output in m_dict
+	uint               m_dictAvail;                 // size of the pending output in m_dict
+	uint8              m_dict[TINFL_LZ_DICT_SIZE];  // circular output buffer, holds the decompression window
+};
+
+Decompressor::Decompressor()
+{
+	m_impl = APT_NEW(Impl);
+	reset();
+}
+
+Decompressor::~Decompressor()
+{
+	APT_DELETE(m_impl);
+}
+
+void Decompressor::reset()
+{
+	tinfl_init(&m_impl->m_inflator);
+	m_impl->m_status     = TINFL_STATUS_NEEDS_MORE_INPUT;
+	m_impl->m_dictOffset = 0;
+	m_impl->m_dictAvail  = 0;
+}
+
+CompressionStatus Decompressor::decompress(const void* _in, uint& _inSizeBytes_, void* out_, uint& _outSizeBytes_, bool _finish)
+{
+	const uint8* in  = (const uint8*)_in;
+	uint8*       out = (uint8*)out_;
+	uint inAvail  = _inSizeBytes_;
+	uint outAvail = _outSizeBytes_;
+	Impl& impl = *m_impl;
+
+	for (;;) {
+	 // copy pending output from the dictionary
+		uint n = impl.m_dictAvail < outAvail ? impl.m_dictAvail : outAvail;
+		if (n > 0) {
+			memcpy(out, impl.m_dict + impl.m_dictOffset, n);
+			out += n;
+			outAvail -= n;
+			impl.m_dictAvail -= n;
+			impl.m_dictOffset = (impl.m_dictOffset + n) & (TINFL_LZ_DICT_SIZE - 1);
+		}
+		if (impl.m_dictAvail > 0 || impl.m_status < 0 || impl.m_status == TINFL_STATUS_DONE) {
+			break; // output full, error or done
+		}
+
+	 // decompress into the dictionary
+		size_t inSizeBytes  = inAvail;
+		size_t outSizeBytes = TINFL_LZ_DICT_SIZE - impl.m_dictOffset;
+	 // without TINFL_FLAG_HAS_MORE_INPUT a truncated stream fails (TINFL_STATUS_FAILED_CANNOT_MAKE_PROGRESS) instead of waiting for input
+		impl.m_status = tinfl_decompress(&impl.m_inflator, in, &inSizeBytes, impl.m_dict, impl.m_dict + impl.m_dictOffset, &outSizeBytes, TINFL_FLAG_PARSE_ZLIB_HEADER | (_finish ? 0 : TINFL_FLAG_HAS_MORE_INPUT));
+		in += inSizeBytes;
+		inAvail -= (uint)inSizeBytes;
+		impl.m_dictAvail = (uint)outSizeBytes;
+		if (impl.m_status == TINFL_STATUS_NEEDS_MORE_INPUT && inSizeBytes == 0 && outSizeBytes == 0) {
+			break; // need more input
+		}
+	}
+
+	_inSizeBytes_  -= inAvail;
+	_outSizeBytes_ -= outAvail;
+	if (impl.m_status < 0) {
+		APT_LOG_ERR("Decompressor: error %d", (int)impl.m_status);
+		return CompressionStatus_Error;
+	}
+	if (impl.m_status == TINFL_STATUS_DONE && impl.m_dictAvail == 0) {
+		return CompressionStatus_Done;
+	}
+	return CompressionStatus_Continue;
+}
+
+/*******************************************************************************
+
+                              Block compression
+
+*******************************************************************************/
+
+void apt::CompressBlocks(const void* _in, uint64 _inSizeBytes, void*& out_, uint64& outSizeBytes_, CompressionFlags _flags, uint _blockSizeBytes, uint _threadCount)
+{
+	APT_ASSERT(_in);
+	APT_ASSERT(_inSizeBytes);
+	APT_ASSERT(!out_);
+	APT_ASSERT(_flags != CompressionFlags_None);
+
+	BlockWriter writer;
+	writer.compress(_in, _inSizeBytes, _flags, _blockSizeBytes, _threadCount);
+	out_ = malloc((size_t)writer.m_outSize);
+	APT_ASSERT(out_);
+	writer.write(out_);
+	outSizeBytes_ = writer.m_outSize;
+}
+
+bool apt::DecompressBlocks(const void* _in, uint64 _inSizeBytes, void*& out_, uint64& outSizeBytes_, uint _threadCount)
+{
+	APT_ASSERT(_in);
+	APT_ASSERT(!out_);
+
+	BlockReader reader;
+	if (!reader.init(_in, _inSizeBytes) || !reader.validate()) {
+		APT_LOG_ERR("DecompressBlocks: invalid header");
+		return false;
+	}
+	void* out = malloc((size_t)APT_MAX(reader.m_header->m_rawSize, (uint64)1));
+	if (!out) {
+		APT_LOG_ERR("DecompressBlocks: failed to allocate %llu bytes", (unsigned long long)reader.m_header->m_rawSize);
+		return false;
+	}
+	if (!reader.decompressAll(out, _threadCount)) {
+		APT_LOG_ERR("DecompressBlocks: invalid block data");
+		free(out);
+		return false;
+	}
+	out_ = out;
+	outSizeBytes_ = reader.m_header->m_rawSize;
+	return true;
+}
+
+bool apt::GetBlockInfo(const void* _in, uint64 _inSizeBytes, uint& blockCount_, uint& blockSizeBytes_, uint64& rawSizeBytes_)
+{
+	BlockReader reader;
+	if (!reader.init(_in, _inSizeBytes)) {
+		return false;
+	}
+	blockCount_     = reader.m_blockCount;
+	blockSizeBytes_ = reader.m_header->m_blockSize;
+	rawSizeBytes_   = reader.m_header->m_rawSize;
+	return true;
+}
+
+bool apt::DecompressBlock(const void* _in, uint64 _inSizeBytes, uint _blockIndex, void* out_, uint& outSizeBytes_)
+{
+	APT_ASSERT(out_);
+
+	BlockReader reader;
+	return reader.init(_in, _inSizeBytes) && reader.decompress(_blockIndex, out_, outSizeBytes_);
+}
+
+/*******************************************************************************
+
+                            CompressionDictionary
+
+*******************************************************************************/
+
+const uint CompressionDictionary::kMaxSizeBytes;
+
+static std::mutex                                 s_dictMutex;
+static eastl::vector<CompressionDictionary*>      s_dictRegistry;
+
+CompressionDictionary* CompressionDictionary::Create(const void* _data, uint _sizeBytes)
+{
+	APT_ASSERT(_data);
+	APT_ASSERT(_sizeBytes > 0);
+	APT_ASSERT(_sizeBytes <= kMaxSizeBytes);
+	_sizeBytes = APT_MIN(_sizeBytes, kMaxSizeBytes);
+
+	CompressionDictionary* ret = APT_NEW(CompressionDictionary);
+	Impl* impl = ret->m_impl;
+	impl->m_data.assign((const uint8*)_data, (const uint8*)_data + _sizeBytes);
+	impl->m_id = Crc32c(_data, _sizeBytes);
+	impl->m_id = impl->m_id ? impl->m_id : 1; // 0 is reserved to mean 'no dictionary'
+
+ // prime the deflate compressor/decompressor
+	eastl::vector<uint8> prefix((uint)mz_compressBound(_sizeBytes));
+	eastl::vector<uint8> check(_sizeBytes);
+	const CompressionFlags codecs[2] = { CompressionFlags_Speed, CompressionFlags_Size };
+	for (int i = 0; i < 2; ++i) {
+		APT_ASSERT(GetDictDeflateIndex(codecs[i]) == i);
+		tdefl_compressor* deflator = (tdefl_compressor*)APT_MALLOC(sizeof(tdefl_compressor));
+		tdefl_init(deflator, nullptr, nullptr, GetTdeflFlags(codecs[i]) & ~TDEFL_WRITE_ZLIB_HEADER);
+		size_t inSize = _sizeBytes;
+		size_t prefixSize = prefix.size();
+		APT_VERIFY(tdefl_compress(deflator, _data, &inSize, prefix.data(), &prefixSize, TDEFL_SYNC_FLUSH) == TDEFL_STATUS_OKAY);
+		APT_ASSERT(inSize == _sizeBytes && deflator->m_output_flush_remaining == 0);
+		impl->m_deflator[i] = deflator;
+
+		tinfl_decompressor& inflator = impl->m_inflator[i];
+		tinfl_init(&inflator);
+		size_t outSize = _sizeBytes;
+		APT_VERIFY(tinfl_decompress(&inflator, prefix.data(), &prefixSize, check.data(), check.data(), &outSize, TINFL_FLAG_HAS_MORE_INPUT | TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF) == TINFL_STATUS_NEEDS_MORE_INPUT);
+		APT_ASSERT(outSize == _sizeBytes && memcmp(check.data(), _data, _sizeBytes) == 0);
+	}
+
+ // LZ
+	memset(impl->m_lzTable, 0, sizeof(impl->m_lzTable));
+	LzInitTable(impl->m_data.data(), _sizeBytes, impl->m_lzTable);
+
+	std::lock_guard<std::mutex> lock(s_dictMutex);
+	s_dictRegistry.push_back(ret);
+	return ret;
+}
+
+CompressionDictionary* CompressionDictionary::Train(const void* const* _samples, const uint* _sampleSizesBytes, uint _sampleCount, uint _maxSizeBytes)
+{
+ // Simplified version of the COVER algorithm (Liao et al., 'Effective Construction of Relative Lempel-Ziv Dictionaries'). 
+ // The score of a segment is the sum of the number of samples containing each of its d-mers. The samples are split into
+ // epochs, from each epoch the best segment is selected and its d-mers are removed from subsequent scoring.
+	const uint kDmerSize    = 8;
+	const uint kSegmentSize = 64;
+	const uint kHashLog     = 20;
+	const uint32 kInvalid   = ~0u;
+	APT_ASSERT(_sampleCount > 0);
+	_maxSizeBytes = APT_MIN(_maxSizeBytes, kMaxSizeBytes);
+
+	eastl::vector<uint8> data;
+	for (uint i = 0; i < _sampleCount; ++i) {
+		data.insert(data.end(), (const uint8*)_samples[i], (const uint8*)_samples[i] + _sampleSizesBytes[i]);
+	}
+	uint dataSize = (uint)data.size();
+	APT_ASSERT(dataSize > 0);
+
+ // d-mer hash at each position, and the number of samples containing each d-mer
+	eastl::vector<uint32> dmers(dataSize, kInvalid);
+	eastl::vector<uint32> freq(1 << kHashLog, 0);
+	eastl::vector<uint32> lastSample(1 << kHashLog, kInvalid);
+	for (uint i = 0, beg = 0; i < _sampleCount; beg += _sampleSizesBytes[i], ++i) {
+		for (uint j = beg; j + kDmerSize <= beg + _sampleSizesBytes[i]; ++j) {
+			uint32 h = (uint32)((LzRead64(&data[j]) * 0x9e3779b97f4a7c15ull) >> (64 - kHashLog));
+			dmers[j] = h;
+			if (lastSample[h] != i) {
+				lastSample[h] = i;
+				++freq[h];
+			}
+		}
+	}
+
+ // select segments
+	struct Segment { uint m_begin; uint64 m_score; };
+	eastl::vector<Segment> segments;
+	uint segmentCount = APT_MAX(_maxSizeBytes / kSegmentSize, (uint)1);
+	uint epochSize = APT_MAX(dataSize / segmentCount, kSegmentSize);
+	const uint kWindow = kSegmentSize - kDmerSize + 1; // d-mers per segment
+	for (uint epoch = 0; epoch + kSegmentSize <= dataSize; epoch += epochSize) {
+		uint epochEnd = APT_MIN(epoch + epochSize, dataSize);
+		if (epochEnd - epoch < kSegmentSize) {
+			break;
+		}
+		Segment best = { epoch, 0 };
+		uint64 score = 0;
+		for (uint i = epoch; i < epochEnd; ++i) {
+		 // sliding window over the d-mers [i - kWindow + 1, i]
+			score += dmers[i] != kInvalid ? freq[dmers[i]] : 0;
+			if (i >= epoch + kWindow) {
+				uint j = i - kWindow;
+				score -= dmers[j] != kInvalid ? freq[dmers[j]] : 0;
+			}
+			uint begin = i + 1 - APT_MIN(kWindow, i + 1 - epoch);
+			if (score > best.m_score && begin + kSegmentSize <= epochEnd) {
+				best.m_begin = begin;
+				best.m_score = score;
+			}
+		}
+		if (best.m_score == 0) {
+			continue;
+		}
+		segments.push_back(best);
+		for (uint i = best.m_begin; i < best.m_begin + kWindow; ++i) {
+			if (dmers[i] != kInvalid) {
+				freq[dmers[i]] = 0;
+			}
+		}
+	}
+
+ // assemble, the best segments are placed at the end (smaller match offsets)
+	eastl::vector<uint8> dict;
+	if (segments.empty()) {
+		uint n = APT_MIN(dataSize, _maxSizeBytes);
+		dict.assign(data.end() - n, data.end());
+	} else {
+		eastl::sort(segments.begin(), segments.end(), [](const Segment& _a, const Segment& _b) { return _a.m_score > _b.m_score; });
+		if (segments.size() > segmentCount) {
+			segments.resize(segmentCount);
+		}
+		for (auto it = segments.rbegin(); it != segments.rend(); ++it) {
+			dict.insert(dict.end(), data.begin() + it->m_begin, data.begin() + it->m_begin + kSegmentSize);
+		}
+	}
+	return Create(dict.data(), (uint)dict.size());
+}
+
+void CompressionDictionary::Destroy(CompressionDictionary*& _dict_)
+{
+	if (_dict_) {
+		{	std::lock_guard<std::mutex> lock(s_dictMutex);
+			s_dictRegistry.erase(eastl::find(s_dictRegistry.begin(), s_dictRegistry.end(), _dict_));
+		}
+		APT_DELETE(_dict_);
+		_dict_ = nullptr;
+	}
+}
+
+CompressionDictionary* CompressionDictionary::Find(uint32 _id)
+{
+	std::lock_guard<std::mutex> lock(s_dictMutex);
+	for (auto dict : s_dictRegistry) {
+		if (dict->m_impl->m_id == _id) {
+			return dict;
+		}
+	}
+	return nullptr;
+}
+
+uint32 CompressionDictionary::getId() const
+{
+	return m_impl->m_id;
+}
+
+const void* CompressionDictionary::getData() const
+{
+	return m_impl->m_data.data();
+}
+
+uint CompressionDictionary::getSizeBytes() const
+{
+	return (uint)m_impl->m_data.size();
+}
+
+// PRIVATE
+
+CompressionDictionary::CompressionDictionary()
+{
+	m_impl = APT_NEW(Impl);
+	m_impl->m_deflator[0] = m_impl->m_deflator[1] = nullptr;
+}
+
+CompressionDictionary::~CompressionDictionary()
+{
+	for (auto deflator : m_impl->m_deflator) {
+		if (deflator) {
+			APT_FREE(deflator);
+		}
+	}
+	APT_DELETE(m_impl);
+}
@@ -9,15 +9,176 @@ enum CompressionFlags
 	CompressionFlags_None = 0,   // don't compress (for APIs with optional compression)
 	CompressionFlags_Speed,      // faster compression, potentially larger size
 	CompressionFlags_Size,       // slower compression, potentially smaller size
-	CompressionFlags_Default = CompressionFlags_Speed
+	CompressionFlags_Fast,       // LZ4-style codec, fastest compression and decompression, larger size
+	CompressionFlags_Default = CompressionFlags_Speed,
+
+	CompressionFlags_Parallel = 1 << 4, // combine with the above, use the block format (see CompressBlocks())
 };
+inline CompressionFlags operator|(CompressionFlags _a, CompressionFlags _b) { return (CompressionFlags)((int)_a | (int)_b); }
+
+// Default block size for CompressBlocks() and CompressionFlags_Parallel.
+const uint kCompressBlockSizeDefault = 256 * 1024;
+
+// Return the maximum size of the compressed data for _inSizeBytes of input.
+uint CompressBound(uint _inSizeBytes, CompressionFlags _flags = CompressionFlags_Default);
 
 // Compress _inSizeBytes from _in to out_ (allocated by the function). The size of the resulting buffer is written to outSizeBytes_.
-// out_ should subsequently be release via free().
-void Compress(const void* _in, uint _inSizeBytes, void*& out_, uint& outSizeBytes_, CompressionFlags _flags = CompressionFlags_Default);
+// out_ should subsequently be release via free(). If _dictionaryId is non-zero the specified dictionary is used (see 
+// CompressionDictionary).
+void Compress(const void* _in, uint _inSizeBytes, void*& out_, uint& outSizeBytes_, CompressionFlags _flags = CompressionFlags_Default, uint32 _dictionaryId = 0);
+
+// Compress _inSizeBytes from _in to out_, which must be at least _outCapacityBytes (allocated by the caller). The size of the compressed
+// data is written to outSizeBytes_. Return false if _outCapacityBytes was insufficient; use CompressBound() to guarantee success.
+bool Compress(const void* _in, uint _inSizeBytes, void* out_, uint _outCapacityBytes, uint& outSizeBytes_, CompressionFlags _flags = CompressionFlags_Default, uint32 _dictionaryId = 0);
 
 // Decompress _in to out_ (allocated by the function). The size of the resulting buffer is written to outSizeBytes_.
 // out_ should subsequently be release via free().
+// \note The codec and dictionary are detected from the stream header. Data compressed with CompressBlocks() is decompressed in 
+//   parallel.
 void Decompress(const void* _in, uint _inSizeBytes, void*& out_, uint& outSizeBytes_);
 
+// Decompress _in to out_, which must be at least _outCapacityBytes (allocated by the caller, usually the known decompressed size). The 
+// size of the decompressed data is written to outSizeBytes_. Return false if _outCapacityBytes was insufficient or if _in is invalid.
+bool Decompress(const void* _in, uint _inSizeBytes, void* out_, uint _outCapacityBytes, uint& outSizeBytes_);
+
+// Block-parallel compression: _in is split into independent blocks of _blockSizeBytes which are compressed on up to _threadCount 
+// threads (0 = 1 thread per hardware thread). The result contains a block index which permits parallel decompression via 
+// DecompressBlocks() or random access to individual blocks via DecompressBlock(). out_ should subsequently be released via free().
+void CompressBlocks(
+	const void*      _in, 
+	uint64           _inSizeBytes, 
+	void*&           out_, 
+	uint64&          outSizeBytes_, 
+	CompressionFlags _flags          = CompressionFlags_Default, 
+	uint             _blockSizeBytes = kCompressBlockSizeDefault, 
+	uint             _threadCount    = 0
+	);
+
+// Decompress the output of CompressBlocks() to out_ (allocated by the function). Return false if _in is invalid.
+// out_ should subsequently be released via free().
+bool DecompressBlocks(const void* _in, uint64 _inSizeBytes, void*& out_, uint64& outSizeBytes_, uint _threadCount = 0);
+
+// Retrieve the block count, the (uncompressed) block size and total uncompressed size from the output of CompressBlocks(). 
+// Return false if _in is invalid.
+bool GetBlockInfo(const void* _in, uint64 _inSizeBytes, uint& blockCount_, uint& blockSizeBytes_, uint64& rawSizeBytes_);
+
+// Decompress a single block from the output of CompressBlocks() to out_, which must be at least the block size. The size of the 
+// block is written to outSizeBytes_ (the last block may be smaller than the block size). Return false if _in is invalid.
+bool DecompressBlock(const void* _in, uint64 _inSizeBytes, uint _blockIndex, void* out_, uint& outSizeBytes_);
+
+////////////////////////////////////////////////////////////////////////////////
+// CompressionDictionary
+// Preset dictionary, improves compression of small payloads with similar 
+// content (e.g. serialized objects of the same type). Dictionaries are 
+// registered by id on creation, the id is stored in the compressed data and
+// Decompress() finds the dictionary automatically:
+//
+//  CompressionDictionary* dict = CompressionDictionary::Train(samples, sampleSizes, sampleCount);
+//  Compress(in, inSize, out, outSize, CompressionFlags_Size, dict->getId());
+//  Decompress(out, outSize, ...); // dict must exist
+//  CompressionDictionary::Destroy(dict);
+//
+// The id is derived from the dictionary content, hence it's safe to store the
+// id and recreate the dictionary from the same data (e.g. saved via getData()).
+// Dictionaries aren't supported by the block format or Compressor.
+////////////////////////////////////////////////////////////////////////////////
+class CompressionDictionary: private non_copyable<CompressionDictionary>
+{
+public:
+	static const uint kMaxSizeBytes = 32 * 1024;
+
+	// Create a dictionary from _data (at most kMaxSizeBytes). Place the most common content at the end of _data.
+	static CompressionDictionary* Create(const void* _data, uint _sizeBytes);
+
+	// Create a dictionary of at most _maxSizeBytes from segments which occur frequently in _samples.
+	static CompressionDictionary* Train(const void* const* _samples, const uint* _sampleSizesBytes, uint _sampleCount, uint _maxSizeBytes = kMaxSizeBytes);
+
+	// Release memory and unregister _dict_, _dict_ is set to 0.
+	static void Destroy(CompressionDictionary*& _dict_);
+
+	// Return the dictionary matching _id, or 0 if not found.
+	static CompressionDictionary* Find(uint32 _id);
+
+	uint32      getId() const;
+	const void* getData() const;
+	uint        getSizeBytes() const;
+
+	struct Impl;
+	const Impl* getImpl() const { return m_impl; } // internal
+
+private:
+	Impl* m_impl;
+
+	CompressionDictionary();
+	~CompressionDictionary();
+};
+
+enum CompressionStatus
+{
+	CompressionStatus_Error,     // invalid input or state
+	CompressionStatus_Continue,  // call again with more input and/or output space
+	CompressionStatus_Done       // the end of the stream was reached
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Compressor
+// Incremental compression into caller-provided output buffers. Memory use is
+// constant regardless of the total input size, the output is compatible with
+// Decompress(). CompressionFlags_Fast and CompressionFlags_Parallel are not
+// supported.
+//
+//  Compressor compressor(CompressionFlags_Speed);
+//  CompressionStatus status = CompressionStatus_Continue;
+//  while (status == CompressionStatus_Continue) {
+//     uint inSize  = <bytes available at in>;
+//     uint outSize = <bytes available at out>;
+//     status = compressor.compress(in, inSize, out, outSize, <no more input?>);
+//     in  += inSize;  // bytes consumed
+//     out += outSize; // bytes written
+//  }
+////////////////////////////////////////////////////////////////////////////////
+class Compressor: private non_copyable<Compressor>
+{
+public:
+	Compressor(CompressionFlags _flags = CompressionFlags_Default);
+	~Compressor();
+
+	// Begin a new stream.
+	void reset(CompressionFlags _flags = CompressionFlags_Default);
+
+	// Compress up to _inSizeBytes_ from _in into up to _outSizeBytes_ at out_. On return _inSizeBytes_ and _outSizeBytes_ contain the 
+	// number of bytes consumed and written respectively. Set _finish when _in contains the last of the input, then call repeatedly 
+	// (with _finish set) until the function returns CompressionStatus_Done.
+	CompressionStatus compress(const void* _in, uint& _inSizeBytes_, void* out_, uint& _outSizeBytes_, bool _finish);
+
+private:
+	struct Impl;
+	Impl* m_impl;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Decompressor
+// Incremental decompression of the output of Compress() or Compressor into
+// caller-provided output buffers. Memory use is constant (~43kb). Only the
+// deflate codec is supported (i.e. not CompressionFlags_Fast/_Parallel).
+////////////////////////////////////////////////////////////////////////////////
+class Decompressor: private non_copyable<Decompressor>
+{
+public:
+	Decompressor();
+	~Decompressor();
+
+	// Begin a new stream.
+	void reset();
+
+	// Decompress up to _inSizeBytes_ from _in into up to _outSizeBytes_ at out_. On return _inSizeBytes_ and _outSizeBytes_ contain the 
+	// number of bytes consumed and written respectively. Set _finish when _in contains the last of the input (a truncated stream is
+	// then an error), call repeatedly until the function returns CompressionStatus_Done.
+	CompressionStatus decompress(const void* _in, uint& _inSizeBytes_, void* out_, uint& _outSizeBytes_, bool _finish);
+
+private:
+	struct Impl;
+	Impl* m_impl;
+};
+
 } // namespace apt
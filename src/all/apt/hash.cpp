@@ -2,10 +2,14 @@
 
 #include <apt/apt.h>
 
-using namespace apt;
+#include <cstring> // memcpy
+
+#if APT_COMPILER_MSVC
+	#include <intrin.h> // _umul128
+#endif
+#include <nmmintrin.h>  // _mm_crc32_*
 
-constexpr uint32 kFnv1aPrime32 = 0x01000193u;
-constexpr uint64 kFnv1aPrime64 = 0x100000001B3ull;
+using namespace apt;
 
 uint16 internal::Hash16(const uint8* _buf, uint _bufSize)
 {
@@ -82,3 +86,389 @@ uint64 internal::HashString64(const char* _str, uint64 _base)
 	}
 	return ret;
 }
+
+
+/*	HashFast
+	Based on wyhash (https://github.com/wangyi-fudan/wyhash): input is mixed via 64x64->128 bit multiplication
+	and xor-folding of the result. The main loop processes 64-byte stripes into 4 independent lanes which are
+	folded into 2 lanes (one per 64-bit half of the 128-bit result) before the tail is processed.
+*/
+static const uint64 kHashFastSecret[4] = { 0xa0761d6478bd642full, 0xe7037ed1a0b428dbull, 0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull };
+
+static inline void HashFastMum(uint64& a_, uint64& b_)
+{
+#if APT_COMPILER_MSVC
+	a_ = _umul128(a_, b_, &b_);
+#else
+	__uint128_t r = (__uint128_t)a_ * b_;
+	a_ = (uint64)r;
+	b_ = (uint64)(r >> 64);
+#endif
+}
+
+static inline uint64 HashFastMix(uint64 _a, uint64 _b)
+{
+	HashFastMum(_a, _b);
+	return _a ^ _b;
+}
+
+static inline uint64 HashFastRead64(const uint8* _p) { uint64 ret; memcpy(&ret, _p, sizeof(ret)); return ret; }
+static inline uint64 HashFastRead32(const uint8* _p) { uint32 ret; memcpy(&ret, _p, sizeof(ret)); return ret; }
+static inline uint64 HashFastRead3(const uint8* _p, uint _n) { return ((uint64)_p[0] << 16) | ((uint64)_p[_n >> 1] << 8) | (uint64)_p[_n - 1]; }
+
+static inline void HashFastSeed(uint64 _seed, uint64 seed_[2])
+{
+	seed_[0] = _seed ^ HashFastMix(_seed ^ kHashFastSecret[0], kHashFastSecret[1]);
+	seed_[1] = _seed ^ HashFastMix(_seed ^ kHashFastSecret[2], kHashFastSecret[3]);
+}
+
+static inline void HashFastStripe(uint64 lanes_[4], const uint8* _p)
+{
+	lanes_[0] = HashFastMix(HashFastRead64(_p +  0) ^ kHashFastSecret[1], HashFastRead64(_p +  8) ^ lanes_[0]);
+	lanes_[1] = HashFastMix(HashFastRead64(_p + 16) ^ kHashFastSecret[2], HashFastRead64(_p + 24) ^ lanes_[1]);
+	lanes_[2] = HashFastMix(HashFastRead64(_p + 32) ^ kHashFastSecret[3], HashFastRead64(_p + 40) ^ lanes_[2]);
+	lanes_[3] = HashFastMix(HashFastRead64(_p + 48) ^ kHashFastSecret[0], HashFastRead64(_p + 56) ^ lanes_[3]);
+}
+
+// Process the final _n <= 64 bytes at _p. If _len > 16, the 16 bytes preceding _p+_n must be readable (they may
+// belong to the previous stripe). hi_ is optional.
+static inline uint64 HashFastFinish(const uint8* _p, uint64 _n, uint64 _len, uint64 _h0, uint64 _h1, uint64* hi_)
+{
+	uint64 a, b;
+	if (_len <= 16) {
+		if (_len >= 4) {
+			const uint64 off = (_len >> 3) << 2;
+			a = (HashFastRead32(_p) << 32) | HashFastRead32(_p + off);
+			b = (HashFastRead32(_p + _len - 4) << 32) | HashFastRead32(_p + _len - 4 - off);
+		} else if (_len > 0) {
+			a = HashFastRead3(_p, (uint)_len);
+			b = 0;
+		} else {
+			a = b = 0;
+		}
+	} else {
+		while (_n > 16) {
+			const uint64 x = HashFastRead64(_p);
+			const uint64 y = HashFastRead64(_p + 8);
+			_h0 = HashFastMix(x ^ kHashFastSecret[1], y ^ _h0);
+			_h1 = HashFastMix(x ^ kHashFastSecret[2], y ^ _h1);
+			_p += 16;
+			_n -= 16;
+		}
+		a = HashFastRead64(_p + _n - 16);
+		b = HashFastRead64(_p + _n - 8);
+	}
+
+	if (hi_) {
+		uint64 a1 = a ^ kHashFastSecret[2] ^ _h0;
+		uint64 b1 = b ^ _h1;
+		HashFastMum(a1, b1);
+		*hi_ = HashFastMix(a1 ^ kHashFastSecret[3] ^ _len, b1 ^ kHashFastSecret[2]);
+	}
+	a ^= kHashFastSecret[1] ^ _h1;
+	b ^= _h0;
+	HashFastMum(a, b);
+	return HashFastMix(a ^ kHashFastSecret[0] ^ _len, b ^ kHashFastSecret[1]);
+}
+
+static inline uint64 HashFastImpl(const uint8* _buf, uint _bufSize, uint64 _seed, uint64* hi_)
+{
+	APT_STRICT_ASSERT(_buf || _bufSize == 0);
+	uint64 h[2];
+	HashFastSeed(_seed, h);
+	const uint8* p = _buf;
+	uint64 n = _bufSize;
+	if (n > 64) {
+		uint64 lanes[4] = { h[0], h[0], h[1], h[1] };
+		do {
+			HashFastStripe(lanes, p);
+			p += 64;
+			n -= 64;
+		} while (n > 64);
+		h[0] = lanes[0] ^ lanes[1];
+		h[1] = lanes[2] ^ lanes[3];
+	}
+	return HashFastFinish(p, n, _bufSize, h[0], h[1], hi_);
+}
+
+uint64 internal::HashFast64(const uint8* _buf, uint _bufSize, uint64 _seed)
+{
+	return HashFastImpl(_buf, _bufSize, _seed, nullptr);
+}
+
+Hash128 internal::HashFast128(const uint8* _buf, uint _bufSize, uint64 _seed)
+{
+	Hash128 ret;
+	ret.m_lo = HashFastImpl(_buf, _bufSize, _seed, &ret.m_hi);
+	return ret;
+}
+
+void HashState::reset(uint64 _seed)
+{
+	HashFastSeed(_seed, m_seed);
+	m_lanes[0] = m_lanes[1] = m_seed[0];
+	m_lanes[2] = m_lanes[3] = m_seed[1];
+	m_totalSize = 0;
+	m_bufSize = 0;
+}
+
+void HashState::update(const void* _buf, uint _bufSize)
+{
+	APT_STRICT_ASSERT(_buf || _bufSize == 0);
+	const uint8* p = (const uint8*)_buf;
+	uint8* stripe = m_buf + 16;
+	m_totalSize += _bufSize;
+
+	if (m_bufSize + _bufSize <= 64) {
+		memcpy(stripe + m_bufSize, p, _bufSize);
+		m_bufSize += _bufSize;
+		return;
+	}
+
+ // a stripe is only processed if more input follows it (the final 1-64 bytes are processed by get())
+	const uint8* last = nullptr;
+	if (m_bufSize > 0) {
+		uint n = 64 - m_bufSize;
+		memcpy(stripe + m_bufSize, p, n);
+		HashFastStripe(m_lanes, stripe);
+		last = stripe;
+		p += n;
+		_bufSize -= n;
+	}
+	while (_bufSize > 64) {
+		HashFastStripe(m_lanes, p);
+		last = p;
+		p += 64;
+		_bufSize -= 64;
+	}
+	memcpy(m_buf, last + 48, 16);
+	memcpy(stripe, p, _bufSize);
+	m_bufSize = _bufSize;
+}
+
+static uint64 HashStateFinish(const uint64 _seed[2], const uint64 _lanes[4], const uint8* _buf, uint _bufSize, uint64 _totalSize, uint64* hi_)
+{
+	uint64 h0 = _seed[0];
+	uint64 h1 = _seed[1];
+	if (_totalSize > 64) {
+		h0 = _lanes[0] ^ _lanes[1];
+		h1 = _lanes[2] ^ _lanes[3];
+	}
+	return HashFastFinish(_buf + 16, _bufSize, _totalSize, h0, h1, hi_);
+}
+
+template <> uint64 HashState::get<uint64>() const
+{
+	return HashStateFinish(m_seed, m_lanes, m_buf, m_bufSize, m_totalSize, nullptr);
+}
+
+template <> Hash128 HashState::get<Hash128>() const
+{
+	Hash128 ret;
+	ret.m_lo = HashStateFinish(m_seed, m_lanes, m_buf, m_bufSize, m_totalSize, &ret.m_hi);
+	return ret;
+}
+
+
+/*	Crc32c
+	Software fallback is slicing-by-8. The hardware path runs 3 independent crc32 streams over adjacent blocks to hide
+	the instruction latency, the results are combined by 'shifting' the CRCs of the first blocks over the remaining
+	block lengths (multiplication by x^(8*blockSize) mod P, via precomputed tables). Based on Mark Adler's crc32c.c
+	(https://stackoverflow.com/a/17646775).
+*/
+static const uint32 kCrc32cPoly        = 0x82f63b78u; // reflected Castagnoli polynomial
+static const uint   kCrc32cLongBlock   = 8192;
+static const uint   kCrc32cShortBlock  = 256;
+
+static uint32 Gf2MatrixTimes(const uint32* _mat, uint32 _vec)
+{
+	uint32 ret = 0;
+	while (_vec) {
+		if (_vec & 1) {
+			ret ^= *_mat;
+		}
+		_vec >>= 1;
+		++_mat;
+	}
+	return ret;
+}
+
+static void Gf2MatrixSquare(uint32* square_, const uint32* _mat)
+{
+	for (int i = 0; i < 32; ++i) {
+		square_[i] = Gf2MatrixTimes(_mat, _mat[i]);
+	}
+}
+
+// Construct the operator which applies _len (a power of 2) zero bytes to a CRC.
+static void Crc32cZerosOp(uint32* even_, uint _len)
+{
+	uint32 odd[32];
+	odd[0] = kCrc32cPoly; // 1 zero bit
+	uint32 row = 1;
+	for (int i = 1; i < 32; ++i) {
+		odd[i] = row;
+		row <<= 1;
+	}
+	Gf2MatrixSquare(even_, odd); // 2 zero bits
+	Gf2MatrixSquare(odd, even_); // 4 zero bits
+	do {
+		Gf2MatrixSquare(even_, odd);
+		_len >>= 1;
+		if (_len == 0) {
+			return;
+		}
+		Gf2MatrixSquare(odd, even_);
+		_len >>= 1;
+	} while (_len);
+	memcpy(even_, odd, sizeof(odd));
+}
+
+struct Crc32cTables
+{
+	uint32 m_slice[8][256];      // slicing-by-8
+	uint32 m_shiftLong[4][256];  // shift a CRC over kCrc32cLongBlock zero bytes
+	uint32 m_shiftShort[4][256]; // shift a CRC over kCrc32cShortBlock zero bytes
+	bool   m_hasSse42;
+
+	Crc32cTables()
+	{
+		for (uint32 i = 0; i < 256; ++i) {
+			uint32 crc = i;
+			for (int j = 0; j < 8; ++j) {
+				crc = (crc & 1) ? (crc >> 1) ^ kCrc32cPoly : (crc >> 1);
+			}
+			m_slice[0][i] = crc;
+		}
+		for (uint32 i = 0; i < 256; ++i) {
+			uint32 crc = m_slice[0][i];
+			for (int j = 1; j < 8; ++j) {
+				crc = m_slice[0][crc & 0xff] ^ (crc >> 8);
+				m_slice[j][i] = crc;
+			}
+		}
+
+		InitShift(m_shiftLong,  kCrc32cLongBlock);
+		InitShift(m_shiftShort, kCrc32cShortBlock);
+
+		m_hasSse42 = (internal::GetCpuFeatures() & internal::CpuFeature_Sse42) != 0;
+	}
+
+	static void InitShift(uint32 shift_[4][256], uint _len)
+	{
+		uint32 op[32];
+		Crc32cZerosOp(op, _len);
+		for (uint32 i = 0; i < 256; ++i) {
+			shift_[0][i] = Gf2MatrixTimes(op, i);
+			shift_[1][i] = Gf2MatrixTimes(op, i << 8);
+			shift_[2][i] = Gf2MatrixTimes(op, i << 16);
+			shift_[3][i] = Gf2MatrixTimes(op, i << 24);
+		}
+	}
+
+	static uint32 Shift(const uint32 _shift[4][256], uint32 _crc)
+	{
+		return _shift[0][_crc & 0xff] ^ _shift[1][(_crc >> 8) & 0xff] ^ _shift[2][(_crc >> 16) & 0xff] ^ _shift[3][_crc >> 24];
+	}
+};
+
+static const Crc32cTables& GetCrc32cTables()
+{
+	static Crc32cTables s_tables;
+	return s_tables;
+}
+
+static uint32 Crc32cSw(const Crc32cTables& _tables, const uint8* _buf, uint _bufSize, uint32 _crc)
+{
+	const auto& t = _tables.m_slice;
+	uint64 crc = ~_crc;
+	while (_bufSize && ((uintptr_t)_buf & 7) != 0) {
+		crc = t[0][(crc ^ *_buf++) & 0xff] ^ (crc >> 8);
+		--_bufSize;
+	}
+	while (_bufSize >= 8) {
+		uint64 x;
+		memcpy(&x, _buf, 8);
+		crc ^= x;
+		crc = t[7][ crc        & 0xff] ^ t[6][(crc >>  8) & 0xff] ^ 
+		      t[5][(crc >> 16) & 0xff] ^ t[4][(crc >> 24) & 0xff] ^ 
+		      t[3][(crc >> 32) & 0xff] ^ t[2][(crc >> 40) & 0xff] ^ 
+		      t[1][(crc >> 48) & 0xff] ^ t[0][ crc >> 56        ];
+		_buf += 8;
+		_bufSize -= 8;
+	}
+	while (_bufSize) {
+		crc = t[0][(crc ^ *_buf++) & 0xff] ^ (crc >> 8);
+		--_bufSize;
+	}
+	return ~(uint32)crc;
+}
+
+// Accumulate 8 bytes; _mm_crc32_u64 is x64 only, 32 bit targets accumulate 2x4 bytes (little endian).
+APT_TARGET_SSE42 static inline uint64 Crc32cHw8(uint64 _crc, uint64 _x)
+{
+	#if defined(_M_X64) || defined(__x86_64__)
+		return _mm_crc32_u64(_crc, _x);
+	#else
+		uint32 crc = _mm_crc32_u32((uint32)_crc, (uint32)_x);
+		return _mm_crc32_u32(crc, (uint32)(_x >> 32));
+	#endif
+}
+
+APT_TARGET_SSE42 static uint32 Crc32cHw(const Crc32cTables& _tables, const uint8* _buf, uint _bufSize, uint32 _crc)
+{
+	uint64 crc0 = ~_crc;
+	while (_bufSize && ((uintptr_t)_buf & 7) != 0) {
+		crc0 = _mm_crc32_u8((uint32)crc0, *_buf++);
+		--_bufSize;
+	}
+
+ // 3 interleaved streams for large blocks, then small blocks
+	const uint blockSizes[2] = { kCrc32cLongBlock, kCrc32cShortBlock };
+	const uint32 (*shiftTables[2])[256] = { _tables.m_shiftLong, _tables.m_shiftShort };
+	for (int i = 0; i < 2; ++i) {
+		const uint blockSize = blockSizes[i];
+		while (_bufSize >= blockSize * 3) {
+			uint64 crc1 = 0;
+			uint64 crc2 = 0;
+			const uint8* end = _buf + blockSize;
+			do {
+				uint64 x0, x1, x2;
+				memcpy(&x0, _buf, 8);
+				memcpy(&x1, _buf + blockSize, 8);
+				memcpy(&x2, _buf + blockSize * 2, 8);
+				crc0 = Crc32cHw8(crc0, x0);
+				crc1 = Crc32cHw8(crc1, x1);
+				crc2 = Crc32cHw8(crc2, x2);
+				_buf += 8;
+			} while (_buf < end);
+			crc0 = Crc32cTables::Shift(shiftTables[i], (uint32)crc0) ^ crc1;
+			crc0 = Crc32cTables::Shift(shiftTables[i], (uint32)crc0) ^ crc2;
+			_buf += blockSize * 2;
+			_bufSize -= blockSize * 3;
+		}
+	}
+
+	while (_bufSize >= 8) {
+		uint64 x;
+		memcpy(&x, _buf, 8);
+		crc0 = Crc32cHw8(crc0, x);
+		_buf += 8;
+		_bufSize -= 8;
+	}
+	while (_bufSize) {
+		crc0 = _mm_crc32_u8((uint32)crc0, *_buf++);
+		--_bufSize;
+	}
+	return ~(uint32)crc0;
+}
+
+uint32 apt::Crc32c(const void* _buf, uint _bufSize, uint32 _seed)
+{
+	APT_STRICT_ASSERT(_buf || _bufSize == 0);
+	const Crc32cTables& tables = GetCrc32cTables();
+	if (tables.m_hasSse42) {
+		return Crc32cHw(tables, (const uint8*)_buf, _bufSize, _seed);
+	}
+	return Crc32cSw(tables, (const uint8*)_buf, _bufSize, _seed);
+}
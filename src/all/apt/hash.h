@@ -2,10 +2,26 @@
 
 #include <apt/apt.h>
 
+namespace apt {
+
+// 128-bit hash value, see HashFast().
+struct Hash128
+{
+	uint64 m_lo;
+	uint64 m_hi;
+
+	bool operator==(const Hash128& _rhs) const  { return m_lo == _rhs.m_lo && m_hi == _rhs.m_hi; }
+	bool operator!=(const Hash128& _rhs) const  { return !(*this == _rhs); }
+};
+
+} // namespace apt
+
 namespace apt { namespace internal {
 
-constexpr uint32 kFnv1aBase32 = 0x811C9DC5u;
-constexpr uint64 kFnv1aBase64 = 0xCBF29CE484222325ull;
+constexpr uint32 kFnv1aBase32  = 0x811C9DC5u;
+constexpr uint64 kFnv1aBase64  = 0xCBF29CE484222325ull;
+constexpr uint32 kFnv1aPrime32 = 0x01000193u;
+constexpr uint64 kFnv1aPrime64 = 0x100000001B3ull;
 
 uint16 Hash16(const uint8* _buf, uint _bufSize);
 uint16 Hash16(const uint8* _buf, uint _bufSize, uint16 _base);
@@ -17,6 +33,29 @@ uint16 HashString16(const char* _str, uint16 _base);
 uint32 HashString32(const char* _str, uint32 _base = kFnv1aBase32);
 uint64 HashString64(const char* _str, uint64 _base = kFnv1aBase64);
 
+// constexpr variants of HashString32/HashString64, results are identical. Use to hash string literals at compile time.
+constexpr uint32 HashStringConst32(const char* _str, uint32 _base = kFnv1aBase32)
+{
+	uint32 ret = _base;
+	while (*_str) {
+		ret ^= (uint32)*_str++;
+		ret *= kFnv1aPrime32;
+	}
+	return ret;
+}
+constexpr uint64 HashStringConst64(const char* _str, uint64 _base = kFnv1aBase64)
+{
+	uint64 ret = _base;
+	while (*_str) {
+		ret ^= (uint64)*_str++;
+		ret *= kFnv1aPrime64;
+	}
+	return ret;
+}
+
+uint64  HashFast64(const uint8* _buf, uint _bufSize, uint64 _seed = 0);
+Hash128 HashFast128(const uint8* _buf, uint _bufSize, uint64 _seed = 0);
+
 } } // namespace apt::internal
 
 
@@ -52,4 +91,54 @@ tType HashString(const char* _str);
 	template <> inline uint32 HashString<uint32>(const char* _str) { return internal::HashString32(_str); }
 	template <> inline uint64 HashString<uint64>(const char* _str) { return internal::HashString64(_str); }
 
+// Hash _bufSize bytes from _buf, 64 bytes per iteration. Much faster than Hash() for large buffers (use for content
+// addressing, cache keys, etc.) but the results differ. The low 64 bits of the 128-bit result match the 64-bit result.
+// _seed is used to initialize the result.
+// tType = uint64, Hash128
+template <typename tType>
+tType HashFast(const void* _buf, uint _bufSize, uint64 _seed = 0);
+	template <> inline uint64  HashFast<uint64> (const void* _buf, uint _bufSize, uint64 _seed) { return internal::HashFast64((const uint8*)_buf, _bufSize, _seed); }
+	template <> inline Hash128 HashFast<Hash128>(const void* _buf, uint _bufSize, uint64 _seed) { return internal::HashFast128((const uint8*)_buf, _bufSize, _seed); }
+
+// CRC-32C (Castagnoli) checksum of _bufSize bytes from _buf. Pass a previous result as _seed to checksum data 
+// incrementally. Uses the SSE4.2 crc32 instruction if available.
+uint32 Crc32c(const void* _buf, uint _bufSize, uint32 _seed = 0);
+
+////////////////////////////////////////////////////////////////////////////////
+// HashState
+// Incremental HashFast() for chunked input. The result is identical to calling
+// HashFast() once on the whole input:
+//
+//    HashState hs;
+//    while (...) {
+//       hs.update(chunk, chunkSize);
+//    }
+//    uint64 h = hs.get<uint64>();
+////////////////////////////////////////////////////////////////////////////////
+class HashState
+{
+public:
+	HashState(uint64 _seed = 0)                  { reset(_seed); }
+
+	// Discard any input and reinitialize with _seed.
+	void   reset(uint64 _seed = 0);
+
+	// Append _bufSize bytes from _buf to the input.
+	void   update(const void* _buf, uint _bufSize);
+
+	// Get the hash of the input so far. The state is unchanged, hence update() may be called subsequently.
+	// tType = uint64, Hash128
+	template <typename tType>
+	tType  get() const;
+
+private:
+	uint64 m_seed[2];      // initial lane values
+	uint64 m_lanes[4];
+	uint64 m_totalSize;
+	uint8  m_buf[16 + 64]; // last 16 bytes of the previous stripe + current stripe
+	uint   m_bufSize;      // current stripe size
+};
+	template <> uint64  HashState::get<uint64>() const;
+	template <> Hash128 HashState::get<Hash128>() const;
+
 } // namespace apt
@@ -35,6 +35,8 @@ void apt::internal::Log(const char* _fmt, ...)
 	#if !(APT_LOG_CALLBACK_ONLY)
 		APT_VERIFY((vfprintf(stdout, _fmt, args)) >= 0);
 		APT_VERIFY((fprintf(stdout, "\n")) >= 0);
+		va_end(args); // vfprintf consumed args, restart for the callback
+		va_start(args, _fmt);
 	#endif
 	DispatchLogCallback(_fmt, args, LogType_Log);
 	va_end(args);
@@ -47,6 +49,8 @@ void apt::internal::LogError(const char* _fmt, ...)
 	#if !(APT_LOG_CALLBACK_ONLY)
 		APT_VERIFY((vfprintf(stderr, _fmt, args)) > 0);
 		APT_VERIFY((fprintf(stderr, "\n")) > 0);
+		va_end(args);
+		va_start(args, _fmt);
 	#endif
 	DispatchLogCallback(_fmt, args, LogType_Error);
 	va_end(args);
@@ -59,6 +63,8 @@ void apt::internal::LogDebug(const char* _fmt, ...)
 	#if !(APT_LOG_CALLBACK_ONLY)
 		APT_VERIFY((vfprintf(stdout, _fmt, args)) > 0);
 		APT_VERIFY((fprintf(stdout, "\n")) > 0);
+		va_end(args);
+		va_start(args, _fmt);
 	#endif
 	DispatchLogCallback(_fmt, args, LogType_Debug);
 	va_end(args);
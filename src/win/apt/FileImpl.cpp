@@ -86,12 +86,8 @@ bool File::Read(File& file_, const char* _path)
 	ret = true;
 	
   // close existing handle/free existing data
-	if ((HANDLE)file_.m_impl != INVALID_HANDLE_VALUE) {
-		APT_PLATFORM_VERIFY(CloseHandle((HANDLE)file_.m_impl));
-	}
-	if (file_.m_data) {
-		APT_FREE(file_.m_data);
-	}
+	file_.close();
+	file_.freeData();
 	
 	file_.m_data     = data;
 	file_.m_dataSize = dataSize;
@@ -111,6 +107,78 @@ File_Read_end:
 	return ret;
 }
 
+bool File::Map(File& file_, const char* _path)
+{
+	if (!_path) {
+		_path = file_.getPath();
+	}
+	APT_ASSERT(_path);
+
+	bool   ret     = false;
+	void*  view    = nullptr;
+	DWORD  err     = 0;
+	uint64 size    = 0;
+	HANDLE mapping = NULL;
+
+ 	HANDLE h = CreateFile(
+		_path,
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		NULL,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL,
+		NULL
+		);
+	if (h == INVALID_HANDLE_VALUE) {
+		err = GetLastError();
+		goto File_Map_end;
+	}
+
+	LARGE_INTEGER li;
+	if (!GetFileSizeEx(h, &li)) {
+		err = GetLastError();
+		goto File_Map_end;
+	}
+	size = (uint64)li.QuadPart;
+
+	if (size > 0) { // can't map an empty file
+		mapping = CreateFileMapping(h, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (!mapping) {
+			err = GetLastError();
+			goto File_Map_end;
+		}
+		view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0); // the view keeps the mapping alive
+		if (!view) {
+			err = GetLastError();
+			goto File_Map_end;
+		}
+	}
+
+	ret = true;
+
+  // close existing handle/free existing data
+	file_.close();
+	file_.freeData();
+
+	file_.m_data     = (char*)view;
+	file_.m_dataSize = size;
+	file_.m_mapped   = view != nullptr;
+	file_.setPath(_path);
+
+File_Map_end:
+	if (!ret) {
+		APT_LOG_ERR("Error mapping '%s':\n\t%s", _path, GetPlatformErrorString((uint64)err));
+		APT_ASSERT(false);
+	}
+	if (mapping) {
+		APT_PLATFORM_VERIFY(CloseHandle(mapping));
+	}
+	if (h != INVALID_HANDLE_VALUE) {
+		APT_PLATFORM_VERIFY(CloseHandle(h));
+	}
+	return ret;
+}
+
 bool File::Write(const File& _file, const char* _path)
 {
 	if (!_path) {
@@ -161,4 +229,129 @@ File_Write_end:
 		APT_PLATFORM_VERIFY(CloseHandle(h));
 	}
 	return ret;
-}
\ No newline at end of file
+}
+
+bool File::OpenWrite(File& file_, const char* _path)
+{
+	if (!_path) {
+		_path = file_.getPath();
+	}
+	APT_ASSERT(_path);
+
+ 	HANDLE h = CreateFile(
+		_path,
+		GENERIC_WRITE,
+		FILE_SHARE_READ,
+		NULL,
+		CREATE_ALWAYS,
+		FILE_ATTRIBUTE_NORMAL,
+		NULL
+		);
+	if (h == INVALID_HANDLE_VALUE) {
+		DWORD err = GetLastError();
+		if (err == ERROR_PATH_NOT_FOUND && FileSystem::CreateDir(_path)) {
+			return OpenWrite(file_, _path);
+		}
+		APT_LOG_ERR("Error opening '%s':\n\t%s", _path, GetPlatformErrorString((uint64)err));
+		APT_ASSERT(false);
+		return false;
+	}
+
+	file_.close();
+	file_.m_impl = h;
+	file_.setPath(_path);
+	return true;
+}
+
+bool File::write(const char* _data, uint64 _size)
+{
+	APT_ASSERT(isOpen());
+	while (_size > 0) { // WriteFile can only write DWORD bytes
+		DWORD n = _size > 0x80000000ull ? 0x80000000u : (DWORD)_size;
+		DWORD bytesWritten;
+		if (!WriteFile((HANDLE)m_impl, _data, n, &bytesWritten, NULL) || bytesWritten != n) {
+			APT_LOG_ERR("Error writing '%s':\n\t%s", getPath(), GetPlatformErrorString((uint64)GetLastError()));
+			return false;
+		}
+		_data += n;
+		_size -= n;
+	}
+	return true;
+}
+
+bool File::OpenRead(File& file_, const char* _path)
+{
+	if (!_path) {
+		_path = file_.getPath();
+	}
+	APT_ASSERT(_path);
+
+ 	HANDLE h = CreateFile(
+		_path,
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		NULL,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+		NULL
+		);
+	if (h == INVALID_HANDLE_VALUE) {
+		APT_LOG_ERR("Error opening '%s':\n\t%s", _path, GetPlatformErrorString((uint64)GetLastError()));
+		APT_ASSERT(false);
+		return false;
+	}
+
+	file_.close();
+	file_.m_impl = h;
+	file_.setPath(_path);
+	return true;
+}
+
+uint64 File::read(char* data_, uint64 _size)
+{
+	APT_ASSERT(isOpen());
+	uint64 ret = 0;
+	while (_size > 0) { // ReadFile can only read DWORD bytes
+		DWORD n = _size > 0x80000000ull ? 0x80000000u : (DWORD)_size;
+		DWORD bytesRead;
+		if (!ReadFile((HANDLE)m_impl, data_, n, &bytesRead, NULL)) {
+			APT_LOG_ERR("Error reading '%s':\n\t%s", getPath(), GetPlatformErrorString((uint64)GetLastError()));
+			break;
+		}
+		ret += bytesRead;
+		if (bytesRead < n) {
+			break; // end of file
+		}
+		data_ += n;
+		_size -= n;
+	}
+	return ret;
+}
+
+void File::close()
+{
+	if ((HANDLE)m_impl != INVALID_HANDLE_VALUE) {
+		APT_PLATFORM_VERIFY(CloseHandle((HANDLE)m_impl));
+		m_impl = INVALID_HANDLE_VALUE;
+	}
+}
+
+bool File::isOpen() const
+{
+	return (HANDLE)m_impl != INVALID_HANDLE_VALUE;
+}
+
+// PRIVATE
+
+void File::freeData()
+{
+	if (m_data) {
+		if (m_mapped) {
+			APT_PLATFORM_VERIFY(UnmapViewOfFile(m_data));
+		} else {
+			APT_FREE(m_data);
+		}
+		m_data = nullptr;
+	}
+	m_mapped = false;
+}
@@ -3,6 +3,11 @@
 #include <apt/memory.h>
 #include <apt/Json.h>
 
+#include <EASTL/vector.h>
+
+#include <atomic>
+#include <limits>
+
 using namespace apt;
 
 template <typename tType>
@@ -68,6 +73,62 @@ TEST_CASE("ArrayAccess", "[Json]")
 	TestTypes(ArrayAccessTest);
 }
 
+TEST_CASE("GetSetArray", "[Json]")
+{
+	float f[] = { 0.5f, 1.0f, -2.25f, 1e10f };
+	sint32 i[] = { 1, -2, 3, INT32_MIN };
+	bool b[] = { true, false, true };
+
+	Json json;
+	json.setArray(f, 4, "f");
+	json.setArray(i, 4, "i");
+	json.setArray(b, 3, "b");
+	json.beginArray("arr");
+		json.pushValue<int>(0);
+		json.pushValue<int>(0);
+		json.setArray(i, 2); // replace the current value
+	json.endArray();
+
+	float fr[8];
+	REQUIRE(json.getArray("f", fr, 8) == 4);
+	REQUIRE(memcmp(fr, f, sizeof(f)) == 0);
+	REQUIRE(json.getArray("f", fr, 2) == 2);
+	double dr[4];
+	REQUIRE(json.getArray("i", dr, 4) == 4);
+	REQUIRE(dr[3] == (double)INT32_MIN);
+	sint32 ir[4];
+	REQUIRE(json.getArray("i", ir, 4) == 4);
+	REQUIRE(memcmp(ir, i, sizeof(i)) == 0);
+	bool br[3];
+	REQUIRE(json.getArray("b", br, 3) == 3);
+	REQUIRE(memcmp(br, b, sizeof(b)) == 0);
+	REQUIRE(json.find("arr"));
+	REQUIRE(json.enterArray());
+	REQUIRE(json.next());
+	REQUIRE(json.next());
+	REQUIRE(json.getArray(ir, 4) == 2);
+	REQUIRE(ir[1] == -2);
+	json.leaveArray();
+
+ // out of range doubles are clamped
+	double big[] = { 1e300, -1e300, 2.5, -2.5 };
+	json.setArray(big, 4, "big");
+	REQUIRE(json.getArray("big", ir, 4) == 4);
+	REQUIRE((ir[0] == INT32_MAX && ir[1] == INT32_MIN && ir[2] == 2 && ir[3] == -2));
+	uint8 u8r[4];
+	REQUIRE(json.getArray("big", u8r, 4) == 4);
+	REQUIRE((u8r[0] == 255 && u8r[1] == 0 && u8r[2] == 2 && u8r[3] == 0));
+	json.setValue<double>(1e20, "bigValue");
+	REQUIRE(json.getValue<sint64>("bigValue") == INT64_MAX);
+
+ // type errors
+	REQUIRE(json.getArray("b", fr, 4) == -1);
+	REQUIRE(json.getArray("f", br, 4) == -1);
+	REQUIRE(json.getArray("missing", fr, 4) == -1);
+	json.setValue<int>(1, "notArray");
+	REQUIRE(json.getArray("notArray", fr, 4) == -1);
+}
+
 TEST_CASE("ArrayOfArray", "[SerializerJson]")
 {
 	Json json;
@@ -133,6 +194,931 @@ TEST_CASE("Binary", "[SerializerJson]")
 	REQUIRE(memcmp(data, kSrcData, dataSize) == 0);
 }
 
+TEST_CASE("BinaryChecksum", "[SerializerJson]")
+{
+	const char* kSrcData = 
+		"Man is distinguished, not only by his reason, but by this singular passion from "
+		"other animals, which is a lust of the mind, that by a perseverance of delight "
+		"in the continued and indefatigable generation of knowledge, exceeds the short "
+		"vehemence of any carnal pleasure."
+		;
+	const uint kSrcDataSize = strlen(kSrcData);
+
+	Json json;
+	SerializerJson js(json, SerializerJson::Mode_Write);
+	js.setBinaryChecksum(true);
+
+	void* data = (void*)kSrcData;
+	uint dataSize = kSrcDataSize;
+	js.binary(data, dataSize, "BinaryTest", CompressionFlags_Size);
+
+	data = nullptr;
+	dataSize = 0;
+	js.setMode(SerializerJson::Mode_Read);
+	REQUIRE(js.binary(data, dataSize, "BinaryTest"));
+	REQUIRE(dataSize == kSrcDataSize);
+	REQUIRE(memcmp(data, kSrcData, dataSize) == 0);
+	APT_FREE(data);
+
+ // decompress to a caller-provided buffer
+	char buf[512] = {};
+	data = buf;
+	dataSize = kSrcDataSize;
+	REQUIRE(js.binary(data, dataSize, "BinaryTest"));
+	REQUIRE(data == buf);
+	REQUIRE(memcmp(buf, kSrcData, kSrcDataSize) == 0);
+
+ // corrupt the checksum
+	String<0> str(json.getValue<const char*>("BinaryTest"));
+	REQUIRE(str[0] == '2');
+	str[1] = str[1] == '0' ? '1' : '0';
+	json.setValue<const char*>((const char*)str, "BinaryTest");
+	data = nullptr;
+	REQUIRE_FALSE(js.binary(data, dataSize, "BinaryTest"));
+	REQUIRE(js.getError() != nullptr);
+}
+
+TEST_CASE("BinaryBase64", "[SerializerJson]")
+{
+	eastl::vector<uint8> src(1024);
+	uint32 x = 0x12345678;
+	for (auto& b : src) {
+		x = x * 1664525u + 1013904223u;
+		b = (uint8)(x >> 24);
+	}
+
+	Json json;
+	SerializerJson js(json, SerializerJson::Mode_Write);
+	eastl::vector<String<16> > names(src.size() + 1); // member names are referenced by the Json, not copied
+	for (uint n = 0; n <= src.size(); n += (n < 80 ? 1 : 61)) { // all tail sizes either side of the SIMD block sizes
+		String<16>& name = names[n];
+		name.setf("%u", n);
+		void* data = src.data();
+		uint dataSize = n;
+		js.binary(data, dataSize, (const char*)name);
+		REQUIRE(strlen(json.getValue<const char*>((const char*)name)) == 1 + (n + 2) / 3 * 4);
+
+		js.setMode(SerializerJson::Mode_Read);
+		data = nullptr;
+		dataSize = 0;
+		REQUIRE(js.binary(data, dataSize, (const char*)name));
+		REQUIRE(dataSize == n);
+		REQUIRE(memcmp(data, src.data(), n) == 0);
+		APT_FREE(data);
+		js.setMode(SerializerJson::Mode_Write);
+	}
+
+	const char* kVectors[][2] = { { "M", "0TQ==" }, { "Ma", "0TWE=" }, { "Man", "0TWFu" } };
+	for (auto& v : kVectors) {
+		void* data = (void*)v[0];
+		uint dataSize = strlen(v[0]);
+		js.binary(data, dataSize, v[0]);
+		REQUIRE(strcmp(json.getValue<const char*>(v[0]), v[1]) == 0);
+	}
+
+ // invalid chars must be detected in both the SIMD and scalar paths
+	String<0> str(json.getValue<const char*>("995"));
+	js.setMode(SerializerJson::Mode_Read);
+	for (uint i : { (uint)1, (uint)5, (uint)40, (uint)700, str.getLength() - 2 }) {
+		String<0> bad((const char*)str);
+		bad[i] = '*';
+		json.setValue<const char*>((const char*)bad, "bad");
+		void* data = nullptr;
+		uint dataSize = 0;
+		REQUIRE_FALSE(js.binary(data, dataSize, "bad"));
+		REQUIRE(js.getError() != nullptr);
+	}
+	json.setValue<const char*>("0AAAAA", "bad"); // invalid length
+	void* data = nullptr;
+	uint dataSize = 0;
+	REQUIRE_FALSE(js.binary(data, dataSize, "bad"));
+}
+
+TEST_CASE("ValueArray", "[SerializerJson]")
+{
+	const uint kCount = 64;
+	float32 f32[kCount];
+	sint16 s16[kCount];
+	for (uint i = 0; i < kCount; ++i) {
+		f32[i] = (float32)i * 0.25f;
+		s16[i] = (sint16)i - 32;
+	}
+	mat4 m = identity;
+	m[3][0] = 2.0f;
+	vec3 v3[2] = { vec3(1.0f, 2.0f, 3.0f), vec3(4.0f, 5.0f, 6.0f) };
+
+	Json json;
+	SerializerJson js(json, SerializerJson::Mode_Write);
+	js.valueArray(f32, kCount, "f32");
+	js.valueArray(s16, kCount, "s16");
+	js.valueArray(v3, 2, "v3");
+	Serialize(js, m, "m");
+	REQUIRE(json.find("m"));
+	REQUIRE(json.getType() == Json::ValueType_Array);
+
+	js.setMode(SerializerJson::Mode_Read);
+	float32 f32r[kCount] = {};
+	REQUIRE(js.valueArray(f32r, kCount, "f32"));
+	REQUIRE(memcmp(f32r, f32, sizeof(f32)) == 0);
+	float64 f64r[kCount] = {}; // with conversion
+	REQUIRE(js.valueArray(f64r, kCount, "s16"));
+	REQUIRE(f64r[0] == -32.0);
+	REQUIRE(f64r[kCount - 1] == (float64)(kCount - 33));
+	vec3 v3r[2];
+	REQUIRE(js.valueArray(v3r, 2, "v3"));
+	REQUIRE(v3r[1] == v3[1]);
+	mat4 mr;
+	REQUIRE(Serialize(js, mr, "m"));
+	REQUIRE(mr == m);
+
+	sint8 s8r[kCount];
+	REQUIRE(js.valueArray(s8r, kCount, "f32")); // truncated
+	REQUIRE((s8r[1] == 0 && s8r[kCount - 1] == 15));
+	REQUIRE_FALSE(js.valueArray(f32r, kCount - 1, "f32")); // length mismatch
+	REQUIRE(js.getError() != nullptr);
+	REQUIRE_FALSE(js.valueArray(f32r, kCount, "missing"));
+}
+
+TEST_CASE("StreamWrite", "[SerializerJson]")
+{
+	const uint kCount = 64;
+	float32 f32[kCount];
+	for (uint i = 0; i < kCount; ++i) {
+		f32[i] = (float32)i * 0.1f;
+	}
+	auto write = [&](SerializerJson& _ser_) {
+		bool b = true;
+		sint32 i = -3;
+		uint64 u = 1ull << 40;
+		float32 f = 0.1f;
+		String<32> str = "test \"string\"";
+		mat3 m = identity;
+		_ser_.value(b, "b");
+		_ser_.value(i, "i");
+		_ser_.beginObject("obj");
+			_ser_.value(u, "u");
+			_ser_.value(f, "f");
+			_ser_.value(str, "str");
+			Serialize(_ser_, m, "m");
+		_ser_.endObject();
+		uint n = 3;
+		_ser_.beginArray(n, "arr");
+			for (uint j = 0; j < n; ++j) {
+				_ser_.beginObject();
+					_ser_.value(j, "j");
+				_ser_.endObject();
+			}
+		_ser_.endArray();
+		_ser_.valueArray(f32, kCount, "f32");
+	};
+
+ // output is identical to the DOM path
+	Json json;
+	SerializerJson domSer(json, SerializerJson::Mode_Write);
+	write(domSer);
+	File domFile;
+	Json::Write(json, domFile);
+
+	File streamFile;
+	SerializerJson streamSer(streamFile);
+	REQUIRE(streamSer.getJson() == nullptr);
+	REQUIRE(streamSer.getIndex() == 0); // before the first value
+	write(streamSer);
+	REQUIRE(streamSer.getIndex() == 4); // f32
+	REQUIRE(streamSer.flush());
+	REQUIRE(streamFile.getDataSize() == domFile.getDataSize());
+	REQUIRE(memcmp(streamFile.getData(), domFile.getData(), domFile.getDataSize()) == 0);
+
+ // stream to disk, read back
+	const char* kPath = "StreamWrite.json";
+	{	File f;
+		REQUIRE(File::OpenWrite(f, kPath));
+		SerializerJson ser(f); // flushed by the destructor
+		write(ser);
+	}
+	File fr;
+	REQUIRE(File::Read(fr, kPath));
+	Json jsonr;
+	REQUIRE(Json::Read(jsonr, fr));
+	SerializerJson readSer(jsonr, SerializerJson::Mode_Read);
+	float32 f32r[kCount];
+	REQUIRE(readSer.valueArray(f32r, kCount, "f32"));
+	REQUIRE(memcmp(f32r, f32, sizeof(f32)) == 0);
+	FileSystem::Delete(kPath);
+
+ // the name is copied
+	File nameFile;
+	SerializerJson nameSer(nameFile);
+	sint32 v = 1;
+	{	String<32> name("name%d", 1);
+		REQUIRE(nameSer.value(v, (const char*)name));
+	}
+	String<32> other("other%d", 2);
+	REQUIRE(strcmp(nameSer.getName(), "name1") == 0);
+
+ // NaN/Inf can't be written
+	File nanFile;
+	SerializerJson nanSer(nanFile);
+	float64 nan = std::numeric_limits<float64>::quiet_NaN();
+	REQUIRE_FALSE(nanSer.value(nan, "nan"));
+	REQUIRE(nanSer.getError() != nullptr);
+	f32[1] = std::numeric_limits<float32>::infinity();
+	REQUIRE_FALSE(nanSer.valueArray(f32, kCount, "f32"));
+	REQUIRE_FALSE(nanSer.flush());
+}
+
+TEST_CASE("WriteFlags", "[Json]")
+{
+	Json json;
+	json.beginObject("obj");
+		json.setValue<int>(1, "a");
+		json.setValue<const char*>("str", "b");
+		json.beginArray("arr");
+			for (int i = 0; i < 4; ++i) {
+				json.pushValue<int>(i);
+			}
+		json.endArray();
+	json.endObject();
+
+	File compact, pretty, multiLine;
+	REQUIRE(Json::Write(json, compact, Json::WriteFlags_Compact));
+	REQUIRE(Json::Write(json, pretty));
+	REQUIRE(Json::Write(json, multiLine, Json::WriteFlags_Pretty));
+	const char* kCompact = "{\"obj\":{\"a\":1,\"b\":\"str\",\"arr\":[0,1,2,3]}}";
+	REQUIRE(compact.getDataSize() == strlen(kCompact));
+	REQUIRE(memcmp(compact.getData(), kCompact, strlen(kCompact)) == 0);
+	REQUIRE(pretty.getDataSize() > compact.getDataSize());
+	REQUIRE(multiLine.getDataSize() > pretty.getDataSize());
+
+ // streamed output is identical
+	const char* kPath = "WriteFlags.json";
+	for (Json::WriteFlags flags : { Json::WriteFlags_Compact, Json::WriteFlags_Default }) {
+		{	File f;
+			REQUIRE(File::OpenWrite(f, kPath));
+			REQUIRE(Json::Write(json, f, flags));
+		}
+		const File& expected = flags == Json::WriteFlags_Compact ? compact : pretty;
+		File f;
+		REQUIRE(File::Read(f, kPath));
+		REQUIRE(f.getDataSize() == expected.getDataSize());
+		REQUIRE(memcmp(f.getData(), expected.getData(), expected.getDataSize()) == 0);
+		Json jsonr;
+		REQUIRE(Json::Read(jsonr, f));
+		REQUIRE(jsonr.find("obj"));
+		REQUIRE(jsonr.enterObject());
+		REQUIRE(strcmp(jsonr.getValue<const char*>("b"), "str") == 0);
+	}
+	FileSystem::Delete(kPath);
+
+ // NaN isn't valid JSON, the write fails and the file is unmodified
+	Json nan;
+	nan.setValue<double>(std::numeric_limits<double>::quiet_NaN(), "nan");
+	REQUIRE_FALSE(Json::Write(nan, compact));
+	REQUIRE(compact.getDataSize() == strlen(kCompact));
+}
+
+TEST_CASE("MessagePack", "[Json]")
+{
+	Json json;
+	json.setValue<bool>(true, "t");
+	json.setValue<bool>(false, "f");
+	json.beginArray("ints");
+		for (sint64 i : { (sint64)0, (sint64)127, (sint64)128, (sint64)255, (sint64)65535, (sint64)65536, (sint64)-1, (sint64)-32, (sint64)-33, (sint64)-129, (sint64)-32769, (sint64)INT32_MIN, (sint64)INT32_MIN - 1, INT64_MIN }) {
+			json.pushValue<sint64>(i);
+		}
+		json.pushValue<uint64>(0xffffffffull);
+		json.pushValue<uint64>(0x100000000ull);
+		json.pushValue<uint64>(UINT64_MAX);
+	json.endArray();
+	json.setValue<float>(0.5f, "f32");
+	json.setValue<double>(0.1, "f64");
+	json.beginArray("strs");
+		for (uint n : { 0u, 31u, 32u, 300u, 70000u }) {
+			eastl::vector<char> str(n + 1, '\0');
+			for (uint i = 0; i < n; ++i) {
+				str[i] = 'a' + i % 26;
+			}
+			json.pushValue<const char*>(str.data());
+		}
+	json.endArray();
+	eastl::vector<String<8> > names(20); // member names aren't copied
+	json.beginObject("obj");
+		for (int i = 0; i < (int)names.size(); ++i) {
+			names[i].setf("m%d", i);
+			json.setValue<int>(i, (const char*)names[i]);
+		}
+	json.endObject();
+	json.beginArray("arr");
+		for (int i = 0; i < 70000; ++i) {
+			json.pushValue<int>(i);
+		}
+	json.endArray();
+	json.beginArray("empty");
+	json.endArray();
+
+	File text, msgpack, msgpackText;
+	REQUIRE(Json::Write(json, text, Json::WriteFlags_Compact));
+	REQUIRE(Json::Write(json, msgpack, Json::WriteFlags_MessagePack));
+	REQUIRE(msgpack.getDataSize() < text.getDataSize());
+	REQUIRE((uint8)msgpack.getData()[0] == 0x89); // fixmap, 9 members
+
+	Json jsonr;
+	REQUIRE(Json::Read(jsonr, msgpack));
+	REQUIRE(Json::Write(jsonr, msgpackText, Json::WriteFlags_Compact));
+	REQUIRE(msgpackText.getDataSize() == text.getDataSize());
+	REQUIRE(memcmp(msgpackText.getData(), text.getData(), text.getDataSize()) == 0);
+	REQUIRE(jsonr.getValue<bool>("t"));
+	REQUIRE(jsonr.getValue<float>("f32") == 0.5f);
+	REQUIRE(jsonr.getValue<double>("f64") == 0.1);
+	REQUIRE(jsonr.find("ints"));
+	REQUIRE(jsonr.enterArray());
+	REQUIRE(jsonr.getValue<sint64>(13) == INT64_MIN);
+	REQUIRE(jsonr.getValue<uint64>(16) == UINT64_MAX);
+	jsonr.leaveArray();
+
+ // streamed output is identical
+	const char* kPath = "MessagePack.msgpack";
+	{	File f;
+		REQUIRE(File::OpenWrite(f, kPath));
+		REQUIRE(Json::Write(json, f, Json::WriteFlags_MessagePack));
+	}
+	{	File f;
+		REQUIRE(File::Read(f, kPath));
+		REQUIRE(f.getDataSize() == msgpack.getDataSize());
+		REQUIRE(memcmp(f.getData(), msgpack.getData(), msgpack.getDataSize()) == 0);
+		REQUIRE(Json::ReadInsitu(jsonr, f));
+		REQUIRE(jsonr.getValue<bool>("t"));
+	}
+	FileSystem::Delete(kPath);
+
+ // raw binary is written as bin, and as base64 for text
+	eastl::vector<uint8> bin(300);
+	for (uint i = 0; i < bin.size(); ++i) {
+		bin[i] = (uint8)(i * 7);
+	}
+	Json jsonBase64, jsonRaw;
+	{	SerializerJson js(jsonBase64, SerializerJson::Mode_Write);
+		void* data = bin.data();
+		uint dataSize = (uint)bin.size();
+		js.binary(data, dataSize, "bin");
+	}
+	{	SerializerJson js(jsonRaw, SerializerJson::Mode_Write);
+		js.setBinaryRaw(true);
+		void* data = bin.data();
+		uint dataSize = (uint)bin.size();
+		js.binary(data, dataSize, "bin");
+		REQUIRE(*jsonRaw.getValue<const char*>("bin") == '\0');
+	}
+	File base64Text, rawText, rawMsgpack;
+	REQUIRE(Json::Write(jsonBase64, base64Text));
+	REQUIRE(Json::Write(jsonRaw, rawText));
+	REQUIRE(rawText.getDataSize() == base64Text.getDataSize());
+	REQUIRE(memcmp(rawText.getData(), base64Text.getData(), base64Text.getDataSize()) == 0);
+	REQUIRE(Json::Write(jsonRaw, rawMsgpack, Json::WriteFlags_MessagePack));
+	REQUIRE(rawMsgpack.getDataSize() < bin.size() + 16);
+	base64Text.appendData("", 1); // text must be null terminated
+	for (File* f : { &rawMsgpack, &base64Text }) {
+		REQUIRE(Json::Read(jsonr, *f));
+		SerializerJson js(jsonr, SerializerJson::Mode_Read);
+		void* data = nullptr;
+		uint dataSize = 0;
+		REQUIRE(js.binary(data, dataSize, "bin"));
+		REQUIRE(dataSize == bin.size());
+		REQUIRE(memcmp(data, bin.data(), dataSize) == 0);
+		APT_FREE(data);
+	}
+
+ // invalid data
+	File bad;
+	bad.setData(msgpack.getData(), msgpack.getDataSize() / 2);
+	REQUIRE_FALSE(Json::Read(jsonr, bad));
+	REQUIRE_FALSE(jsonr.find("t"));
+	const char kIntKey[] = { (char)0x81, 0x01, 0x01 };
+	bad.setData(kIntKey, sizeof(kIntKey));
+	REQUIRE_FALSE(Json::Read(jsonr, bad));
+	const char kNested[] = { (char)0x81, (char)0xa1, 'a', (char)0x91, (char)0x91, (char)0x91 };
+	bad.setData(kNested, sizeof(kNested));
+	REQUIRE_FALSE(Json::Read(jsonr, bad));
+
+ // strings beginning with '\0' are reserved for raw binary
+	const char kReservedMsgPack[] = { (char)0x81, (char)0xa1, 's', (char)0xa2, '\0', 'a' };
+	bad.setData(kReservedMsgPack, sizeof(kReservedMsgPack));
+	REQUIRE_FALSE(Json::Read(jsonr, bad));
+	const char kReservedText[] = "{ \"s\": \"\\u0000a\" }";
+	bad.setData(kReservedText, sizeof(kReservedText));
+	REQUIRE_FALSE(Json::Read(jsonr, bad));
+	REQUIRE_FALSE(Json::ReadInsitu(jsonr, bad));
+	bad.setData(kReservedText, sizeof(kReservedText));
+	JsonReader reader(bad);
+	REQUIRE(reader.next() == JsonReader::Token_BeginObject);
+	REQUIRE_FALSE(reader.read(jsonr));
+	REQUIRE(reader.getError() != nullptr);
+	const char kNullText[] = "{ \"s\": \"a\\u0000\" }"; // not at the beginning
+	bad.setData(kNullText, sizeof(kNullText));
+	REQUIRE(Json::Read(jsonr, bad));
+}
+
+TEST_CASE("ReadAsync", "[Json]")
+{
+	struct Result
+	{
+		int        m_count = 0;
+		int        m_sum   = 0;
+		bool       m_failed = false;
+		String<64> m_error;
+	};
+	auto onRead = [](const char* _path, Json* _json_, const char* _error, void* _userData)
+		{
+			Result* result = (Result*)_userData;
+			if (_json_) {
+				REQUIRE(_error == nullptr);
+				result->m_sum += _json_->getValue<int>("value");
+				APT_DELETE(_json_);
+			} else {
+				REQUIRE(_error != nullptr);
+				result->m_failed = true;
+				result->m_error.set(_error);
+			}
+			++result->m_count;
+		};
+
+	const int kRoot = FileSystem::AddRoot(""); // current directory
+	const int kFileCount = 8;
+	String<32> paths[kFileCount];
+	for (int i = 0; i < kFileCount; ++i) {
+		paths[i].setf("ReadAsync%d.json", i);
+		Json json;
+		json.setValue<int>(i + 1, "value");
+		REQUIRE(Json::Write(json, (const char*)paths[i], kRoot));
+	}
+
+	Result result;
+	for (int i = 0; i < kFileCount; ++i) {
+		REQUIRE(Json::ReadAsync((const char*)paths[i], onRead, &result, kRoot) != 0);
+	}
+	REQUIRE(Json::WaitReadAsync() == kFileCount);
+	REQUIRE(result.m_count == kFileCount);
+	REQUIRE(result.m_sum == kFileCount * (kFileCount + 1) / 2);
+	REQUIRE_FALSE(result.m_failed);
+	REQUIRE(Json::DispatchReadAsync() == 0);
+
+ // missing file
+	result = Result();
+	Json::ReadAsync("ReadAsyncMissing.json", onRead, &result, kRoot);
+	REQUIRE(Json::WaitReadAsync() == 1);
+	REQUIRE(result.m_failed);
+	REQUIRE(strstr((const char*)result.m_error, "ReadAsyncMissing.json") != nullptr);
+
+ // parse error is passed to the callback
+	{	File f;
+		f.setData("{ \"value\": ", 11);
+		REQUIRE(FileSystem::Write(f, "ReadAsyncInvalid.json", kRoot));
+	}
+	result = Result();
+	Json::ReadAsync("ReadAsyncInvalid.json", onRead, &result, kRoot);
+	REQUIRE(Json::WaitReadAsync() == 1);
+	REQUIRE(result.m_failed);
+	REQUIRE_FALSE(result.m_error.isEmpty());
+	FileSystem::Delete("ReadAsyncInvalid.json");
+
+ // cancelled reads don't call the callback
+	result = Result();
+	Json::ReadAsyncId ids[kFileCount];
+	for (int i = 0; i < kFileCount; ++i) {
+		ids[i] = Json::ReadAsync((const char*)paths[i], onRead, &result, kRoot);
+	}
+	int cancelled = 0;
+	for (int i = kFileCount - 1; i >= 0; --i) {
+		cancelled += Json::CancelReadAsync(ids[i]) ? 1 : 0;
+	}
+	REQUIRE(cancelled == kFileCount); // no callbacks were dispatched
+	REQUIRE(Json::WaitReadAsync() == 0);
+	REQUIRE(result.m_count == 0);
+	REQUIRE_FALSE(Json::CancelReadAsync(ids[0]));
+
+ // callback on the worker thread
+	std::atomic<int> count(0);
+	auto onReadWorker = [](const char* _path, Json* _json_, const char* _error, void* _userData)
+		{
+			APT_DELETE(_json_);
+			++*(std::atomic<int>*)_userData;
+		};
+	for (int i = 0; i < kFileCount; ++i) {
+		Json::ReadAsync((const char*)paths[i], onReadWorker, &count, kRoot, false);
+	}
+	REQUIRE(Json::WaitReadAsync() == 0);
+	REQUIRE(count == kFileCount);
+
+	for (auto& path : paths) {
+		FileSystem::Delete((const char*)path);
+	}
+}
+
+static bool ReadString(Json& json_, const char* _str)
+{
+	File f;
+	f.setData(_str, strlen(_str));
+	f.appendData("", 1);
+	return Json::Read(json_, f);
+}
+
+static bool JsonEqual(const Json& _a, const Json& _b)
+{
+	File a, b;
+	Json::Write(_a, a, Json::WriteFlags_Compact);
+	Json::Write(_b, b, Json::WriteFlags_Compact);
+	return a.getDataSize() == b.getDataSize() && memcmp(a.getData(), b.getData(), a.getDataSize()) == 0;
+}
+
+TEST_CASE("DiffPatch", "[Json]")
+{
+	const char* kFrom = "{ \"a\": 1, \"b\": { \"c\": [1, 2, 3], \"d\": \"str\", \"e/f~\": true }, \"g\": [ { \"h\": 1 }, { \"h\": 2 } ], \"big\": [0, 1, 2, 3, 4, 5, 6, 7] }";
+	const char* kTo   = "{ \"a\": 2, \"b\": { \"c\": [1, 2], \"d\": \"str\", \"e/f~\": null, \"x\": { \"y\": 1 } }, \"g\": [ { \"h\": 1 }, { \"h\": 3 }, 4 ], \"big\": [0, 1, 2, 3, 4, 5, 6, 7] }";
+	Json from, to, patch;
+	REQUIRE(ReadString(from, kFrom));
+	REQUIRE(ReadString(to, kTo));
+
+	REQUIRE(Json::Diff(from, to, patch) == 6);
+	REQUIRE(Json::ApplyPatch(from, patch));
+	REQUIRE(JsonEqual(from, to));
+	REQUIRE(Json::Diff(from, to, patch) == 0);
+
+ // member order is ignored
+	Json reordered;
+	REQUIRE(ReadString(reordered, "{ \"big\": [0, 1, 2, 3, 4, 5, 6, 7], \"g\": [ { \"h\": 1 }, { \"h\": 3 }, 4 ], \"a\": 2, \"b\": { \"x\": { \"y\": 1 }, \"c\": [1, 2], \"d\": \"str\", \"e/f~\": null } }"));
+	REQUIRE(Json::Diff(to, reordered, patch) == 0);
+
+ // patch survives a text round trip
+	REQUIRE(ReadString(from, kFrom));
+	REQUIRE(Json::Diff(to, from, patch) == 6);
+	File patchText;
+	REQUIRE(Json::Write(patch, patchText));
+	patchText.appendData("", 1);
+	Json patchr;
+	REQUIRE(Json::Read(patchr, patchText));
+	REQUIRE(Json::ApplyPatch(to, patchr));
+	REQUIRE(JsonEqual(to, from));
+
+ // hand written patches
+	Json json;
+	REQUIRE(ReadString(json, "{ \"arr\": [1, 3], \"obj\": { \"a\": 1 } }"));
+	REQUIRE(ReadString(patch, "{ \"patch\": [ { \"op\": \"add\", \"path\": \"/arr/1\", \"value\": 2 }, { \"op\": \"add\", \"path\": \"/arr/-\", \"value\": 4 }, { \"op\": \"remove\", \"path\": \"/obj/a\" } ] }"));
+	REQUIRE(Json::ApplyPatch(json, patch));
+	Json expected;
+	REQUIRE(ReadString(expected, "{ \"arr\": [1, 2, 3, 4], \"obj\": {} }"));
+	REQUIRE(JsonEqual(json, expected));
+
+	REQUIRE(ReadString(patch, "{ \"patch\": [ { \"op\": \"replace\", \"path\": \"/missing/a\", \"value\": 1 } ] }"));
+	REQUIRE_FALSE(Json::ApplyPatch(json, patch));
+	REQUIRE(ReadString(patch, "{ \"patch\": [ { \"op\": \"remove\", \"path\": \"/arr/4\" } ] }"));
+	REQUIRE_FALSE(Json::ApplyPatch(json, patch));
+	REQUIRE(ReadString(patch, "{ \"patch\": [ { \"op\": \"move\", \"path\": \"/arr/0\" } ] }"));
+	REQUIRE_FALSE(Json::ApplyPatch(json, patch));
+
+ // empty member names, path "/" and "/obj/"
+	REQUIRE(ReadString(from, "{ \"\": 1, \"obj\": { \"\": [1] } }"));
+	REQUIRE(ReadString(to,   "{ \"\": 2, \"obj\": { \"\": [1, 2], \"x\": 0 } }"));
+	REQUIRE(Json::Diff(from, to, patch) == 3);
+	REQUIRE(Json::ApplyPatch(from, patch));
+	REQUIRE(JsonEqual(from, to));
+	REQUIRE(ReadString(patch, "{ \"patch\": [ { \"op\": \"remove\", \"path\": \"/\" }, { \"op\": \"add\", \"path\": \"/obj/\", \"value\": 3 } ] }"));
+	REQUIRE(Json::ApplyPatch(from, patch));
+	REQUIRE(ReadString(expected, "{ \"obj\": { \"\": 3, \"x\": 0 } }"));
+	REQUIRE(JsonEqual(from, expected));
+}
+
+TEST_CASE("ReadInsitu", "[Json]")
+{
+	const char* kPath = "ReadInsitu.json";
+	const char* kJson = "{ \"str\": \"value \\\"quoted\\\"\", \"num\": 2, \"obj\": { \"name\": \"nested\" } }";
+	{	File f;
+		f.setData(kJson, strlen(kJson));
+		REQUIRE(File::Write(f, kPath));
+	}
+
+	File f;
+	REQUIRE(File::Read(f, kPath));
+	Json json;
+	REQUIRE(Json::ReadInsitu(json, f));
+	REQUIRE(f.getData() == nullptr); // json took ownership
+	REQUIRE(strcmp(json.getValue<const char*>("str"), "value \"quoted\"") == 0);
+	REQUIRE(json.getValue<int>("num") == 2);
+	REQUIRE(json.find("obj"));
+	REQUIRE(json.enterObject());
+	REQUIRE(strcmp(json.getValue<const char*>("name"), "nested") == 0);
+	json.leaveObject();
+
+ // mapped data is copied
+	REQUIRE(File::Map(f, kPath));
+	REQUIRE(Json::ReadInsitu(json, f));
+	REQUIRE(json.getValue<int>("num") == 2);
+
+ // mapped data isn't null terminated, Read() is bounded by the data size
+	REQUIRE(File::Map(f, kPath));
+	REQUIRE(Json::Read(json, f));
+	REQUIRE(json.getValue<int>("num") == 2);
+	REQUIRE(strcmp(json.getValue<const char*>("str"), "value \"quoted\"") == 0);
+
+ // an empty file maps to null data
+	{	File empty;
+		REQUIRE(File::Write(empty, "ReadInsituEmpty.json"));
+	}
+	REQUIRE(File::Map(f, "ReadInsituEmpty.json"));
+	REQUIRE(f.getData() == nullptr);
+	REQUIRE_FALSE(Json::Read(json, f));
+	f = File();
+	FileSystem::Delete("ReadInsituEmpty.json");
+
+ // replace with a normal read
+	File f2;
+	f2.setData("{ \"num\": 3 }", 13);
+	f2.appendData("", 1);
+	REQUIRE(Json::Read(json, f2));
+	REQUIRE(json.getValue<int>("num") == 3);
+	REQUIRE_FALSE(json.find("str"));
+
+	FileSystem::Delete(kPath);
+}
+
+TEST_CASE("JsonReader", "[Json]")
+{
+	const char* kPath = "JsonReader.json";
+	const char* kJson =
+		"// comment\n"
+		"{\n"
+		"\t\"header\": { \"version\": 3, \"name\": \"tab\\t \\\"q\\\" \\u00e9 \\ud83d\\ude00\" },\n"
+		"\t/* skipped */ \"data\": [ [1, 2, 3], { \"a\": [ \"]}\" ] }, -1.5e2, true, null, ],\n"
+		"\t\"big\": 18446744073709551615,\n"
+		"\t\"neg\": -9,\n"
+		"\t\"config\": { \"scale\": 0.5, \"list\": [ 1, 2 ], \"label\": \"cfg\" }\n"
+		"}\n";
+	{	File f;
+		f.setData(kJson, strlen(kJson));
+		REQUIRE(File::Write(f, kPath));
+	}
+
+ // stream with a tiny buffer to exercise chunk boundaries
+	File f;
+	REQUIRE(File::OpenRead(f, kPath));
+	JsonReader reader(f, 7);
+	REQUIRE(reader.next() == JsonReader::Token_BeginObject);
+	REQUIRE(reader.getDepth() == 0);
+	REQUIRE(reader.find("header"));
+	REQUIRE(reader.getToken() == JsonReader::Token_BeginObject);
+	REQUIRE(reader.next() == JsonReader::Token_Number);
+	REQUIRE(strcmp(reader.getName(), "version") == 0);
+	REQUIRE(reader.getValue<int>() == 3);
+	REQUIRE(reader.next() == JsonReader::Token_String);
+	REQUIRE(strcmp(reader.getValue<const char*>(), "tab\t \"q\" \xc3\xa9 \xf0\x9f\x98\x80") == 0);
+	REQUIRE(reader.next() == JsonReader::Token_EndObject);
+
+	REQUIRE(reader.next() == JsonReader::Token_BeginArray);
+	REQUIRE(strcmp(reader.getName(), "data") == 0);
+	REQUIRE(reader.next() == JsonReader::Token_BeginArray);
+	REQUIRE(reader.skip());
+	REQUIRE(reader.getToken() == JsonReader::Token_EndArray);
+	REQUIRE(reader.next() == JsonReader::Token_BeginObject);
+	REQUIRE(reader.skip());
+	REQUIRE(reader.next() == JsonReader::Token_Number);
+	REQUIRE(reader.getValue<float>() == -150.0f);
+	REQUIRE(reader.next() == JsonReader::Token_Bool);
+	REQUIRE(reader.getValue<bool>());
+	REQUIRE(reader.next() == JsonReader::Token_Null);
+	REQUIRE(reader.next() == JsonReader::Token_EndArray);
+
+	REQUIRE(reader.find("big"));
+	REQUIRE(reader.getValue<uint64>() == 18446744073709551615ull);
+	REQUIRE(reader.find("config"));
+	{	Json json;
+		REQUIRE(reader.read(json));
+		REQUIRE(reader.getToken() == JsonReader::Token_EndObject);
+		float scale = 0.0f;
+		int list[2] = {};
+		String<16> label;
+		SerializerJson serializer(json, SerializerJson::Mode_Read);
+		REQUIRE(serializer.value(scale, "scale"));
+		REQUIRE(serializer.valueArray(list, 2, "list"));
+		REQUIRE(serializer.value(label, "label"));
+		REQUIRE(scale == 0.5f);
+		REQUIRE((list[0] == 1 && list[1] == 2));
+		REQUIRE(label == "cfg");
+	}
+	REQUIRE(reader.next() == JsonReader::Token_EndObject);
+	REQUIRE(reader.next() == JsonReader::Token_End);
+	REQUIRE(reader.getError() == nullptr);
+	f.close();
+
+ // errors
+	const char* kBad = "{ \"a\": [ 1 2 ] }";
+	JsonReader bad(kBad, strlen(kBad));
+	REQUIRE(bad.next() == JsonReader::Token_BeginObject);
+	REQUIRE_FALSE(bad.find("b")); // skip() doesn't validate the array
+	REQUIRE(bad.getToken() == JsonReader::Token_EndObject);
+	JsonReader bad2(kBad, strlen(kBad));
+	REQUIRE(bad2.next() == JsonReader::Token_BeginObject);
+	REQUIRE(bad2.next() == JsonReader::Token_BeginArray);
+	REQUIRE(bad2.next() == JsonReader::Token_Number);
+	REQUIRE(bad2.next() == JsonReader::Token_Error);
+	REQUIRE(bad2.next() == JsonReader::Token_Error);
+	REQUIRE(bad2.getError() != nullptr);
+	const char* kBadName = "{ \"ab\\q\": 1 }";
+	JsonReader bad3(kBadName, strlen(kBadName));
+	REQUIRE(bad3.next() == JsonReader::Token_BeginObject);
+	REQUIRE(bad3.next() == JsonReader::Token_Error);
+	REQUIRE(strcmp(bad3.getName(), "ab") == 0); // partial name is null terminated
+
+ // large integers and out of range floats
+	const char* kNumbers = "{ \"u\": 18446744073709551615, \"f\": 1e300, \"n\": -1 }";
+	JsonReader numbers(kNumbers, strlen(kNumbers));
+	REQUIRE(numbers.next() == JsonReader::Token_BeginObject);
+	Json json;
+	REQUIRE(numbers.read(json));
+	REQUIRE(json.getValue<uint64>("u") == 18446744073709551615ull);
+	REQUIRE(json.getValue<double>("f") == 1e300);
+	REQUIRE(json.getValue<sint64>("n") == -1);
+
+	FileSystem::Delete(kPath);
+}
+
+TEST_CASE("MemberIndex", "[Json]")
+{
+	const int kCount = 1000;
+	String<32> names[kCount];
+	for (int i = 0; i < kCount; ++i) {
+		names[i].setf("member%d", i);
+	}
+
+	Json json;
+	json.setMemberIndexThreshold(16);
+	for (int i = 0; i < kCount; ++i) {
+		json.setValue<int>(i, (const char*)names[i]); // index is built at 16 members then updated on add
+	}
+	for (int i = 0; i < kCount; ++i) {
+		REQUIRE(json.find((const char*)names[i]));
+		REQUIRE(json.getIndex() == i);
+		REQUIRE(json.getValue<int>() == i);
+	}
+	REQUIRE_FALSE(json.find("missing"));
+
+ // overwrite existing members
+	json.setValue<int>(-1, "member500");
+	REQUIRE(json.getValue<int>("member500") == -1);
+	REQUIRE(json.getValue<int>("member999") == 999);
+
+ // nested object moves when its parent grows
+	json.beginObject("nested");
+		for (int i = 0; i < 32; ++i) {
+			json.setValue<int>(i * 2, (const char*)names[i]);
+		}
+	json.endObject();
+	for (int i = 0; i < 64; ++i) {
+		String<32> name("extra%d", i);
+		json.setValue<int>(i, (const char*)name);
+	}
+	REQUIRE(json.find("nested"));
+	REQUIRE(json.enterObject());
+		REQUIRE(json.getValue<int>("member31") == 62);
+		REQUIRE_FALSE(json.find("member32"));
+	json.leaveObject();
+
+ // read, clear
+	const char* kJson = "{ \"a\": 1, \"b\": 2, \"c\": 3, \"d\": 4 }";
+	File f;
+	f.setData(kJson, strlen(kJson) + 1);
+	json.setMemberIndexThreshold(2);
+	REQUIRE(Json::Read(json, f));
+	REQUIRE(json.getValue<int>("c") == 3);
+	REQUIRE_FALSE(json.find("member0"));
+	json.setMemberIndexThreshold(0);
+	REQUIRE(json.getValue<int>("d") == 4);
+}
+
+TEST_CASE("JsonPath", "[Json]")
+{
+	const char* kJson =
+		"{ \"scene\": {"
+		"	\"name\": \"test\","
+		"	\"nodes\": ["
+		"		{ \"name\": \"a\", \"scale\": 1.0, \"visible\": true, \"id\": -1 },"
+		"		{ \"name\": \"b\", \"scale\": 2.0, \"visible\": false, \"id\": 2 },"
+		"		{ \"name\": \"c\", \"visible\": true, \"id\": 3 },"
+		"		{ \"name\": \"d\", \"scale\": \"wrong type\", \"id\": 4 }"
+		"	],"
+		"	\"layers\": { \"bg\": { \"id\": 10 }, \"fg\": { \"id\": 11 } }"
+		"} }";
+	File f;
+	f.setData(kJson, strlen(kJson) + 1);
+	Json json;
+	REQUIRE(Json::Read(json, f));
+
+	REQUIRE(JsonPath("scene.nodes[*].scale").getSegmentCount() == 4);
+	REQUIRE_FALSE(JsonPath("scene..nodes").isValid());
+	REQUIRE_FALSE(JsonPath("scene.nodes[x]").isValid());
+	REQUIRE_FALSE(JsonPath("scene.").isValid());
+	REQUIRE(JsonPath("scene.nodes[2147483647]").isValid());
+	REQUIRE_FALSE(JsonPath("scene.nodes[2147483648]").isValid());
+	REQUIRE_FALSE(JsonPath("scene.nodes[99999999999999999999]").isValid());
+
+ // batch extraction
+	float scales[8] = {};
+	REQUIRE(json.getValues(JsonPath("scene.nodes[*].scale"), scales, 8) == 2); // "wrong type" is skipped
+	REQUIRE((scales[0] == 1.0f && scales[1] == 2.0f));
+	const char* names[2] = {};
+	REQUIRE(json.getValues(JsonPath("scene.nodes[*].name"), names, 2) == 4);   // count is all matches
+	REQUIRE((strcmp(names[0], "a") == 0 && strcmp(names[1], "b") == 0));
+	bool visible[4] = {};
+	REQUIRE(json.getValues(JsonPath("scene.nodes[*].visible"), visible, 4) == 3);
+	REQUIRE((visible[0] && !visible[1] && visible[2]));
+	sint64 ids[4] = {};
+	REQUIRE(json.getValues(JsonPath("scene.layers.*.id"), ids, 4) == 2);
+	REQUIRE((ids[0] == 10 && ids[1] == 11));
+	REQUIRE(json.getValues(JsonPath("scene.nodes[0].id"), ids, 4) == 1);
+	REQUIRE(ids[0] == -1);
+	REQUIRE(json.getValues(JsonPath("scene.nodes[4].id"), ids, 4) == 0);
+	REQUIRE(json.getValues(JsonPath("scene.missing"), ids, 4) == 0);
+
+ // find enters the containers along the path
+	const JsonPath kNodeName("scene.nodes[*].name");
+	REQUIRE(json.find(kNodeName, 2));
+	REQUIRE(strcmp(json.getValue<const char*>(), "c") == 0);
+	REQUIRE(strcmp(json.getName(), "name") == 0);
+	REQUIRE(json.getValue<int>("id") == 3); // current container is nodes[2]
+	json.leaveObject();
+	REQUIRE(json.getIndex() == 2);
+	json.leaveArray();
+	REQUIRE(strcmp(json.getName(), "nodes") == 0);
+	json.leaveObject();
+	REQUIRE(strcmp(json.getName(), "scene") == 0);
+	REQUIRE_FALSE(json.find(kNodeName, 4));
+
+ // iterate over all matches, same order and traversal state as find()
+	Json::PathIterator it;
+	const char* kNames[] = { "a", "b", "c", "d" };
+	for (int i = 0; i < 4; ++i) {
+		REQUIRE(json.findNext(kNodeName, it));
+		REQUIRE(strcmp(json.getValue<const char*>(), kNames[i]) == 0);
+		REQUIRE(json.getValue<int>("id") == (i == 0 ? -1 : i + 1)); // current container is nodes[i]
+	}
+	REQUIRE_FALSE(json.findNext(kNodeName, it));
+	const JsonPath kLayerId("scene.layers.*.id");
+	sint64 layerIdSum = 0;
+	while (json.findNext(kLayerId, it)) {
+		layerIdSum += json.getValue<sint64>();
+	}
+	REQUIRE(layerIdSum == 21);
+	REQUIRE_FALSE(json.findNext(JsonPath("scene.nodes[4].id"), it));
+	REQUIRE(json.find("scene")); // traversal state is at the root
+
+ // relative to the current container
+	REQUIRE(json.find("scene"));
+	REQUIRE(json.enterObject());
+	REQUIRE(json.getValues(JsonPath("nodes[1].scale"), scales, 1) == 1);
+	REQUIRE(scales[0] == 2.0f);
+	json.leaveObject();
+}
+
+TEST_CASE("Pool", "[Json]")
+{
+	File f;
+	const char* kJson = "{ \"str\": \"a string value which must be copied\", \"arr\": [ 1, 2, 3, 4, 5, 6, 7, 8 ], \"obj\": { \"b\": true } }";
+	f.setData(kJson, strlen(kJson) + 1);
+
+	Json::Pool pool(1024);
+	REQUIRE(pool.getChunkSize() == 1024);
+	uint retained = 0;
+	for (int i = 0; i < 8; ++i) {
+		Json json(pool);
+		REQUIRE(Json::Read(json, f));
+		REQUIRE(strcmp(json.getValue<const char*>("str"), "a string value which must be copied") == 0);
+		REQUIRE(json.find("arr"));
+		REQUIRE(json.enterArray());
+		REQUIRE(json.getArrayLength() == 8);
+		json.leaveArray();
+		json.setValue("new", "added");
+	 // after the first iteration the pool is warm, no new memory is allocated
+		if (i == 1) {
+			retained = pool.getRetainedSize();
+		} else if (i > 1) {
+			REQUIRE(pool.getRetainedSize() == retained);
+		}
+	}
+	uint warm = pool.getRetainedSize();
+	REQUIRE(warm > 0);
+
+ // clear() returns memory to the pool
+	Json json(pool);
+	REQUIRE(Json::Read(json, f));
+	REQUIRE(pool.getRetainedSize() < warm);
+	json.clear();
+	REQUIRE(pool.getRetainedSize() == warm);
+	REQUIRE_FALSE(json.find("str"));
+	json.setValue(1, "int");
+	REQUIRE(json.getValue<int>("int") == 1);
+
+	pool.shrink();
+	REQUIRE(pool.getRetainedSize() == 0);
+}
+
 TEST_CASE("Enum", "[SerializerJson]")
 {
 	enum Fruit 
@@ -0,0 +1,562 @@
+#include <catch.hpp>
+
+#include <apt/memory.h>
+#include <apt/File.h>
+#include <apt/FileSystem.h>
+#include <apt/Serializer.h>
+
+#include <cstring>
+
+using namespace apt;
+
+template <typename tType>
+static void _ValueTest(const char* _name, Serializer& _serializer_)
+{
+	tType v = tType(1);
+	if (_serializer_.getMode() == Serializer::Mode_Read) {
+		v = tType(2);
+		REQUIRE(Serialize(_serializer_, v, _name));
+	} else {
+		Serialize(_serializer_, v, _name);
+	}
+	REQUIRE(v == tType(1));
+}
+#define ValueTest(t) _ValueTest<t>(#t, ser)
+
+// instantiate _macro for all types
+#define TestTypes(_macro) \
+	_macro(bool);    \
+	_macro(sint8);   \
+	_macro(uint8);   \
+	_macro(sint16);  \
+	_macro(uint16);  \
+	_macro(sint32);  \
+	_macro(uint32);  \
+	_macro(sint64);  \
+	_macro(uint64);  \
+	_macro(float32); \
+	_macro(float64); \
+	_macro(vec2);    \
+	_macro(vec3);    \
+	_macro(vec4);    \
+	_macro(mat2);    \
+	_macro(mat3);    \
+	_macro(mat4)
+
+TEST_CASE("BinaryValues", "[SerializerBinary]")
+{
+	SerializerBinary ser(SerializerBinary::Mode_Write);
+	TestTypes(ValueTest);
+	String<32> str("string value");
+	ser.value(str, "str");
+	String<32> emptyStr;
+	ser.value(emptyStr, "emptyStr");
+	ser.beginObject("obj");
+		sint32 a = -7;
+		ser.value(a, "a");
+		float32 b = 0.5f;
+		ser.value(b, "b");
+	ser.endObject();
+
+	ser.setMode(SerializerBinary::Mode_Read);
+	TestTypes(ValueTest);
+
+	String<32> str2;
+	REQUIRE(ser.value(str2, "str"));
+	REQUIRE(str2 == str);
+	REQUIRE(ser.value(str2, "emptyStr"));
+	REQUIRE(str2.isEmpty());
+
+ // out of order, type conversion
+	REQUIRE(ser.beginObject("obj"));
+		float64 b2 = 0.0;
+		REQUIRE(ser.value(b2, "b"));
+		REQUIRE(b2 == 0.5);
+		sint64 a2 = 0;
+		REQUIRE(ser.value(a2, "a"));
+		REQUIRE(a2 == -7);
+		REQUIRE(ser.getIndex() == 0);
+		REQUIRE(strcmp(ser.getName(), "a") == 0);
+		{	String<16> tmpName("b");
+			REQUIRE(ser.value(b2, (const char*)tmpName));
+			tmpName.set("x");
+		}
+		REQUIRE(strcmp(ser.getName(), "b") == 0); // copied, not referenced
+		REQUIRE_FALSE(ser.value(a2, "missing"));
+		REQUIRE(ser.getError() != nullptr);
+		REQUIRE_FALSE(ser.value(str2, "a")); // not a string
+	ser.endObject();
+	uint8 u8 = 0;
+	REQUIRE(ser.value(u8, "uint8"));
+	REQUIRE(u8 == 1);
+	REQUIRE_FALSE(((Serializer&)ser).beginArray("str")); // not an array
+}
+
+TEST_CASE("BinaryArrayOfArray", "[SerializerBinary]")
+{
+	SerializerBinary ser(SerializerBinary::Mode_Write);
+	uint in = 4;
+	ser.beginArray(in, "ArrayOfArrays");
+	for (int i = 0; i < in; ++i) {
+		uint jn = 3;
+		ser.beginArray(jn);
+			for (int j = 0; j < jn; ++j) {
+				int v = i + j;
+				ser.value(v);
+			}
+		ser.endArray();
+	}
+	ser.endArray();
+
+	ser.setMode(SerializerBinary::Mode_Read);
+	in = 0;
+	REQUIRE(ser.beginArray(in, "ArrayOfArrays"));
+	REQUIRE(in == 4);
+	for (int i = 0; i < in; ++i) {
+		uint jn = 0;
+		REQUIRE(ser.beginArray(jn));
+		REQUIRE(jn == 3);
+			for (int j = 0; j < jn; ++j) {
+				int v;
+				REQUIRE(ser.value(v));
+				REQUIRE(v == i + j);
+				REQUIRE(ser.getIndex() == j);
+			}
+			int v;
+			REQUIRE_FALSE(ser.value(v)); // end of the array
+		ser.endArray();
+	}
+	ser.endArray();
+}
+
+TEST_CASE("BinaryData", "[SerializerBinary]")
+{
+	const char* kSrcData =
+		"Man is distinguished, not only by his reason, but by this singular passion from "
+		"other animals, which is a lust of the mind, that by a perseverance of delight "
+		"in the continued and indefatigable generation of knowledge, exceeds the short "
+		"vehemence of any carnal pleasure."
+		;
+	const uint kSrcDataSize = strlen(kSrcData);
+
+	SerializerBinary ser(SerializerBinary::Mode_Write);
+	ser.setBinaryChecksum(true);
+	void* data = (void*)kSrcData;
+	uint dataSize = kSrcDataSize;
+	ser.binary(data, dataSize, "raw");
+	ser.binary(data, dataSize, "compressed", CompressionFlags_Size);
+
+	ser.setMode(SerializerBinary::Mode_Read);
+	for (const char* name : { "raw", "compressed" }) {
+		data = nullptr;
+		dataSize = 0;
+		REQUIRE(ser.binary(data, dataSize, name));
+		REQUIRE(dataSize == kSrcDataSize);
+		REQUIRE(memcmp(data, kSrcData, dataSize) == 0);
+		APT_FREE(data);
+
+	 // caller's buffer
+		char buf[512];
+		data = buf;
+		dataSize = kSrcDataSize;
+		REQUIRE(ser.binary(data, dataSize, name));
+		REQUIRE(data == buf);
+		REQUIRE(memcmp(buf, kSrcData, kSrcDataSize) == 0);
+		dataSize = kSrcDataSize - 1;
+		REQUIRE_FALSE(ser.binary(data, dataSize, name));
+	}
+
+	SerializerBinary compressed(SerializerBinary::Mode_Write);
+	compressed.setBinaryChecksum(true);
+	data = (void*)kSrcData;
+	dataSize = kSrcDataSize;
+	compressed.binary(data, dataSize, "compressed", CompressionFlags_Size);
+	eastl::vector<uint8> src((const uint8*)compressed.getData(), (const uint8*)compressed.getData() + compressed.getDataSize());
+	SerializerBinary reader(SerializerBinary::Mode_Read);
+
+ // corrupt bytes must fail (or succeed with the right size) without reading or allocating out of bounds
+	for (uint i = 0; i < src.size(); ++i) {
+		eastl::vector<uint8> corrupt = src;
+		corrupt[i] ^= 0xff;
+		if (!reader.setData(corrupt.data(), (uint)corrupt.size())) {
+			continue;
+		}
+		data = nullptr;
+		dataSize = 0;
+		if (reader.binary(data, dataSize, "compressed")) {
+			REQUIRE(dataSize == kSrcDataSize);
+			APT_FREE(data);
+		}
+	}
+
+ // raw size in the header doesn't match the compressed data
+	uint rawSizeOffset = 0;
+	while (rawSizeOffset + 4 <= src.size() && memcmp(&src[rawSizeOffset], &kSrcDataSize, 4) != 0) {
+		++rawSizeOffset;
+	}
+	REQUIRE(rawSizeOffset + 4 <= src.size());
+	for (uint32 size : { 0xffffffffu, (uint32)kSrcDataSize * 2, (uint32)kSrcDataSize / 2 }) {
+		memcpy(&src[rawSizeOffset], &size, sizeof(uint32));
+		REQUIRE(reader.setData(src.data(), (uint)src.size()));
+		data = nullptr;
+		dataSize = 0;
+		REQUIRE_FALSE(reader.binary(data, dataSize, "compressed"));
+		REQUIRE(data == nullptr);
+	}
+
+ // the dictionary must be registered when reading
+	CompressionDictionary* dict = CompressionDictionary::Create(kSrcData, kSrcDataSize);
+	compressed.setMode(SerializerBinary::Mode_Write);
+	compressed.setBinaryDictionary(dict->getId());
+	data = (void*)kSrcData;
+	dataSize = kSrcDataSize;
+	compressed.binary(data, dataSize, "compressed", CompressionFlags_Size);
+	compressed.setMode(SerializerBinary::Mode_Read);
+	data = nullptr;
+	REQUIRE(compressed.binary(data, dataSize, "compressed"));
+	REQUIRE(memcmp(data, kSrcData, kSrcDataSize) == 0);
+	APT_FREE(data);
+	CompressionDictionary::Destroy(dict);
+	data = nullptr;
+	REQUIRE_FALSE(compressed.binary(data, dataSize, "compressed"));
+	REQUIRE(data == nullptr);
+}
+
+TEST_CASE("BinaryInvalidData", "[SerializerBinary]")
+{
+	SerializerBinary ser(SerializerBinary::Mode_Write);
+	((Serializer&)ser).beginArray("array");
+		for (int i = 0; i < 16; ++i) {
+			String<32> str("element %d", i);
+			ser.value(str);
+		}
+	ser.endArray();
+	eastl::vector<uint8> data((const uint8*)ser.getData(), (const uint8*)ser.getData() + ser.getDataSize());
+
+	SerializerBinary reader(SerializerBinary::Mode_Read);
+	REQUIRE_FALSE(reader.setData("json", 4));
+
+ // truncated data must fail without reading out of bounds
+	for (uint n = 4; n < data.size(); ++n) {
+		REQUIRE(reader.setData(data.data(), n));
+		uint len = 0;
+		if (reader.beginArray(len, "array")) {
+			String<32> str;
+			while (reader.value(str)) {}
+			reader.endArray();
+		}
+	}
+}
+
+TEST_CASE("BinaryValueArray", "[SerializerBinary]")
+{
+	const uint kCount = 64;
+	sint16 s16[kCount];
+	for (uint i = 0; i < kCount; ++i) {
+		s16[i] = (sint16)i - 32;
+	}
+	mat4 m = identity;
+	m[3][0] = 2.0f;
+
+	SerializerBinary ser(SerializerBinary::Mode_Write);
+	ser.valueArray(s16, kCount, "s16");
+	Serialize(ser, m, "m");
+	((Serializer&)ser).beginArray("loop");
+		for (uint i = 0; i < kCount; ++i) {
+			ser.value(s16[i]);
+		}
+	ser.endArray();
+
+	ser.setMode(SerializerBinary::Mode_Read);
+	mat4 mr;
+	REQUIRE(Serialize(ser, mr, "m"));
+	REQUIRE(mr == m);
+	vec4 vr[4];
+	REQUIRE(ser.valueArray(vr, 4, "m"));
+	REQUIRE(vr[3] == m[3]);
+
+	float32 f32r[kCount] = {};
+	REQUIRE(ser.valueArray(f32r, kCount, "s16"));
+	REQUIRE(f32r[0] == -32.0f);
+	sint64 s64r[kCount] = {}; // array written per element
+	REQUIRE(ser.valueArray(s64r, kCount, "loop"));
+	REQUIRE(s64r[kCount - 1] == (sint64)(kCount - 33));
+	REQUIRE_FALSE(ser.valueArray(s64r, kCount + 1, "loop"));
+}
+
+TEST_CASE("BinaryZeroCopy", "[SerializerBinary]")
+{
+	const uint kCount = 1000;
+	float32 vertices[kCount];
+	uint16 indices[kCount];
+	for (uint i = 0; i < kCount; ++i) {
+		vertices[i] = (float32)i * 0.5f;
+		indices[i] = (uint16)(kCount - i);
+	}
+	const char* kPath = "SerializerBinary_ZeroCopy.bin";
+
+	{	SerializerBinary ser(SerializerBinary::Mode_Write);
+		uint8 pad = 1;
+		ser.value(pad, "pad"); // misalign subsequent data
+		String<32> str("string value");
+		ser.value(str, "str");
+		ser.valueArray(vertices, kCount, "vertices");
+		ser.valueArray(indices, kCount, "indices");
+		void* data = indices;
+		uint dataSize = sizeof(indices);
+		ser.binary(data, dataSize, "raw");
+		ser.binary(data, dataSize, "compressed", CompressionFlags_Speed);
+
+		File f;
+		f.setData((const char*)ser.getData(), ser.getDataSize());
+		REQUIRE(File::Write(f, kPath));
+	}
+
+	File f;
+	REQUIRE(File::Map(f, kPath));
+	REQUIRE(f.isMapped());
+	SerializerBinary ser(SerializerBinary::Mode_Read);
+	REQUIRE(ser.setData(f.getData(), (uint)f.getDataSize()));
+
+	const char* str;
+	uint len;
+	REQUIRE(ser.stringView(str, len, "str"));
+	REQUIRE(len == 12);
+	REQUIRE(strncmp(str, "string value", len) == 0);
+
+	const float32* v;
+	uint count;
+	REQUIRE(ser.arrayView(v, count, "vertices"));
+	REQUIRE(count == kCount);
+	REQUIRE((uint)((const char*)v - f.getData()) % SerializerBinary::kAlignment == 0);
+	REQUIRE(memcmp(v, vertices, sizeof(vertices)) == 0);
+	REQUIRE(ser.arrayView(v, count, "vertices"));
+	const uint16* idx;
+	REQUIRE_FALSE(ser.arrayView(idx, count, "vertices")); // type mismatch
+
+	REQUIRE(ser.arrayView(idx, count, "indices"));
+	REQUIRE(count == kCount);
+	REQUIRE((uint)((const char*)idx - f.getData()) % SerializerBinary::kAlignment == 0);
+	REQUIRE(memcmp(idx, indices, sizeof(indices)) == 0);
+
+ // copy with conversion
+	float64 indices64[kCount];
+	REQUIRE(ser.valueArray(indices64, kCount, "indices"));
+	REQUIRE(indices64[0] == (float64)kCount);
+	REQUIRE_FALSE(ser.valueArray(indices64, kCount - 1, "indices"));
+
+	const void* data;
+	uint dataSize;
+	REQUIRE(ser.binaryView(data, dataSize, "raw"));
+	REQUIRE(dataSize == sizeof(indices));
+	REQUIRE((uint)((const char*)data - f.getData()) % SerializerBinary::kAlignment == 0);
+	REQUIRE(memcmp(data, indices, sizeof(indices)) == 0);
+	REQUIRE_FALSE(ser.binaryView(data, dataSize, "compressed"));
+	void* decompressed = nullptr;
+	uint decompressedSize = 0;
+	REQUIRE(ser.binary(decompressed, decompressedSize, "compressed"));
+	REQUIRE(memcmp(decompressed, indices, sizeof(indices)) == 0);
+	APT_FREE(decompressed);
+
+	f.setData(nullptr, 0); // unmap
+	REQUIRE_FALSE(f.isMapped());
+	FileSystem::Delete(kPath);
+}
+
+namespace {
+
+struct StaticLeaf
+{
+	String<16> m_name;
+	ivec2      m_size;
+
+	template <typename tSerializer>
+	bool serialize(tSerializer& _serializer_)
+	{
+		return SerializeFields(_serializer_, APT_SERIALIZE_FIELD(m_name), APT_SERIALIZE_FIELD(m_size));
+	}
+};
+
+struct StaticNode
+{
+	bool       m_enabled   = false;
+	sint32     m_id        = 0;
+	float64    m_time      = 0.0;
+	mat4       m_world     = mat4(0.0f);
+	vec3       m_points[3] = {};
+	float32    m_weights[4] = {};
+	StaticLeaf m_leaves[2];
+
+	template <typename tSerializer>
+	bool serialize(tSerializer& _serializer_)
+	{
+		return SerializeFields(_serializer_,
+			APT_SERIALIZE_FIELD(m_enabled),
+			APT_SERIALIZE_FIELD(m_id),
+			APT_SERIALIZE_FIELD(m_time),
+			APT_SERIALIZE_FIELD(m_world),
+			APT_SERIALIZE_FIELD(m_points),
+			SerializeField("weights", m_weights),
+			SerializeField("leaves", m_leaves)
+			);
+	}
+
+	bool operator==(const StaticNode& _rhs) const
+	{
+		return m_enabled == _rhs.m_enabled && m_id == _rhs.m_id && m_time == _rhs.m_time && m_world == _rhs.m_world
+			&& memcmp(m_points, _rhs.m_points, sizeof(m_points)) == 0 && memcmp(m_weights, _rhs.m_weights, sizeof(m_weights)) == 0
+			&& m_leaves[0].m_name == _rhs.m_leaves[0].m_name && m_leaves[1].m_size == _rhs.m_leaves[1].m_size;
+	}
+};
+
+} // namespace
+
+TEST_CASE("BinarySerializeStatic", "[SerializerBinary]")
+{
+	StaticNode node;
+	node.m_enabled = true;
+	node.m_id = -3;
+	node.m_time = 1.25;
+	node.m_world = identity;
+	node.m_points[2] = vec3(1.0f, 2.0f, 3.0f);
+	node.m_weights[1] = 0.5f;
+	node.m_leaves[0].m_name = "leaf0";
+	node.m_leaves[1].m_size = ivec2(4, 5);
+
+	SerializerBinary ser(SerializerBinary::Mode_Write);
+	REQUIRE(SerializeStatic(ser, node, "node"));
+
+ // read via the virtual interface
+	ser.setMode(SerializerBinary::Mode_Read);
+	StaticNode node2;
+	REQUIRE(SerializeStatic((Serializer&)ser, node2, "node"));
+	REQUIRE(node2 == node);
+
+	StaticLeaf leaves[3];
+	REQUIRE_FALSE(SerializeStatic(ser, leaves, "leaves")); // not found
+	REQUIRE(ser.beginObject("node"));
+		REQUIRE_FALSE(SerializeStatic(ser, leaves, "leaves")); // length mismatch
+	ser.endObject();
+}
+
+TEST_CASE("BinaryDelta", "[SerializerBinary]")
+{
+	const uint kCount = 10000;
+	eastl::vector<float32> f32(kCount);
+	for (uint i = 0; i < kCount; ++i) {
+		f32[i] = (float32)i;
+	}
+	sint32 a = 1, b = 2;
+	String<32> str = "test";
+
+	SerializerBinary::DeltaSnapshot snapshot;
+	SerializerBinary ser(SerializerBinary::Mode_Write);
+	auto write = [&]() {
+		ser.setDeltaSnapshot(&snapshot);
+		ser.value(str, "str");
+		ser.beginObject("obj");
+			ser.value(a, "a");
+			ser.value(b, "b");
+		ser.endObject();
+		ser.valueArray(f32.data(), kCount, "f32");
+		return eastl::vector<uint8>((const uint8*)ser.getData(), (const uint8*)ser.getData() + ser.getDataSize());
+	};
+
+ // first patch is complete
+	eastl::vector<uint8> patch0 = write();
+	SerializerBinary merge(SerializerBinary::Mode_Write);
+	REQUIRE(merge.applyPatch(nullptr, 0, patch0.data(), patch0.size()));
+	eastl::vector<uint8> full0((const uint8*)merge.getData(), (const uint8*)merge.getData() + merge.getDataSize());
+
+ // second patch contains only the changes
+	b = 3;
+	f32[5000] = -1.0f;
+	eastl::vector<uint8> patch1 = write();
+	REQUIRE(patch1.size() < patch0.size() / 4);
+	REQUIRE(merge.applyPatch(full0.data(), full0.size(), patch1.data(), patch1.size()));
+
+	SerializerBinary reader(SerializerBinary::Mode_Read);
+	REQUIRE(reader.setData(merge.getData(), merge.getDataSize()));
+	REQUIRE_FALSE(reader.isPatch());
+	String<32> strr;
+	REQUIRE(reader.value(strr, "str"));
+	REQUIRE(strr == str);
+	sint32 ar = 0, br = 0;
+	REQUIRE(reader.beginObject("obj"));
+		REQUIRE(reader.value(ar, "a"));
+		REQUIRE(reader.value(br, "b"));
+	reader.endObject();
+	REQUIRE(ar == 1);
+	REQUIRE(br == 3);
+	const float32* f32view;
+	uint countr;
+	REQUIRE(reader.arrayView(f32view, countr, "f32"));
+	REQUIRE(countr == kCount);
+	REQUIRE(memcmp(f32view, f32.data(), sizeof(float32) * kCount) == 0);
+
+ // read the patch directly over the previous state
+	REQUIRE(reader.setData(patch1.data(), patch1.size()));
+	REQUIRE(reader.isPatch());
+	eastl::vector<float32> f32r(kCount);
+	for (uint i = 0; i < kCount; ++i) {
+		f32r[i] = (float32)i;
+	}
+	ar = 1; br = 2; strr = "test";
+	const char* strView;
+	uint strViewLength;
+	REQUIRE(reader.value(strr, "str")); // unchanged, not in the patch
+	REQUIRE(reader.beginObject("obj"));
+		REQUIRE(reader.value(ar, "a"));
+		REQUIRE(reader.value(br, "b"));
+	reader.endObject();
+	REQUIRE(reader.valueArray(f32r.data(), kCount, "f32"));
+	REQUIRE(ar == 1);
+	REQUIRE(br == 3);
+	REQUIRE(strr == str);
+	REQUIRE(f32r == f32);
+	REQUIRE(reader.getError() == nullptr);
+	REQUIRE_FALSE(reader.stringView(strView, strViewLength, "str")); // no data to view
+	REQUIRE(reader.getError() == nullptr);
+
+ // absent objects/arrays succeed, their members are also absent
+	b = 4;
+	eastl::vector<uint8> patchB = write();
+	REQUIRE(reader.setData(patchB.data(), patchB.size()));
+	REQUIRE(reader.value(br, "b")); // not a member of the root
+	REQUIRE(br == 3);
+	REQUIRE(reader.beginObject("missing"));
+		REQUIRE(reader.value(ar, "a"));
+	reader.endObject();
+	uint len = 2;
+	REQUIRE(reader.beginArray(len, "missingArray"));
+		REQUIRE(reader.value(ar));
+	reader.endArray();
+	REQUIRE(len == 2);
+	REQUIRE(ar == 1);
+	REQUIRE(reader.getError() == nullptr);
+
+ // no changes, empty patch
+	eastl::vector<uint8> patch2 = write();
+	REQUIRE(patch2.size() == 4);
+
+ // an unchanged array isn't rewritten if its offset (hence the alignment padding of its elements) changes
+	SerializerBinary::DeltaSnapshot arraySnapshot;
+	eastl::vector<uint8> bin(256, 0xab);
+	auto writeArray = [&]() {
+		ser.setMode(SerializerBinary::Mode_Write);
+		ser.setDeltaSnapshot(&arraySnapshot);
+		ser.value(str, "str");
+		uint n = 2;
+		ser.beginArray(n, "arr");
+			void* data = bin.data();
+			uint dataSize = (uint)bin.size();
+			ser.binary(data, dataSize);
+			ser.valueArray(f32.data(), 16);
+		ser.endArray();
+		return eastl::vector<uint8>((const uint8*)ser.getData(), (const uint8*)ser.getData() + ser.getDataSize());
+	};
+	writeArray();
+	str = "test string";
+	eastl::vector<uint8> patch3 = writeArray();
+	REQUIRE(patch3.size() < bin.size());
+}
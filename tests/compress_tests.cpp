@@ -6,9 +6,27 @@
 #include <apt/memory.h>
 #include <apt/File.h>
 #include <apt/Time.h>
+#include <apt/math.h>
+#include <apt/String.h>
+
+#include <EASTL/vector.h>
 
 using namespace apt;
 
+// Generate compressible test data (random runs of a small alphabet).
+static void GenerateData(uint8* out_, uint _sizeBytes, uint32 _seed = 1)
+{
+	uint32 rnd = _seed;
+	for (uint i = 0; i < _sizeBytes;) {
+		rnd = rnd * 1664525u + 1013904223u;
+		uint8 c = (uint8)('a' + (rnd >> 24) % 16);
+		uint n = (rnd >> 8) % 8 + 1;
+		for (uint j = 0; j < n && i < _sizeBytes; ++j, ++i) {
+			out_[i] = c;
+		}
+	}
+}
+
 static void CompressionTest(const char* _filePath, CompressionFlags _flags)
 {
 	APT_LOG("\nCompression Test '%s' (%s) *********", _filePath, (_flags == CompressionFlags_Size) ? "size" : "speed");
@@ -49,4 +67,368 @@ TEST_CASE("performance", "[Compression]")
 {
 	CompressionTest("bob_lamp_update.md5anim");
 }
-#endif
\ No newline at end of file
+#endif
+
+TEST_CASE("Stream", "[Compression]")
+{
+	const uint kDataSize = 300 * 1024;
+	uint8* data = (uint8*)malloc(kDataSize);
+	GenerateData(data, kDataSize);
+
+	for (auto flags : { CompressionFlags_Speed, CompressionFlags_Size }) {
+		for (uint window : { 1u, 77u, 4096u, 128u * 1024u }) {
+		 // stream compress, one-shot decompress
+			uint8* c = (uint8*)malloc(kDataSize * 2);
+			uint csz = 0;
+			{
+				Compressor compressor(flags);
+				uint consumed = 0;
+				CompressionStatus status = CompressionStatus_Continue;
+				while (status == CompressionStatus_Continue) {
+					uint inSize  = APT_MIN(window, kDataSize - consumed);
+					uint outSize = APT_MIN(window, kDataSize * 2 - csz);
+					status = compressor.compress(data + consumed, inSize, c + csz, outSize, consumed + inSize == kDataSize);
+					consumed += inSize;
+					csz += outSize;
+				}
+				REQUIRE(status == CompressionStatus_Done);
+				REQUIRE(consumed == kDataSize);
+			}
+			void* d = nullptr;
+			uint dsz = 0;
+			Decompress(c, csz, d, dsz);
+			REQUIRE(dsz == kDataSize);
+			REQUIRE(memcmp(d, data, kDataSize) == 0);
+			free(d);
+			free(c);
+
+		 // one-shot compress, stream decompress
+			c = nullptr;
+			Compress(data, kDataSize, (void*&)c, csz, flags);
+			d = malloc(kDataSize);
+			dsz = 0;
+			{
+				Decompressor decompressor;
+				uint consumed = 0;
+				CompressionStatus status = CompressionStatus_Continue;
+				while (status == CompressionStatus_Continue) {
+					uint inSize  = APT_MIN(window, csz - consumed);
+					uint outSize = APT_MIN(window, kDataSize - dsz);
+					status = decompressor.decompress(c + consumed, inSize, (uint8*)d + dsz, outSize, consumed + inSize == csz);
+					consumed += inSize;
+					dsz += outSize;
+				}
+				REQUIRE(status == CompressionStatus_Done);
+				REQUIRE(consumed == csz);
+			}
+			REQUIRE(dsz == kDataSize);
+			REQUIRE(memcmp(d, data, kDataSize) == 0);
+			free(d);
+			free(c);
+		}
+	}
+
+	{	// corrupt input
+		void* c = nullptr;
+		uint csz = 0;
+		Compress(data, kDataSize, c, csz);
+		((uint8*)c)[csz / 2] ^= 0xff;
+		((uint8*)c)[csz - 1] ^= 0xff; // adler32
+		uint8* d = (uint8*)malloc(kDataSize);
+		Decompressor decompressor;
+		uint inSize = csz, outSize = kDataSize;
+		CompressionStatus status = decompressor.decompress(c, inSize, d, outSize, true);
+		REQUIRE(status == CompressionStatus_Error);
+		free(d);
+		free(c);
+	}
+
+	{	// truncated input
+		void* c = nullptr;
+		uint csz = 0;
+		Compress(data, kDataSize, c, csz, CompressionFlags_Speed);
+		uint8* d = (uint8*)malloc(kDataSize);
+		Decompressor decompressor;
+		uint inSize = csz / 2, outSize = kDataSize;
+		REQUIRE(decompressor.decompress(c, inSize, d, outSize, false) == CompressionStatus_Continue);
+		REQUIRE(inSize == csz / 2);
+		inSize = 0;
+		outSize = kDataSize;
+		REQUIRE(decompressor.decompress((uint8*)c + csz / 2, inSize, d, outSize, true) == CompressionStatus_Error);
+		free(d);
+		free(c);
+	}
+
+	free(data);
+}
+
+TEST_CASE("Blocks", "[Compression]")
+{
+	const uint kDataSize = 1000 * 1000;
+	const uint kBlockSize = 64 * 1024;
+	uint8* data = (uint8*)malloc(kDataSize);
+	GenerateData(data, kDataSize);
+	uint32 rnd = 7;
+	for (uint i = kBlockSize; i < kBlockSize * 2; ++i) { // make block 1 incompressible
+		rnd = rnd * 1664525u + 1013904223u;
+		data[i] = (uint8)(rnd >> 24);
+	}
+
+	for (uint threadCount : { 1u, 4u, 0u }) {
+		void* c = nullptr;
+		uint64 csz = 0;
+		CompressBlocks(data, kDataSize, c, csz, CompressionFlags_Speed, kBlockSize, threadCount);
+		REQUIRE(csz < kDataSize);
+
+		uint blockCount, blockSize;
+		uint64 rawSize;
+		REQUIRE(GetBlockInfo(c, csz, blockCount, blockSize, rawSize));
+		REQUIRE(blockCount == (kDataSize + kBlockSize - 1) / kBlockSize);
+		REQUIRE(blockSize == kBlockSize);
+		REQUIRE(rawSize == kDataSize);
+
+		void* d = nullptr;
+		uint64 dsz = 0;
+		REQUIRE(DecompressBlocks(c, csz, d, dsz, threadCount));
+		REQUIRE(dsz == kDataSize);
+		REQUIRE(memcmp(d, data, kDataSize) == 0);
+		free(d);
+		d = nullptr;
+
+	 // random access
+		uint8* block = (uint8*)malloc(kBlockSize);
+		for (uint i : { blockCount - 1, (uint)1, (uint)5, (uint)0 }) {
+			uint sz = 0;
+			REQUIRE(DecompressBlock(c, csz, i, block, sz));
+			REQUIRE(sz == APT_MIN(kBlockSize, kDataSize - i * kBlockSize));
+			REQUIRE(memcmp(block, data + i * kBlockSize, sz) == 0);
+		}
+		REQUIRE_FALSE(DecompressBlock(c, csz, blockCount, block, blockSize));
+		free(block);
+
+	 // truncated
+		REQUIRE_FALSE(DecompressBlocks(c, csz / 2, d, dsz));
+		REQUIRE_FALSE(DecompressBlocks(c, 12, d, dsz));
+
+	 // corrupt header, sizes must not overflow
+		uint64& headerRawSize = *(uint64*)((uint8*)c + 8);
+		uint32& headerBlockSize = *(uint32*)((uint8*)c + 4);
+		headerRawSize = ~(uint64)0;
+		REQUIRE_FALSE(DecompressBlocks(c, csz, d, dsz));
+		headerBlockSize = ~(uint32)0;
+		headerRawSize = (uint64)headerBlockSize * blockCount; // index fits, raw size is inconsistent with the block data
+		REQUIRE_FALSE(DecompressBlocks(c, csz, d, dsz));
+		REQUIRE(d == nullptr);
+		free(c);
+	}
+
+	{	// via Compress()/Decompress()
+		void* c = nullptr;
+		uint csz = 0;
+		Compress(data, kDataSize, c, csz, CompressionFlags_Size | CompressionFlags_Parallel);
+		uint blockCount, blockSize;
+		uint64 rawSize;
+		REQUIRE(GetBlockInfo(c, csz, blockCount, blockSize, rawSize));
+		void* d = nullptr;
+		uint dsz = 0;
+		Decompress(c, csz, d, dsz);
+		REQUIRE(dsz == kDataSize);
+		REQUIRE(memcmp(d, data, kDataSize) == 0);
+		free(d);
+		free(c);
+	}
+
+	{	// File
+		File f;
+		f.setData((const char*)data, kDataSize);
+		f.compress(CompressionFlags_Size);
+		REQUIRE(f.getDataSize() < kDataSize);
+		REQUIRE(f.decompress());
+		REQUIRE(f.getDataSize() == kDataSize);
+		REQUIRE(memcmp(f.getData(), data, kDataSize) == 0);
+	}
+
+	free(data);
+}
+
+TEST_CASE("CallerBuffers", "[Compression]")
+{
+	const uint kDataSize = 600 * 1024;
+	uint8* data = (uint8*)malloc(kDataSize);
+	uint8* rnd = (uint8*)malloc(kDataSize);
+	GenerateData(data, kDataSize);
+	uint32 r = 3;
+	for (uint i = 0; i < kDataSize; ++i) {
+		r = r * 1664525u + 1013904223u;
+		rnd[i] = (uint8)(r >> 24);
+	}
+	uint8* d = (uint8*)malloc(kDataSize);
+
+	for (auto flags : { CompressionFlags_Speed, CompressionFlags_Size, CompressionFlags_Speed | CompressionFlags_Parallel }) {
+		for (uint8* in : { data, rnd }) {
+			uint bound = CompressBound(kDataSize, flags);
+			uint8* c = (uint8*)malloc(bound);
+			uint csz = 0;
+			REQUIRE(Compress(in, kDataSize, c, bound, csz, flags));
+			REQUIRE(csz <= bound);
+			
+			uint dsz = 0;
+			REQUIRE(Decompress(c, csz, d, kDataSize, dsz));
+			REQUIRE(dsz == kDataSize);
+			REQUIRE(memcmp(d, in, kDataSize) == 0);
+			REQUIRE_FALSE(Decompress(c, csz, d, kDataSize - 1, dsz));
+
+			if (in == data) {
+				uint csz2 = 0;
+				REQUIRE_FALSE(Compress(in, kDataSize, c, csz / 2, csz2, flags));
+			}
+			free(c);
+		}
+	}
+
+	free(d);
+	free(rnd);
+	free(data);
+}
+
+TEST_CASE("Fast", "[Compression]")
+{
+	const uint kDataSize = 300 * 1024;
+	uint8* data = (uint8*)malloc(kDataSize);
+	GenerateData(data, kDataSize);
+	uint8* rnd = (uint8*)malloc(kDataSize);
+	uint32 r = 5;
+	for (uint i = 0; i < kDataSize; ++i) {
+		r = r * 1664525u + 1013904223u;
+		rnd[i] = (uint8)(r >> 24);
+	}
+	memset(rnd + 1000, 'x', 1000); // long match, long literal runs either side
+	uint8* d = (uint8*)malloc(kDataSize);
+
+	for (uint8* in : { data, rnd }) {
+		for (uint size : { 1u, 5u, 12u, 13u, 17u, 64u, 1000u, 4000u, 70000u, 300u * 1024u }) {
+			void* c = nullptr;
+			uint csz = 0;
+			Compress(in, size, c, csz, CompressionFlags_Fast);
+			REQUIRE(csz <= CompressBound(size, CompressionFlags_Fast));
+
+			void* d2 = nullptr;
+			uint dsz = 0;
+			Decompress(c, csz, d2, dsz);
+			REQUIRE(dsz == size);
+			REQUIRE(memcmp(d2, in, size) == 0);
+			free(d2);
+
+			REQUIRE(Decompress(c, csz, d, size, dsz));
+			REQUIRE(dsz == size);
+			REQUIRE(memcmp(d, in, size) == 0);
+			if (size > 1) {
+				REQUIRE_FALSE(Decompress(c, csz, d, size - 1, dsz));
+			}
+			free(c);
+		}
+	}
+
+	{	// compression ratio
+		void* c = nullptr;
+		uint csz = 0;
+		Compress(data, kDataSize, c, csz, CompressionFlags_Fast);
+		REQUIRE(csz < kDataSize);
+		
+	 // corrupt data must fail or produce garbage, but never read/write out of bounds
+		uint32 r2 = 9;
+		for (int i = 0; i < 1000; ++i) {
+			r2 = r2 * 1664525u + 1013904223u;
+			uint8* cc = (uint8*)malloc(csz);
+			memcpy(cc, c, csz);
+			cc[8 + (r2 >> 8) % (csz - 8)] ^= (uint8)(r2 | 1);
+			uint dsz;
+			Decompress(cc, csz, d, kDataSize, dsz);
+			Decompress(cc, 8 + (r2 >> 4) % (csz - 8), d, kDataSize, dsz); // truncated
+			free(cc);
+		}
+		free(c);
+	}
+
+	{	// block format
+		void* c = nullptr;
+		uint64 csz = 0;
+		CompressBlocks(data, kDataSize, c, csz, CompressionFlags_Fast, 16 * 1024, 3);
+		void* d2 = nullptr;
+		uint64 dsz = 0;
+		REQUIRE(DecompressBlocks(c, csz, d2, dsz));
+		REQUIRE(dsz == kDataSize);
+		REQUIRE(memcmp(d2, data, kDataSize) == 0);
+		free(d2);
+		free(c);
+	}
+
+	free(d);
+	free(rnd);
+	free(data);
+}
+
+TEST_CASE("Dictionary", "[Compression]")
+{
+ // small, similar payloads
+	const uint kSampleCount = 200;
+	eastl::vector<String<128> > samples(kSampleCount);
+	eastl::vector<const void*> sampleData(kSampleCount);
+	eastl::vector<uint> sampleSizes(kSampleCount);
+	for (uint i = 0; i < kSampleCount; ++i) {
+		samples[i].setf("{ \"name\": \"object%u\", \"position\": [%u, %u, %u], \"visible\": %s, \"material\": \"default\" }", i, i * 3, i * 7 % 13, i % 5, i % 2 ? "true" : "false");
+		sampleData[i] = (const char*)samples[i];
+		sampleSizes[i] = samples[i].getLength();
+	}
+	CompressionDictionary* dict = CompressionDictionary::Train(sampleData.data(), sampleSizes.data(), kSampleCount, 4 * 1024);
+	REQUIRE(dict);
+	REQUIRE(dict->getSizeBytes() <= 4 * 1024);
+	REQUIRE(CompressionDictionary::Find(dict->getId()) == dict);
+
+	String<128> in("{ \"name\": \"object1000\", \"position\": [1, 2, 3], \"visible\": true, \"material\": \"default\" }");
+	uint inSize = in.getLength();
+	uint8 d[256];
+	for (auto flags : { CompressionFlags_Speed, CompressionFlags_Size, CompressionFlags_Fast }) {
+		void* c = nullptr;
+		uint csz = 0;
+		Compress((const char*)in, inSize, c, csz, flags, dict->getId());
+		void* c0 = nullptr;
+		uint csz0 = 0;
+		Compress((const char*)in, inSize, c0, csz0, flags);
+		REQUIRE(csz < csz0);
+		free(c0);
+
+		void* d2 = nullptr;
+		uint dsz = 0;
+		Decompress(c, csz, d2, dsz);
+		REQUIRE(dsz == inSize);
+		REQUIRE(memcmp(d2, (const char*)in, inSize) == 0);
+		free(d2);
+
+		uint8 cbuf[256];
+		uint csz2 = 0;
+		REQUIRE(Compress((const char*)in, inSize, cbuf, sizeof(cbuf), csz2, flags, dict->getId()));
+		REQUIRE(csz2 == csz);
+		REQUIRE(Decompress(cbuf, csz2, d, sizeof(d), dsz));
+		REQUIRE(dsz == inSize);
+		REQUIRE(memcmp(d, (const char*)in, inSize) == 0);
+		REQUIRE_FALSE(Decompress(cbuf, csz2, d, inSize - 1, dsz));
+		free(c);
+	}
+
+	{	// recreate from the same data
+		CompressionDictionary* dict2 = CompressionDictionary::Create(dict->getData(), dict->getSizeBytes());
+		REQUIRE(dict2->getId() == dict->getId());
+		CompressionDictionary::Destroy(dict2);
+		REQUIRE(dict2 == nullptr);
+	}
+
+	uint8 cbuf[256];
+	uint csz = 0;
+	REQUIRE(Compress((const char*)in, inSize, cbuf, sizeof(cbuf), csz, CompressionFlags_Size, dict->getId()));
+	uint32 id = dict->getId();
+	CompressionDictionary::Destroy(dict);
+	REQUIRE(CompressionDictionary::Find(id) == nullptr);
+	uint dsz = 0;
+	REQUIRE_FALSE(Decompress(cbuf, csz, d, sizeof(d), dsz));
+}
@@ -0,0 +1,125 @@
+#include <catch.hpp>
+
+#include <apt/apt.h>
+#include <apt/hash.h>
+#include <apt/log.h>
+#include <apt/math.h>
+#include <apt/memory.h>
+#include <apt/StringHash.h>
+#include <apt/Time.h>
+
+using namespace apt;
+
+TEST_CASE("StringHashConst", "[Hash]")
+{
+	static const char* kStrings[] = { "", "a", "Player", "Enemy", "A somewhat longer string \xff\x80 with high bits" };
+	for (auto str : kStrings) {
+		REQUIRE(internal::HashStringConst32(str) == internal::HashString32(str));
+		REQUIRE(internal::HashStringConst64(str) == internal::HashString64(str));
+	}
+
+	constexpr StringHash player = APT_STRING_HASH("Player");
+	static_assert(player.getHash() == internal::HashStringConst64("Player"), "APT_STRING_HASH must be a constant expression");
+	REQUIRE(player == StringHash("Player"));
+	REQUIRE("Enemy"_sh == StringHash("Enemy"));
+
+	StringHash::HashType h = StringHash("Enemy");
+	bool found = false;
+	switch (h) {
+		case "Player"_sh: break;
+		case "Enemy"_sh:  found = true; break;
+		default:          break;
+	};
+	REQUIRE(found);
+}
+
+TEST_CASE("HashFast", "[Hash]")
+{
+	uint8 buf[1024];
+	for (int i = 0; i < (int)sizeof(buf); ++i) {
+		buf[i] = (uint8)((i * 7919) ^ (i >> 3));
+	}
+
+	for (uint n = 0; n <= (uint)sizeof(buf); n = (n < 160) ? n + 1 : n + 37) {
+		uint64  h64  = HashFast<uint64>(buf, n);
+		Hash128 h128 = HashFast<Hash128>(buf, n);
+		REQUIRE(h64 == h128.m_lo);
+		REQUIRE(h64 != HashFast<uint64>(buf, n, 1));
+		if (n > 0) {
+			REQUIRE(h64 != HashFast<uint64>(buf, n - 1));
+			REQUIRE(h64 != HashFast<uint64>(buf + 1, n - 1));
+		}
+
+	 // streaming with various chunk sizes must match the single-shot result
+		for (uint chunk : { 1u, 3u, 16u, 63u, 64u, 65u, 200u }) {
+			HashState hs;
+			for (uint i = 0; i < n; i += chunk) {
+				hs.update(buf + i, Min(chunk, n - i));
+			}
+			REQUIRE(hs.get<uint64>() == h64);
+			REQUIRE(hs.get<Hash128>() == h128);
+		}
+	}
+}
+
+// bitwise reference implementation
+static uint32 Crc32cRef(const uint8* _buf, uint _bufSize, uint32 _crc = 0)
+{
+	_crc = ~_crc;
+	while (_bufSize--) {
+		_crc ^= *_buf++;
+		for (int i = 0; i < 8; ++i) {
+			_crc = (_crc & 1) ? (_crc >> 1) ^ 0x82f63b78u : (_crc >> 1);
+		}
+	}
+	return ~_crc;
+}
+
+TEST_CASE("Crc32c", "[Hash]")
+{
+	REQUIRE(Crc32c("123456789", 9) == 0xe3069283u);
+	REQUIRE(Crc32c("", 0) == 0u);
+
+	const uint kSizeBytes = 3 * 8192 * 2 + 3 * 256 + 13; // exercise all paths
+	uint8* buf = (uint8*)APT_MALLOC(kSizeBytes);
+	for (uint i = 0; i < kSizeBytes; ++i) {
+		buf[i] = (uint8)((i * 7919) ^ (i >> 5));
+	}
+	uint32 ref = Crc32cRef(buf, kSizeBytes);
+	REQUIRE(Crc32c(buf, kSizeBytes) == ref);
+	REQUIRE(Crc32c(buf + 3, kSizeBytes - 3, Crc32c(buf, 3)) == ref); // unaligned + incremental
+	REQUIRE(Crc32c(buf + 1, kSizeBytes - 1) == Crc32cRef(buf + 1, kSizeBytes - 1));
+	APT_FREE(buf);
+}
+
+#if 0
+TEST_CASE("performance", "[Hash]")
+{
+	const uint kSizeBytes = 256 * 1024 * 1024;
+	uint8* buf = (uint8*)APT_MALLOC(kSizeBytes);
+	for (uint i = 0; i < kSizeBytes; ++i) {
+		buf[i] = (uint8)(i * 7919);
+	}
+
+	APT_LOG("\nHash Performance (%uMB) *********", kSizeBytes / 1024 / 1024);
+	uint64 h = 0;
+	{	APT_AUTOTIMER("\tHash<uint64> (FNV1a)");
+		h ^= Hash<uint64>(buf, kSizeBytes);
+	}
+	{	APT_AUTOTIMER("\tHashFast<uint64>");
+		h ^= HashFast<uint64>(buf, kSizeBytes);
+	}
+	{	APT_AUTOTIMER("\tHashFast<Hash128>");
+		h ^= HashFast<Hash128>(buf, kSizeBytes).m_hi;
+	}
+	{	APT_AUTOTIMER("\tHashState (64kb chunks)");
+		HashState hs;
+		for (uint i = 0; i < kSizeBytes; i += 64 * 1024) {
+			hs.update(buf + i, 64 * 1024);
+		}
+		h ^= hs.get<uint64>();
+	}
+	APT_LOG("\t(%llx)", h);
+	APT_FREE(buf);
+}
+#endif